@@ -108,6 +108,10 @@ static int dma_tx_descriptor_length = 64;       /*  Number of descriptors per DM
   \brief PPE core clock cycles between descriptor write and effectiveness in external RAM
  */
 static int dma_rx_clp1_descriptor_threshold = 38;
+/*!
+  \brief Number of AAL5 frames handled per tasklet run
+ */
+static int aal_rx_budget = 64;
 /*@}*/
 
 MODULE_PARM(qsb_tau, "i");
@@ -140,6 +144,9 @@ MODULE_PARM_DESC(dma_tx_descriptor_length, "Number of descriptor assigned to DMA
 MODULE_PARM(dma_rx_clp1_descriptor_threshold, "i");
 MODULE_PARM_DESC(dma_rx_clp1_descriptor_threshold, "Descriptor threshold for cells with cell loss priority 1");
 
+MODULE_PARM(aal_rx_budget, "i");
+MODULE_PARM_DESC(aal_rx_budget, "Number of AAL5 frames handled per tasklet run before yielding");
+
 
 
 /*
@@ -196,7 +203,7 @@ static inline int get_tx_desc(unsigned int);
  *  mailbox handler and signal function
  */
 static inline void mailbox_oam_rx_handler(void);
-static inline void mailbox_aal_rx_handler(void);
+static inline int mailbox_aal_rx_handler(int);
 static irqreturn_t mailbox_irq_handler(int, void *);
 static inline void mailbox_signal(unsigned int, int);
 static void do_ppe_tasklet(unsigned long);
@@ -911,7 +918,7 @@ static inline void mailbox_oam_rx_handler(void)
 	}
 }
 
-static inline void mailbox_aal_rx_handler(void)
+static inline int mailbox_aal_rx_handler(int budget)
 {
 	unsigned int vlddes = WRX_DMA_CHANNEL_CONFIG(RX_DMA_CH_AAL)->vlddes;
 	struct rx_descriptor reg_desc;
@@ -921,6 +928,10 @@ static inline void mailbox_aal_rx_handler(void)
 	struct rx_inband_trailer *trailer;
 	unsigned int i;
 
+	/*  leave the rest for the next run, so other softirqs get their turn  */
+	if ( vlddes > budget )
+		vlddes = budget;
+
 	for ( i = 0; i < vlddes; i++ ) {
 		unsigned int loop_count = 0;
 
@@ -1001,15 +1012,19 @@ static inline void mailbox_aal_rx_handler(void)
 
 		mailbox_signal(RX_DMA_CH_AAL, 0);
 	}
+
+	return WRX_DMA_CHANNEL_CONFIG(RX_DMA_CH_AAL)->vlddes != 0;
 }
 
 static void do_ppe_tasklet(unsigned long data)
 {
+	static int aal_rx_pending;
 	unsigned int irqs = *MBOX_IGU1_ISR;
 	*MBOX_IGU1_ISRC = *MBOX_IGU1_ISR;
 
-	if (irqs & (1 << RX_DMA_CH_AAL))
-		mailbox_aal_rx_handler();
+	/* the interrupt is already acked for frames left over by the budget */
+	if ((irqs & (1 << RX_DMA_CH_AAL)) || aal_rx_pending)
+		aal_rx_pending = mailbox_aal_rx_handler(aal_rx_budget);
 	if (irqs & (1 << RX_DMA_CH_OAM))
 		mailbox_oam_rx_handler();
 
@@ -1017,7 +1032,9 @@ static void do_ppe_tasklet(unsigned long data)
 	if ((irqs >> (FIRST_QSB_QID + 16)) & g_atm_priv_data.conn_table)
 		mailbox_tx_handler(irqs >> (FIRST_QSB_QID + 16));
 
-	if ((*MBOX_IGU1_ISR & ((1 << RX_DMA_CH_AAL) | (1 << RX_DMA_CH_OAM))) != 0)
+	if (aal_rx_pending)
+		tasklet_schedule(&g_dma_tasklet);
+	else if ((*MBOX_IGU1_ISR & ((1 << RX_DMA_CH_AAL) | (1 << RX_DMA_CH_OAM))) != 0)
 		tasklet_schedule(&g_dma_tasklet);
 	else if (*MBOX_IGU1_ISR >> (FIRST_QSB_QID + 16)) /* TX queue */
 		tasklet_schedule(&g_dma_tasklet);
@@ -1385,6 +1402,9 @@ static inline void check_parameters(void)
 
 	if ( dma_tx_descriptor_length < 2 )
 		dma_tx_descriptor_length = 2;
+
+	if ( aal_rx_budget < 1 )
+		aal_rx_budget = 1;
 }
 
 static inline int init_priv_data(void)
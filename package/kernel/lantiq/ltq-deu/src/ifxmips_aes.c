@@ -65,6 +65,11 @@
 #include <crypto/internal/aead.h>
 #include <crypto/internal/hash.h>
 #include <crypto/internal/skcipher.h>
+#ifdef CONFIG_CRYPTO_DEV_AUTHENC
+#include <crypto/authenc.h>
+#include <linux/rtnetlink.h>
+#include <asm/unaligned.h>
+#endif
 
 #include "ifxmips_deu.h"
 
@@ -98,6 +103,16 @@ spinlock_t aes_lock;
 #define CTR_RFC3686_MAX_KEY_SIZE  (AES_MAX_KEY_SIZE + CTR_RFC3686_NONCE_SIZE)
 #define AES_CBCMAC_DBN_TEMP_SIZE  128
 
+#ifdef CONFIG_CRYPTO_DEV_AUTHENC
+#define HASH_START                  IFX_HASH_CON
+#define AUTHENC_HASH_BLOCK_SIZE     64
+#define AUTHENC_MAX_KEYLEN          64
+#define AUTHENC_SHA1_DIGEST_SIZE    20
+#define AUTHENC_MD5_DIGEST_SIZE     16
+#define AUTHENC_CHUNK_SIZE          256
+#define AUTHENC_MD5_HASH_CON        0x0703002D
+#endif
+
 #ifdef CRYPTO_DEBUG
 extern char debug_level;
 #define DPRINTF(level, format, args...) if (level < debug_level) printk(KERN_INFO "[%s %s %d]: " format, __FILE__, __func__, __LINE__, ##args);
@@ -1871,6 +1886,491 @@ struct aead_alg ifxdeu_gcm_aes_alg = {
     .setauthsize             =   gcm_aes_setauthsize,
 };
 
+#ifdef CONFIG_CRYPTO_DEV_AUTHENC
+/*
+ * authenc(hmac(sha1|md5),cbc(aes)) for IPsec. Instead of running cbc(aes)
+ * and hmac() as two separate passes, both DEU engines are programmed at
+ * once and fed block by block: while the AES engine processes the next
+ * 64 bytes, the hash engine digests the previous ones.
+ */
+struct aes_authenc_ctx {
+    struct aes_ctx aes; /* must be first, used by aes_set_key() */
+    u8 authkey[AUTHENC_MAX_KEYLEN] __aligned(4);
+    unsigned int authkeylen;
+    bool md5;
+};
+
+struct authenc_hash_state {
+    u8 block[AUTHENC_HASH_BLOCK_SIZE] __aligned(4);
+    unsigned int fill;
+};
+
+/*! \fn static void authenc_hash_start(struct aes_authenc_ctx *ctx, unsigned int len)
+ *  \ingroup IFX_AES_FUNCTIONS
+ *  \brief program hmac key and block count, requires hash lock to be held
+ *  \param ctx authenc context
+ *  \param len number of bytes to authenticate
+*/
+static void authenc_hash_start(struct aes_authenc_ctx *ctx, unsigned int len)
+{
+    volatile struct deu_hash_t *hashs = (struct deu_hash_t *) HASH_START;
+    const u32 *key = (const u32 *) ctx->authkey;
+    int i;
+
+    if (ctx->md5)
+        MD5_HASH_INIT;
+    else
+        SHA_HASH_INIT;
+
+    hashs->KIDX |= 0x80000000; //reset keys back to 0
+    for (i = 0; i < DIV_ROUND_UP(ctx->authkeylen, 4); i++) {
+        hashs->KIDX = i;
+        asm("sync");
+        hashs->KEY = key[i];
+    }
+
+    /* message plus 0x80 and 64 bit length padding */
+    hashs->DBN = DIV_ROUND_UP(len + 9, AUTHENC_HASH_BLOCK_SIZE);
+    asm("sync");
+
+    *IFX_HASH_CON = ctx->md5 ? AUTHENC_MD5_HASH_CON : HASH_CON_VALUE;
+
+    while (hashs->controlr.BSY) {
+        // this will not take long
+    }
+}
+
+/*! \fn static void authenc_hash_block(const u8 *block)
+ *  \ingroup IFX_AES_FUNCTIONS
+ *  \brief start hashing one 64 byte block without waiting for completion
+ *  \param block input block
+*/
+static void authenc_hash_block(const u8 *block)
+{
+    volatile struct deu_hash_t *hashs = (struct deu_hash_t *) HASH_START;
+    const u32 *in = (const u32 *) block;
+    int i;
+
+    /* usually finished while the AES engine was busy */
+    while (hashs->controlr.BSY) {
+        // this will not take long
+    }
+
+    for (i = 0; i < AUTHENC_HASH_BLOCK_SIZE / 4; i++)
+        hashs->MR = in[i];
+
+    hashs->controlr.GO = 1;
+    asm("sync");
+}
+
+static void authenc_hash_update(struct authenc_hash_state *hs, const u8 *data,
+                                unsigned int len)
+{
+    unsigned int n;
+
+    while (len) {
+        n = min(len, AUTHENC_HASH_BLOCK_SIZE - hs->fill);
+        memcpy(hs->block + hs->fill, data, n);
+        hs->fill += n;
+        data += n;
+        len -= n;
+
+        if (hs->fill < AUTHENC_HASH_BLOCK_SIZE)
+            continue;
+
+        authenc_hash_block(hs->block);
+        hs->fill = 0;
+    }
+}
+
+/*! \fn static void authenc_hash_final(struct aes_authenc_ctx *ctx, struct authenc_hash_state *hs, unsigned int len, u32 *digest)
+ *  \ingroup IFX_AES_FUNCTIONS
+ *  \brief pad the message and read the hmac digest
+ *  \param ctx authenc context
+ *  \param hs hash block state
+ *  \param len number of bytes authenticated
+ *  \param digest output digest
+*/
+static void authenc_hash_final(struct aes_authenc_ctx *ctx, struct authenc_hash_state *hs,
+                               unsigned int len, u32 *digest)
+{
+    volatile struct deu_hash_t *hashs = (struct deu_hash_t *) HASH_START;
+    u64 bits = ((u64)len + AUTHENC_HASH_BLOCK_SIZE) << 3; // need to add 512 bit of the IPAD operation
+
+    hs->block[hs->fill++] = 0x80;
+    if (hs->fill > AUTHENC_HASH_BLOCK_SIZE - 8) {
+        memset(hs->block + hs->fill, 0, AUTHENC_HASH_BLOCK_SIZE - hs->fill);
+        authenc_hash_block(hs->block);
+        hs->fill = 0;
+    }
+
+    memset(hs->block + hs->fill, 0, AUTHENC_HASH_BLOCK_SIZE - 8 - hs->fill);
+    if (ctx->md5)
+        put_unaligned_le64(bits, hs->block + AUTHENC_HASH_BLOCK_SIZE - 8);
+    else
+        put_unaligned_be64(bits, hs->block + AUTHENC_HASH_BLOCK_SIZE - 8);
+    authenc_hash_block(hs->block);
+
+    //wait for digest ready
+    while (! hashs->controlr.DGRY) {
+        // this will not take long
+    }
+
+    digest[0] = hashs->D1R;
+    digest[1] = hashs->D2R;
+    digest[2] = hashs->D3R;
+    digest[3] = hashs->D4R;
+    if (!ctx->md5)
+        digest[4] = hashs->D5R;
+}
+
+/*! \fn static void authenc_aes_start(struct aes_ctx *ctx, const u8 *iv, int encdec)
+ *  \ingroup IFX_AES_FUNCTIONS
+ *  \brief program AES key, CBC mode and IV, requires aes lock to be held
+*/
+static void authenc_aes_start(struct aes_ctx *ctx, const u8 *iv, int encdec)
+{
+    volatile struct aes_t *aes = (volatile struct aes_t *) AES_START;
+
+    aes_set_key_hw(ctx);
+
+    aes->controlr.E_D = !encdec;
+    aes->controlr.O = 1; //CBC
+
+    aes->IV3R = DEU_ENDIAN_SWAP(*(u32 *) iv);
+    aes->IV2R = DEU_ENDIAN_SWAP(*((u32 *) iv + 1));
+    aes->IV1R = DEU_ENDIAN_SWAP(*((u32 *) iv + 2));
+    aes->IV0R = DEU_ENDIAN_SWAP(*((u32 *) iv + 3));
+}
+
+static void authenc_aes_blocks(u8 *buf, unsigned int nbytes)
+{
+    volatile struct aes_t *aes = (volatile struct aes_t *) AES_START;
+    u32 *data = (u32 *) buf;
+
+    for (; nbytes >= AES_BLOCK_SIZE; nbytes -= AES_BLOCK_SIZE, data += 4) {
+        aes->ID3R = INPUT_ENDIAN_SWAP(data[0]);
+        aes->ID2R = INPUT_ENDIAN_SWAP(data[1]);
+        aes->ID1R = INPUT_ENDIAN_SWAP(data[2]);
+        aes->ID0R = INPUT_ENDIAN_SWAP(data[3]);    /* start crypto */
+
+        while (aes->controlr.BUS) {
+            // this will not take long
+        }
+
+        data[0] = aes->OD3R;
+        data[1] = aes->OD2R;
+        data[2] = aes->OD1R;
+        data[3] = aes->OD0R;
+    }
+}
+
+/*! \fn static int authenc_aes_crypt(struct aead_request *req, int encdec)
+ *  \ingroup IFX_AES_FUNCTIONS
+ *  \brief encrypt/decrypt and authenticate in a single pass over the request
+ *  \param req aead request
+ *  \param encdec 1 for encrypt; 0 for decrypt
+ *  \return err
+*/
+static int authenc_aes_crypt(struct aead_request *req, int encdec)
+{
+    struct crypto_aead *aead = crypto_aead_reqtfm(req);
+    struct aes_authenc_ctx *ctx = crypto_aead_ctx(aead);
+    unsigned int authsize = crypto_aead_authsize(aead);
+    u8 buf[AUTHENC_CHUNK_SIZE] __aligned(4);
+    u8 iv[AES_BLOCK_SIZE] __aligned(4);
+    u32 digest[AUTHENC_SHA1_DIGEST_SIZE / 4];
+    u8 tag[AUTHENC_SHA1_DIGEST_SIZE];
+    struct authenc_hash_state hs = {};
+    unsigned int cryptlen, pos, len, i, n;
+    unsigned long flag;
+
+    if (!encdec && req->cryptlen < authsize)
+        return -EINVAL;
+
+    cryptlen = req->cryptlen - (encdec ? 0 : authsize);
+    if (cryptlen % AES_BLOCK_SIZE)
+        return -EINVAL;
+
+    memcpy(iv, req->iv, AES_BLOCK_SIZE);
+    if (!encdec)
+        scatterwalk_map_and_copy(tag, req->src, req->assoclen + cryptlen, authsize, 0);
+
+    /* same order everywhere: aes lock first, then the hash lock */
+    spin_lock_irqsave(&aes_lock, flag);
+    spin_lock(&ltq_deu_hash_lock);
+
+    authenc_hash_start(ctx, req->assoclen + cryptlen);
+    authenc_aes_start(&ctx->aes, iv, encdec);
+
+    for (pos = 0; pos < req->assoclen; pos += n) {
+        n = min_t(unsigned int, req->assoclen - pos, sizeof(buf));
+        scatterwalk_map_and_copy(buf, req->src, pos, n, 0);
+        authenc_hash_update(&hs, buf, n);
+        if (req->src != req->dst)
+            scatterwalk_map_and_copy(buf, req->dst, pos, n, 1);
+    }
+
+    for (pos = 0; pos < cryptlen; pos += n) {
+        n = min_t(unsigned int, cryptlen - pos, sizeof(buf));
+        scatterwalk_map_and_copy(buf, req->src, req->assoclen + pos, n, 0);
+
+        for (i = 0; i < n; i += len) {
+            len = min_t(unsigned int, n - i, AUTHENC_HASH_BLOCK_SIZE);
+            if (!encdec)
+                authenc_hash_update(&hs, buf + i, len);
+            authenc_aes_blocks(buf + i, len);
+            if (encdec)
+                authenc_hash_update(&hs, buf + i, len);
+        }
+
+        scatterwalk_map_and_copy(buf, req->dst, req->assoclen + pos, n, 1);
+    }
+
+    authenc_hash_final(ctx, &hs, req->assoclen + cryptlen, digest);
+
+    spin_unlock(&ltq_deu_hash_lock);
+    spin_unlock_irqrestore(&aes_lock, flag);
+
+    if (encdec) {
+        scatterwalk_map_and_copy(digest, req->dst, req->assoclen + cryptlen, authsize, 1);
+        return 0;
+    }
+
+    return crypto_memneq(tag, digest, authsize) ? -EBADMSG : 0;
+}
+
+static int authenc_aes_encrypt(struct aead_request *req)
+{
+    return authenc_aes_crypt(req, CRYPTO_DIR_ENCRYPT);
+}
+
+static int authenc_aes_decrypt(struct aead_request *req)
+{
+    return authenc_aes_crypt(req, CRYPTO_DIR_DECRYPT);
+}
+
+/*! \fn static int authenc_aes_setkey(struct crypto_aead *aead, const u8 *key, unsigned int keylen)
+ *  \ingroup IFX_AES_FUNCTIONS
+ *  \brief sets the authenc keys, hmac keys longer than the block size are hashed
+ *  \param aead linux crypto aead
+ *  \param key authenc key blob
+ *  \param keylen length of the key blob
+ *  \return -EINVAL - bad key, 0 - SUCCESS
+*/
+static int authenc_aes_setkey(struct crypto_aead *aead, const u8 *key, unsigned int keylen)
+{
+    struct aes_authenc_ctx *ctx = crypto_aead_ctx(aead);
+    struct crypto_authenc_keys keys;
+    struct crypto_shash *hash;
+    int err;
+
+    if (crypto_authenc_extractkeys(&keys, key, keylen))
+        return -EINVAL;
+
+    err = aes_set_key(crypto_aead_tfm(aead), keys.enckey, keys.enckeylen);
+    if (err)
+        goto out;
+
+    memset(ctx->authkey, 0, sizeof(ctx->authkey));
+    if (keys.authkeylen > AUTHENC_MAX_KEYLEN) {
+        hash = crypto_alloc_shash(ctx->md5 ? "md5" : "sha1", 0, 0);
+        if (IS_ERR(hash)) {
+            err = PTR_ERR(hash);
+            goto out;
+        }
+
+        err = crypto_shash_tfm_digest(hash, keys.authkey, keys.authkeylen, ctx->authkey);
+        ctx->authkeylen = crypto_shash_digestsize(hash);
+        crypto_free_shash(hash);
+    } else {
+        memcpy(ctx->authkey, keys.authkey, keys.authkeylen);
+        ctx->authkeylen = keys.authkeylen;
+    }
+
+out:
+    memzero_explicit(&keys, sizeof(keys));
+    return err;
+}
+
+static int authenc_sha1_aes_init_tfm(struct crypto_aead *aead)
+{
+    struct aes_authenc_ctx *ctx = crypto_aead_ctx(aead);
+
+    ctx->md5 = false;
+    return 0;
+}
+
+static int authenc_md5_aes_init_tfm(struct crypto_aead *aead)
+{
+    struct aes_authenc_ctx *ctx = crypto_aead_ctx(aead);
+
+    ctx->md5 = true;
+    return 0;
+}
+
+/*
+ * \brief AES function mappings
+*/
+struct aead_alg ifxdeu_authenc_sha1_aes_alg = {
+    .base.cra_name           =   "authenc(hmac(sha1),cbc(aes))",
+    .base.cra_driver_name    =   "ifxdeu-authenc(hmac(sha1),cbc(aes))",
+    .base.cra_priority       =   IFXDEU_AUTHENC_PRIORITY,
+    .base.cra_flags          =   CRYPTO_ALG_TYPE_AEAD | CRYPTO_ALG_KERN_DRIVER_ONLY,
+    .base.cra_blocksize      =   AES_BLOCK_SIZE,
+    .base.cra_ctxsize        =   sizeof(struct aes_authenc_ctx),
+    .base.cra_module         =   THIS_MODULE,
+    .base.cra_list           =   LIST_HEAD_INIT(ifxdeu_authenc_sha1_aes_alg.base.cra_list),
+    .init                    =   authenc_sha1_aes_init_tfm,
+    .ivsize                  =   AES_BLOCK_SIZE,
+    .maxauthsize             =   AUTHENC_SHA1_DIGEST_SIZE,
+    .setkey                  =   authenc_aes_setkey,
+    .encrypt                 =   authenc_aes_encrypt,
+    .decrypt                 =   authenc_aes_decrypt,
+};
+
+struct aead_alg ifxdeu_authenc_md5_aes_alg = {
+    .base.cra_name           =   "authenc(hmac(md5),cbc(aes))",
+    .base.cra_driver_name    =   "ifxdeu-authenc(hmac(md5),cbc(aes))",
+    .base.cra_priority       =   IFXDEU_AUTHENC_PRIORITY,
+    .base.cra_flags          =   CRYPTO_ALG_TYPE_AEAD | CRYPTO_ALG_KERN_DRIVER_ONLY,
+    .base.cra_blocksize      =   AES_BLOCK_SIZE,
+    .base.cra_ctxsize        =   sizeof(struct aes_authenc_ctx),
+    .base.cra_module         =   THIS_MODULE,
+    .base.cra_list           =   LIST_HEAD_INIT(ifxdeu_authenc_md5_aes_alg.base.cra_list),
+    .init                    =   authenc_md5_aes_init_tfm,
+    .ivsize                  =   AES_BLOCK_SIZE,
+    .maxauthsize             =   AUTHENC_MD5_DIGEST_SIZE,
+    .setkey                  =   authenc_aes_setkey,
+    .encrypt                 =   authenc_aes_encrypt,
+    .decrypt                 =   authenc_aes_decrypt,
+};
+
+/*! \fn static int authenc_aes_selftest(struct aead_alg *alg, const char *reference)
+ *  \ingroup IFX_AES_FUNCTIONS
+ *  \brief compare the fused implementation against the generic template
+ *  \param alg registered authenc algorithm
+ *  \param reference generic implementation to compare with
+ *  \return 0 - SUCCESS or reference not available, -EINVAL - mismatch
+*/
+static int authenc_aes_selftest(struct aead_alg *alg, const char *reference)
+{
+    /* 8 byte ESP header, odd number of hash blocks and a long hmac key */
+    static const unsigned int assoclen = 8, textlen = 112, authkeylen = 80;
+    const unsigned int enckeylen = 16, authsize = alg->maxauthsize;
+    unsigned int keylen = RTA_SPACE(sizeof(struct crypto_authenc_key_param)) +
+                          authkeylen + enckeylen;
+    unsigned int len = assoclen + textlen + authsize;
+    struct crypto_aead *tfm[2] = {};
+    struct aead_request *req = NULL;
+    struct crypto_authenc_key_param *param;
+    u8 *key, *data[2] = {}, iv_tmpl[AES_BLOCK_SIZE], iv[AES_BLOCK_SIZE];
+    struct scatterlist sg;
+    struct rtattr *rta;
+    DECLARE_CRYPTO_WAIT(wait);
+    int i, j, err = 0;
+
+    tfm[1] = crypto_alloc_aead(reference, 0, 0);
+    if (IS_ERR(tfm[1])) {
+        printk (KERN_NOTICE "IFX %s: %s not available, skipping self test\n",
+                alg->base.cra_driver_name, reference);
+        return 0;
+    }
+
+    tfm[0] = crypto_alloc_aead(alg->base.cra_driver_name, 0, 0);
+    key = kzalloc(keylen, GFP_KERNEL);
+    data[0] = kmalloc(len, GFP_KERNEL);
+    data[1] = kmalloc(len, GFP_KERNEL);
+    if (IS_ERR(tfm[0]) || !key || !data[0] || !data[1]) {
+        err = -ENOMEM;
+        goto out;
+    }
+
+    rta = (struct rtattr *) key;
+    rta->rta_type = CRYPTO_AUTHENC_KEYA_PARAM;
+    rta->rta_len = RTA_LENGTH(sizeof(*param));
+    param = RTA_DATA(rta);
+    param->enckeylen = cpu_to_be32(enckeylen);
+    for (i = RTA_SPACE(sizeof(*param)); i < keylen; i++)
+        key[i] = i * 13 + 5;
+    for (i = 0; i < sizeof(iv_tmpl); i++)
+        iv_tmpl[i] = i * 3 + 1;
+
+    for (j = 0; j < 2; j++) {
+        for (i = 0; i < assoclen + textlen; i++)
+            data[j][i] = i * 7 + 3;
+
+        if ((err = crypto_aead_setkey(tfm[j], key, keylen)) ||
+            (err = crypto_aead_setauthsize(tfm[j], authsize)))
+            goto out;
+
+        req = aead_request_alloc(tfm[j], GFP_KERNEL);
+        if (!req) {
+            err = -ENOMEM;
+            goto out;
+        }
+
+        /* cbc writes the output IV back, every request starts from the template */
+        memcpy(iv, iv_tmpl, sizeof(iv));
+        sg_init_one(&sg, data[j], len);
+        aead_request_set_callback(req, CRYPTO_TFM_REQ_MAY_SLEEP, crypto_req_done, &wait);
+        aead_request_set_ad(req, assoclen);
+        aead_request_set_crypt(req, &sg, &sg, textlen, iv);
+        err = crypto_wait_req(crypto_aead_encrypt(req), &wait);
+        aead_request_free(req);
+        req = NULL;
+        if (err)
+            goto out;
+    }
+
+    if (memcmp(data[0], data[1], len)) {
+        err = -EINVAL;
+        goto out;
+    }
+
+    /* decrypt in place, then check that a modified tag is rejected */
+    req = aead_request_alloc(tfm[0], GFP_KERNEL);
+    if (!req) {
+        err = -ENOMEM;
+        goto out;
+    }
+
+    aead_request_set_callback(req, 0, NULL, NULL);
+    aead_request_set_ad(req, assoclen);
+    aead_request_set_crypt(req, &sg, &sg, textlen + authsize, iv);
+
+    memcpy(iv, iv_tmpl, sizeof(iv));
+    memcpy(data[0], data[1], len);
+    sg_init_one(&sg, data[0], len);
+    err = crypto_aead_decrypt(req);
+    for (i = 0; !err && i < assoclen + textlen; i++)
+        if (data[0][i] != (u8)(i * 7 + 3))
+            err = -EINVAL;
+    if (err)
+        goto out;
+
+    memcpy(iv, iv_tmpl, sizeof(iv));
+    memcpy(data[0], data[1], len);
+    data[0][len - 1] ^= 1;
+    if (crypto_aead_decrypt(req) != -EBADMSG)
+        err = -EINVAL;
+
+out:
+    if (err)
+        printk (KERN_ERR "IFX %s: self test failed (%d)\n",
+                alg->base.cra_driver_name, err);
+    aead_request_free(req);
+    kfree(data[0]);
+    kfree(data[1]);
+    kfree_sensitive(key);
+    if (!IS_ERR_OR_NULL(tfm[0]))
+        crypto_free_aead(tfm[0]);
+    crypto_free_aead(tfm[1]);
+
+    return err;
+}
+#endif /* CONFIG_CRYPTO_DEV_AUTHENC */
+
 /*! \fn int ifxdeu_init_aes (void)
  *  \ingroup IFX_AES_FUNCTIONS
  *  \brief function to initialize AES driver
@@ -1914,46 +2414,54 @@ int ifxdeu_init_aes (void)
 
     CRTCL_SECT_INIT;
 
+#ifdef CONFIG_CRYPTO_DEV_AUTHENC
+    if ((ret = crypto_register_aead(&ifxdeu_authenc_sha1_aes_alg)))
+        goto authenc_sha1_aes_err;
+
+    if ((ret = authenc_aes_selftest(&ifxdeu_authenc_sha1_aes_alg,
+                                    "authenc(hmac(sha1-generic),cbc(aes-generic))")))
+        goto authenc_sha1_aes_test_err;
+
+    if ((ret = crypto_register_aead(&ifxdeu_authenc_md5_aes_alg)))
+        goto authenc_md5_aes_err;
+
+    if ((ret = authenc_aes_selftest(&ifxdeu_authenc_md5_aes_alg,
+                                    "authenc(hmac(md5-generic),cbc(aes-generic))")))
+        goto authenc_md5_aes_test_err;
+#endif
+
 
     printk (KERN_NOTICE "IFX DEU AES initialized%s%s.\n", disable_multiblock ? "" : " (multiblock)", disable_deudma ? "" : " (DMA)");
     return ret;
 
-gcm_aes_err:
+#ifdef CONFIG_CRYPTO_DEV_AUTHENC
+authenc_md5_aes_test_err:
+    crypto_unregister_aead(&ifxdeu_authenc_md5_aes_alg);
+authenc_md5_aes_err:
+authenc_sha1_aes_test_err:
+    crypto_unregister_aead(&ifxdeu_authenc_sha1_aes_alg);
+authenc_sha1_aes_err:
+    printk (KERN_ERR "IFX authenc aes initialization failed!\n");
     crypto_unregister_aead(&ifxdeu_gcm_aes_alg);
-    printk (KERN_ERR "IFX gcm_aes initialization failed!\n");
-    return ret;
-cbcmac_aes_err:
+#endif
+gcm_aes_err:
     crypto_unregister_shash(&ifxdeu_cbcmac_aes_alg);
-    printk (KERN_ERR "IFX cbcmac_aes initialization failed!\n");
-    return ret;
-ctr_rfc3686_aes_err:
+cbcmac_aes_err:
     crypto_unregister_skcipher(&ifxdeu_ctr_rfc3686_aes_alg);
-    printk (KERN_ERR "IFX ctr_rfc3686_aes initialization failed!\n");
-    return ret;
-ctr_basic_aes_err:
+ctr_rfc3686_aes_err:
     crypto_unregister_skcipher(&ifxdeu_ctr_basic_aes_alg);
-    printk (KERN_ERR "IFX ctr_basic_aes initialization failed!\n");
-    return ret;
-cfb_aes_err:
+ctr_basic_aes_err:
     crypto_unregister_skcipher(&ifxdeu_cfb_aes_alg);
-    printk (KERN_ERR "IFX cfb_aes initialization failed!\n");
-    return ret;
-ofb_aes_err:
+cfb_aes_err:
     crypto_unregister_skcipher(&ifxdeu_ofb_aes_alg);
-    printk (KERN_ERR "IFX ofb_aes initialization failed!\n");
-    return ret;
-xts_aes_err:
+ofb_aes_err:
     crypto_unregister_skcipher(&ifxdeu_xts_aes_alg);
-    printk (KERN_ERR "IFX xts_aes initialization failed!\n");
-    return ret;
-cbc_aes_err:
+xts_aes_err:
     crypto_unregister_skcipher(&ifxdeu_cbc_aes_alg);
-    printk (KERN_ERR "IFX cbc_aes initialization failed!\n");
-    return ret;
-ecb_aes_err:
+cbc_aes_err:
     crypto_unregister_skcipher(&ifxdeu_ecb_aes_alg);
-    printk (KERN_ERR "IFX aes initialization failed!\n");
-    return ret;
+ecb_aes_err:
+    crypto_unregister_alg(&ifxdeu_aes_alg);
 aes_err:
     printk(KERN_ERR "IFX DEU AES initialization failed!\n");
 
@@ -1976,4 +2484,8 @@ void ifxdeu_fini_aes (void)
     crypto_unregister_skcipher (&ifxdeu_ctr_rfc3686_aes_alg);
     crypto_unregister_shash (&ifxdeu_cbcmac_aes_alg);
     crypto_unregister_aead (&ifxdeu_gcm_aes_alg);
+#ifdef CONFIG_CRYPTO_DEV_AUTHENC
+    crypto_unregister_aead (&ifxdeu_authenc_sha1_aes_alg);
+    crypto_unregister_aead (&ifxdeu_authenc_md5_aes_alg);
+#endif
 }
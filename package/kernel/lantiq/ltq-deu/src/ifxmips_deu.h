@@ -52,6 +52,7 @@
 #define CLC_START IFX_DEU_CLK
 #define IFXDEU_CRA_PRIORITY	300
 #define IFXDEU_COMPOSITE_PRIORITY 400
+#define IFXDEU_AUTHENC_PRIORITY 500
 //#define KSEG1                         0xA0000000
 #define IFX_PMU_ENABLE 1
 #define IFX_PMU_DISABLE 0
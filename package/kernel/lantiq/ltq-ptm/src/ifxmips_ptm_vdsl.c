@@ -44,6 +44,7 @@
 
 static int wanqos_en = 0;
 static int queue_gamma_map[4] = {0xFE, 0x01, 0x00, 0x00};
+static int rx_napi_weight = 64;
 
 MODULE_PARM(wanqos_en, "i");
 MODULE_PARM_DESC(wanqos_en, "WAN QoS support, 1 - enabled, 0 - disabled.");
@@ -51,6 +52,9 @@ MODULE_PARM_DESC(wanqos_en, "WAN QoS support, 1 - enabled, 0 - disabled.");
 MODULE_PARM_ARRAY(queue_gamma_map, "4-4i");
 MODULE_PARM_DESC(queue_gamma_map, "TX QoS queues mapping to 4 TX Gamma interfaces.");
 
+MODULE_PARM(rx_napi_weight, "i");
+MODULE_PARM_DESC(rx_napi_weight, "Number of RX frames handled per NAPI poll.");
+
 extern int (*ifx_mei_atm_showtime_enter)(struct port_cell_info *, void *);
 extern int (*ifx_mei_atm_showtime_exit)(void);
 extern int ifx_mei_atm_showtime_check(int *is_showtime, struct port_cell_info *port_cell, void **xdata_addr);
@@ -76,6 +80,11 @@ static int ptm_stop(struct net_device *);
   static unsigned int ptm_poll(int, unsigned int);
   static int ptm_napi_poll(struct napi_struct *, int);
 static int ptm_hard_start_xmit(struct sk_buff *, struct net_device *);
+#if LINUX_VERSION_CODE < KERNEL_VERSION(5,2,0)
+static u16 ptm_select_queue(struct net_device *, struct sk_buff *, struct net_device *, select_queue_fallback_t);
+#else
+static u16 ptm_select_queue(struct net_device *, struct sk_buff *, struct net_device *);
+#endif
 static int ptm_ioctl(struct net_device *, struct ifreq *, int);
 #if LINUX_VERSION_CODE < KERNEL_VERSION(5,6,0)
 static void ptm_tx_timeout(struct net_device *);
@@ -84,7 +93,10 @@ static void ptm_tx_timeout(struct net_device *, unsigned int txqueue);
 #endif
 
 static inline struct sk_buff* alloc_skb_rx(void);
-static inline struct sk_buff* alloc_skb_tx(unsigned int);
+static void buf_pool_skb_destructor(struct sk_buff *);
+static struct sk_buff *buf_pool_get(void);
+static void buf_pool_put(struct sk_buff *);
+static void buf_pool_refill(void);
 static inline struct sk_buff *get_skb_pointer(unsigned int);
 static inline int get_tx_desc(unsigned int, unsigned int *);
 
@@ -98,6 +110,12 @@ static irqreturn_t mailbox_irq_handler(int, void *);
  */
 static void do_swap_desc_tasklet(unsigned long);
 
+/*
+ *  BQL state of frames handed to PP32
+ */
+#define PTM_SKB_BQL_EPOCH(skb)  (*(unsigned int *)(skb)->cb)
+static void ptm_tx_reset_queues(struct net_device *);
+
 
 /*
  *  Init & clean-up functions
@@ -118,6 +136,7 @@ static struct net_device_ops g_ptm_netdev_ops = {
     .ndo_open            = ptm_open,
     .ndo_stop            = ptm_stop,
     .ndo_start_xmit      = ptm_hard_start_xmit,
+    .ndo_select_queue    = ptm_select_queue,
     .ndo_validate_addr   = eth_validate_addr,
     .ndo_set_mac_address = eth_mac_addr,
     .ndo_do_ioctl        = ptm_ioctl,
@@ -154,9 +173,9 @@ static void ptm_setup(struct net_device *dev, int ndev)
     /* Allow up to 1508 bytes, for RFC4638 */
     dev->max_mtu         = ETH_DATA_LEN + 8;
 #if (LINUX_VERSION_CODE < KERNEL_VERSION(5,19,0))
-    netif_napi_add(dev, &g_ptm_priv_data.itf[ndev].napi, ptm_napi_poll, 16);
+    netif_napi_add(dev, &g_ptm_priv_data.itf[ndev].napi, ptm_napi_poll, rx_napi_weight);
 #else
-    netif_napi_add_weight(dev, &g_ptm_priv_data.itf[ndev].napi, ptm_napi_poll, 16);
+    netif_napi_add_weight(dev, &g_ptm_priv_data.itf[ndev].napi, ptm_napi_poll, rx_napi_weight);
 #endif
     dev->watchdog_timeo  = ETH_WATCHDOG_TIMEOUT;
 
@@ -188,7 +207,8 @@ static int ptm_open(struct net_device *dev)
 
     IFX_REG_W32_MASK(0, 1, MBOX_IGU1_IER);
 
-    netif_start_queue(dev);
+    ptm_tx_reset_queues(dev);
+    netif_tx_start_all_queues(dev);
 
     return 0;
 }
@@ -201,7 +221,8 @@ static int ptm_stop(struct net_device *dev)
 
     napi_disable(&g_ptm_priv_data.itf[0].napi);
 
-    netif_stop_queue(dev);
+    netif_tx_stop_all_queues(dev);
+    ptm_tx_reset_queues(dev);
 
     return 0;
 }
@@ -226,8 +247,10 @@ static unsigned int ptm_poll(int ndev, unsigned int work_to_do)
         skb = get_skb_pointer(reg_desc.dataptr);
         ASSERT(skb != NULL, "invalid pointer skb == NULL");
 
-        new_skb = alloc_skb_rx();
+        new_skb = buf_pool_get();
         if ( new_skb != NULL ) {
+            //  buffer leaves the pool
+            skb->destructor = NULL;
             skb_reserve(skb, reg_desc.byteoff);
             skb_put(skb, reg_desc.datalen);
 
@@ -235,7 +258,7 @@ static unsigned int ptm_poll(int ndev, unsigned int work_to_do)
             skb->dev = g_net_dev[0];
             skb->protocol = eth_type_trans(skb, skb->dev);
 
-            netif_receive_skb(skb);
+            napi_gro_receive(&g_ptm_priv_data.itf[0].napi, skb);
 
             g_ptm_priv_data.itf[0].stats.rx_packets++;
             g_ptm_priv_data.itf[0].stats.rx_bytes += reg_desc.datalen;
@@ -265,10 +288,11 @@ static int ptm_napi_poll(struct napi_struct *napi, int budget)
     unsigned int work_done;
 
     work_done = ptm_poll(ndev, budget);
+    buf_pool_refill();
 
     //  interface down
     if ( !netif_running(napi->dev) ) {
-        napi_complete(napi);
+        napi_complete_done(napi, work_done);
         return work_done;
     }
 
@@ -276,7 +300,7 @@ static int ptm_napi_poll(struct napi_struct *napi, int budget)
     IFX_REG_W32_MASK(0, 1, MBOX_IGU1_ISRC);
     //  no more traffic
     if (work_done < budget) {
-	napi_complete(napi);
+	napi_complete_done(napi, work_done);
         IFX_REG_W32_MASK(0, 1, MBOX_IGU1_IER);
         return work_done;
     }
@@ -304,8 +328,9 @@ static int ptm_hard_start_xmit(struct sk_buff *skb, struct net_device *dev)
     /*  allocate descriptor */
     desc_base = get_tx_desc(0, &f_full);
     if ( f_full ) {
+        //  all QoS queues share the CPU to WAN descriptor ring
         netif_trans_update(dev);
-        netif_stop_queue(dev);
+        netif_tx_stop_all_queues(dev);
 
         IFX_REG_W32_MASK(0, 1 << 17, MBOX_IGU1_ISRC);
         IFX_REG_W32_MASK(0, 1 << 17, MBOX_IGU1_IER);
@@ -314,6 +339,9 @@ static int ptm_hard_start_xmit(struct sk_buff *skb, struct net_device *dev)
         goto PTM_HARD_START_XMIT_FAIL;
     desc = &CPU_TO_WAN_TX_DESC_BASE[desc_base];
 
+    /* make the skb unowned */
+    skb_orphan(skb);
+
     byteoff = (unsigned int)skb->data & (DATA_BUFFER_ALIGNMENT - 1);
     if ( skb_headroom(skb) < sizeof(struct sk_buff *) + byteoff || skb_cloned(skb) ) {
         struct sk_buff *new_skb;
@@ -321,13 +349,15 @@ static int ptm_hard_start_xmit(struct sk_buff *skb, struct net_device *dev)
         ASSERT(skb_headroom(skb) >= sizeof(struct sk_buff *) + byteoff, "skb_headroom(skb) < sizeof(struct sk_buff *) + byteoff");
         ASSERT(!skb_cloned(skb), "skb is cloned");
 
-        new_skb = alloc_skb_tx(skb->len);
+        //  copy goes back to the pool once PP32 returns it as swap buffer
+        new_skb = buf_pool_get();
         if ( new_skb == NULL ) {
             dbg("no memory");
             goto ALLOC_SKB_TX_FAIL;
         }
         skb_put(new_skb, skb->len);
         memcpy(new_skb->data, skb->data, skb->len);
+        skb_set_queue_mapping(new_skb, skb_get_queue_mapping(skb));
         dev_kfree_skb_any(skb);
         skb = new_skb;
         byteoff = (unsigned int)skb->data & (DATA_BUFFER_ALIGNMENT - 1);
@@ -335,23 +365,20 @@ static int ptm_hard_start_xmit(struct sk_buff *skb, struct net_device *dev)
         dma_cache_wback((unsigned long)skb->data, skb->len);
     }
 
-    /* make the skb unowned */
-    skb_orphan(skb);
-
     *(struct sk_buff **)((unsigned int)skb->data - byteoff - sizeof(struct sk_buff *)) = skb;
     /*  write back to physical memory   */
     dma_cache_wback((unsigned long)skb->data - byteoff - sizeof(struct sk_buff *), skb->len + byteoff + sizeof(struct sk_buff *));
 
-    /*  free previous skb   */
+    /*  free previous skb, swap buffers go back to the pool */
     skb_to_free = get_skb_pointer(desc->dataptr);
     if ( skb_to_free != NULL )
-        dev_kfree_skb_any(skb_to_free);
+        buf_pool_put(skb_to_free);
 
     /*  update descriptor   */
     reg_desc.small   = 0;
     reg_desc.dataptr = (unsigned int)skb->data & (0x0FFFFFFF ^ (DATA_BUFFER_ALIGNMENT - 1));
     reg_desc.datalen = skb->len < ETH_ZLEN ? ETH_ZLEN : skb->len;
-    reg_desc.qid     = g_ptm_prio_queue_map[skb->priority > 7 ? 7 : skb->priority];
+    reg_desc.qid     = skb_get_queue_mapping(skb);
     reg_desc.byteoff = byteoff;
     reg_desc.own     = 1;
     reg_desc.c       = 1;
@@ -361,6 +388,12 @@ static int ptm_hard_start_xmit(struct sk_buff *skb, struct net_device *dev)
     g_ptm_priv_data.itf[0].stats.tx_packets++;
     g_ptm_priv_data.itf[0].stats.tx_bytes += reg_desc.datalen;
 
+    /*  completed in do_swap_desc_tasklet once PP32 returns the skb    */
+    spin_lock(&g_ptm_priv_data.bql_lock);
+    PTM_SKB_BQL_EPOCH(skb) = g_ptm_priv_data.bql_epoch;
+    netdev_tx_sent_queue(netdev_get_tx_queue(dev, reg_desc.qid), skb->len);
+    spin_unlock(&g_ptm_priv_data.bql_lock);
+
     /*  write discriptor to memory  */
     *((volatile unsigned int *)desc + 1) = *((unsigned int *)&reg_desc + 1);
     wmb();
@@ -377,6 +410,16 @@ PTM_HARD_START_XMIT_FAIL:
     return 0;
 }
 
+#if LINUX_VERSION_CODE < KERNEL_VERSION(5,2,0)
+static u16 ptm_select_queue(struct net_device *dev, struct sk_buff *skb, struct net_device *sb_dev, select_queue_fallback_t fallback)
+#else
+static u16 ptm_select_queue(struct net_device *dev, struct sk_buff *skb, struct net_device *sb_dev)
+#endif
+{
+    //  one TX queue per PTM QoS queue, picked by packet priority
+    return g_ptm_prio_queue_map[skb->priority > 7 ? 7 : skb->priority];
+}
+
 static int ptm_ioctl(struct net_device *dev, struct ifreq *ifr, int cmd)
 {
     ASSERT(dev == g_net_dev[0], "incorrect device");
@@ -477,12 +520,27 @@ static void ptm_tx_timeout(struct net_device *dev, unsigned int txqueue)
     /*  disable TX irq, release skb when sending new packet */
     IFX_REG_W32_MASK(1 << 17, 0, MBOX_IGU1_IER);
 
+    /*  frames PP32 did not return must not keep BQL stopped    */
+    ptm_tx_reset_queues(dev);
+
     /*  wake up TX queue    */
-    netif_wake_queue(dev);
+    netif_tx_wake_all_queues(dev);
 
     return;
 }
 
+static void ptm_tx_reset_queues(struct net_device *dev)
+{
+    unsigned int i;
+
+    spin_lock_bh(&g_ptm_priv_data.bql_lock);
+    //  frames still held by PP32 are not completed against the new state
+    g_ptm_priv_data.bql_epoch++;
+    for ( i = 0; i < dev->num_tx_queues; i++ )
+        netdev_tx_reset_queue(netdev_get_tx_queue(dev, i));
+    spin_unlock_bh(&g_ptm_priv_data.bql_lock);
+}
+
 static inline struct sk_buff* alloc_skb_rx(void)
 {
     struct sk_buff *skb;
@@ -498,27 +556,74 @@ static inline struct sk_buff* alloc_skb_rx(void)
         wmb();
         /*  write back and invalidate cache    */
         dma_cache_wback_inv((unsigned long)skb->data - sizeof(skb), sizeof(skb));
-        /*  invalidate cache    */
-        dma_cache_inv((unsigned long)skb->data, (unsigned int)skb->end - (unsigned int)skb->data);
+        /*  invalidate cache, only the area PP32 may write to   */
+        dma_cache_inv((unsigned long)skb->data, RX_MAX_BUFFER_SIZE);
+        /*  mark buffer as owned by the pool    */
+        skb->destructor = buf_pool_skb_destructor;
     }
 
     return skb;
 }
 
-static inline struct sk_buff* alloc_skb_tx(unsigned int size)
+static void buf_pool_skb_destructor(struct sk_buff *skb)
+{
+    //  only used as a tag for buffers owned by the pool, nothing to release
+}
+
+static void buf_pool_add(struct sk_buff *skb)
+{
+    skb_queue_tail(&g_ptm_priv_data.buf_pool, skb);
+
+    //  swap tasklet ran dry, let it continue now
+    if ( g_ptm_priv_data.swap_desc_starved ) {
+        g_ptm_priv_data.swap_desc_starved = 0;
+        tasklet_hi_schedule(&g_swap_desc_tasklet);
+    }
+}
+
+static struct sk_buff *buf_pool_get(void)
 {
     struct sk_buff *skb;
 
-    /*  allocate memory including padding   */
-    size = RX_MAX_BUFFER_SIZE;
-    size = (size + DATA_BUFFER_ALIGNMENT - 1) & ~(DATA_BUFFER_ALIGNMENT - 1);
-    skb = dev_alloc_skb(size + DATA_BUFFER_ALIGNMENT);
-    /*  must be burst length alignment  */
-    if ( skb != NULL )
-        skb_reserve(skb, ~((unsigned int)skb->data + (DATA_BUFFER_ALIGNMENT - 1)) & (DATA_BUFFER_ALIGNMENT - 1));
+    skb = skb_dequeue(&g_ptm_priv_data.buf_pool);
+    if ( skb == NULL )
+        skb = alloc_skb_rx();
+
     return skb;
 }
 
+static void buf_pool_put(struct sk_buff *skb)
+{
+    if ( skb->destructor != buf_pool_skb_destructor || skb_cloned(skb)
+      || skb_queue_len(&g_ptm_priv_data.buf_pool) >= BUF_POOL_SIZE ) {
+        dev_kfree_skb_any(skb);
+        return;
+    }
+
+    /*  the rest of the buffer is still invalidated since allocation,
+     *  so only drop the bytes the CPU has touched in between           */
+    dma_cache_wback_inv((unsigned long)skb->data - sizeof(skb), skb->len + sizeof(skb));
+    //  data pointer of pool buffers is never moved, just reset the length
+    __skb_trim(skb, 0);
+
+    buf_pool_add(skb);
+}
+
+static void buf_pool_refill(void)
+{
+    struct sk_buff *skb;
+
+    if ( skb_queue_len(&g_ptm_priv_data.buf_pool) >= BUF_POOL_LOW_WATERMARK )
+        return;
+
+    while ( skb_queue_len(&g_ptm_priv_data.buf_pool) < BUF_POOL_SIZE ) {
+        skb = alloc_skb_rx();
+        if ( skb == NULL )
+            break;
+        buf_pool_add(skb);
+    }
+}
+
 static inline struct sk_buff *get_skb_pointer(unsigned int dataptr)
 {
     unsigned int skb_dataptr;
@@ -588,7 +693,7 @@ static irqreturn_t mailbox_irq_handler(int irq, void *dev_id)
             }
 	    if (isr & BIT(17)) {
                 IFX_REG_W32_MASK(1 << 17, 0, MBOX_IGU1_IER);
-                netif_wake_queue(g_net_dev[0]);
+                netif_tx_wake_all_queues(g_net_dev[0]);
         	}
 
     return IRQ_HANDLED;
@@ -599,30 +704,56 @@ static void do_swap_desc_tasklet(unsigned long arg)
     int budget = 32;
     volatile struct tx_descriptor *desc;
     struct sk_buff *skb;
-    unsigned int byteoff;
+    unsigned int pkts[8] = {0}, bytes[8] = {0};
+    unsigned int qid;
+
+    spin_lock(&g_ptm_priv_data.bql_lock);
 
     while ( budget-- > 0 ) {
 	if ( WAN_SWAP_DESC_BASE[g_ptm_priv_data.itf[0].tx_swap_desc_pos].own )  //  if PP32 hold descriptor
             break;
 
         desc = &WAN_SWAP_DESC_BASE[g_ptm_priv_data.itf[0].tx_swap_desc_pos];
-        if ( ++g_ptm_priv_data.itf[0].tx_swap_desc_pos == WAN_SWAP_DESC_NUM )
-            g_ptm_priv_data.itf[0].tx_swap_desc_pos = 0;
 
         skb = get_skb_pointer(desc->dataptr);
-        if ( skb != NULL )
-            dev_kfree_skb_any(skb);
+        if ( skb != NULL ) {
+            desc->dataptr = 0;
+            //  frames from ptm_hard_start_xmit come back here once sent,
+            //  empty swap buffers do not carry any data, frames queued
+            //  before the last BQL reset are not accounted any more
+            qid = skb_get_queue_mapping(skb);
+            if ( skb->len != 0 && qid < ARRAY_SIZE(pkts)
+              && PTM_SKB_BQL_EPOCH(skb) == g_ptm_priv_data.bql_epoch ) {
+                pkts[qid]++;
+                bytes[qid] += skb->len;
+            }
+            buf_pool_put(skb);
+        }
 
-        skb = alloc_skb_tx(RX_MAX_BUFFER_SIZE);
-        if ( skb == NULL )
-            panic("can't allocate swap buffer for PPE firmware use\n");
-        byteoff = (unsigned int)skb->data & (DATA_BUFFER_ALIGNMENT - 1);
-        *(struct sk_buff **)((unsigned int)skb->data - byteoff - sizeof(struct sk_buff *)) = skb;
+        skb = buf_pool_get();
+        if ( skb == NULL ) {
+            //  keep descriptor and interrupt disabled until pool gets buffers
+            g_ptm_priv_data.swap_desc_starved = 1;
+            err("no swap buffer for PPE firmware use");
+            break;
+        }
+
+        if ( ++g_ptm_priv_data.itf[0].tx_swap_desc_pos == WAN_SWAP_DESC_NUM )
+            g_ptm_priv_data.itf[0].tx_swap_desc_pos = 0;
 
         desc->dataptr = (unsigned int)skb->data & 0x0FFFFFFF;
         desc->own = 1;
     }
 
+    for ( qid = 0; qid < ARRAY_SIZE(pkts); qid++ )
+        if ( pkts[qid] != 0 )
+            netdev_tx_completed_queue(netdev_get_tx_queue(g_net_dev[0], qid), pkts[qid], bytes[qid]);
+
+    spin_unlock(&g_ptm_priv_data.bql_lock);
+
+    if ( g_ptm_priv_data.swap_desc_starved )
+        return;
+
     //  clear interrupt
     IFX_REG_W32_MASK(0, 16, MBOX_IGU1_ISRC);
     //  no more skb to be replaced
@@ -660,6 +791,9 @@ static inline int init_priv_data(void)
     if ( g_wanqos_en > 8 )
         g_wanqos_en = 8;
 
+    if ( rx_napi_weight <= 0 || rx_napi_weight > NAPI_POLL_WEIGHT )
+        rx_napi_weight = NAPI_POLL_WEIGHT;
+
     for ( i = 0; i < ARRAY_SIZE(g_queue_gamma_map); i++ )
     {
         g_queue_gamma_map[i] = queue_gamma_map[i] & ((1 << g_wanqos_en) - 1);
@@ -668,6 +802,8 @@ static inline int init_priv_data(void)
     }
 
     memset(&g_ptm_priv_data, 0, sizeof(g_ptm_priv_data));
+    skb_queue_head_init(&g_ptm_priv_data.buf_pool);
+    spin_lock_init(&g_ptm_priv_data.bql_lock);
 
     {
         int max_packet_priority = ARRAY_SIZE(g_ptm_prio_queue_map);
@@ -713,6 +849,9 @@ static inline int init_tables(void)
             goto ALLOC_SKB_RX_FAIL;
     }
 
+    //  spare buffers for RX refill and swap descriptors, may stay short
+    buf_pool_refill();
+
     cfg_std_data_len.byte_off = RX_HEAD_MAC_ADDR_ALIGNMENT; //  this field replaces byte_off in rx descriptor of VDSL ingress
     cfg_std_data_len.data_len = 1600;
     *CFG_STD_DATA_LEN = cfg_std_data_len;
@@ -912,6 +1051,8 @@ static inline void clear_tables(void)
         if ( skb != NULL )
             dev_kfree_skb_any(skb);
     }
+
+    skb_queue_purge(&g_ptm_priv_data.buf_pool);
 }
 
 static int ptm_showtime_enter(struct port_cell_info *port_cell, void *xdata_addr)
@@ -953,8 +1094,11 @@ static int ptm_showtime_exit(void)
 
 	IFX_REG_W32(0x00, UTP_CFG);
 
-	for ( i = 0; i < ARRAY_SIZE(g_net_dev); i++ )
+	for ( i = 0; i < ARRAY_SIZE(g_net_dev); i++ ) {
 		netif_carrier_off(g_net_dev[i]);
+		//  PP32 may never return the frames queued so far
+		ptm_tx_reset_queues(g_net_dev[i]);
+	}
 
 	g_showtime = 0;
 
@@ -1001,7 +1145,7 @@ static int ltq_ptm_probe(struct platform_device *pdev)
     }
 
     for ( i = 0; i < ARRAY_SIZE(g_net_dev); i++ ) {
-        g_net_dev[i] = alloc_netdev(0, g_net_dev_name[i], NET_NAME_UNKNOWN, ether_setup);
+        g_net_dev[i] = alloc_netdev_mqs(0, g_net_dev_name[i], NET_NAME_UNKNOWN, ether_setup, g_wanqos_en, 1);
         if ( g_net_dev[i] == NULL )
             goto ALLOC_NETDEV_FAIL;
         ptm_setup(g_net_dev[i], i);
@@ -75,6 +75,12 @@
                                             //  The len in descriptor doesn't include ETH_CRC
                                             //  because ETH_CRC may not present in some configuration
 
+/*
+ *  Buffer Pool (RX and swap descriptors)
+ */
+#define BUF_POOL_SIZE                   64
+#define BUF_POOL_LOW_WATERMARK          16
+
 
 
 /*
@@ -98,6 +104,12 @@ struct ptm_itf {
 struct ptm_priv_data {
     struct ptm_itf                  itf[MAX_ITF_NUMBER];
     int                             irq;
+
+    struct sk_buff_head             buf_pool;
+    int                             swap_desc_starved;
+
+    spinlock_t                      bql_lock;
+    unsigned int                    bql_epoch;
 };
 
 
@@ -160,62 +160,180 @@ print_attr_val(const struct switch_attr *attr, const struct switch_val *val)
 	}
 }
 
-static void
-show_attrs(struct switch_dev *dev, struct switch_attr *attr, struct switch_val *val)
+static int
+count_attrs(struct switch_attr *attr, const struct switch_attr *skip)
 {
-	while (attr) {
-		if (attr->type != SWITCH_TYPE_NOVAL) {
-			printf("\t%s: ", attr->name);
-			if (swlib_get_attr(dev, attr, val) < 0)
-				printf("???");
-			else {
-				print_attr_val(attr, val);
-				free_attr_val(attr, val);
-			}
-			putchar('\n');
-		}
-		attr = attr->next;
+	int n = 0;
+
+	for (; attr; attr = attr->next)
+		if (attr->type != SWITCH_TYPE_NOVAL && attr != skip)
+			n++;
+
+	return n;
+}
+
+static struct switch_val *
+add_attr_vals(struct switch_val *val, struct switch_attr *attr, int port_vlan,
+	      const struct switch_attr *skip)
+{
+	for (; attr; attr = attr->next) {
+		if (attr->type == SWITCH_TYPE_NOVAL || attr == skip)
+			continue;
+
+		val->attr = attr;
+		val->port_vlan = port_vlan;
+		val++;
 	}
+
+	return val;
 }
 
 static void
-show_global(struct switch_dev *dev)
+print_attr_line(const struct switch_val *val)
 {
-	struct switch_val val;
+	printf("\t%s: ", val->attr->name);
+	if (val->err < 0)
+		printf("???");
+	else
+		print_attr_val(val->attr, val);
+	putchar('\n');
+}
 
-	printf("Global attributes:\n");
-	show_attrs(dev, dev->ops, &val);
+static void
+print_attr_vals(const struct switch_val *val, int n)
+{
+	int i;
+
+	for (i = 0; i < n; i++, val++)
+		print_attr_line(val);
 }
 
 static void
-show_port(struct switch_dev *dev, int port)
+free_attr_vals(const struct switch_val *val, int n)
 {
-	struct switch_val val;
+	int i;
+
+	for (i = 0; i < n; i++, val++)
+		free_attr_val(val->attr, val);
+}
+
+static bool
+vlan_in_use(const struct switch_val *ports)
+{
+	/* without a "ports" attribute every vlan is shown */
+	return !ports || (ports->err >= 0 && ports->len);
+}
+
+static void
+show_attrs(struct switch_dev *dev, struct switch_attr *attr, int port_vlan)
+{
+	struct switch_val *vals;
+	int n = count_attrs(attr, NULL);
+
+	vals = calloc(n, sizeof(*vals));
+	if (!vals)
+		return;
 
+	add_attr_vals(vals, attr, port_vlan, NULL);
+	swlib_get_attrs(dev, vals, n);
+	print_attr_vals(vals, n);
+	free_attr_vals(vals, n);
+	free(vals);
+}
+
+static void
+show_port(struct switch_dev *dev, int port)
+{
 	printf("Port %d:\n", port);
-	val.port_vlan = port;
-	show_attrs(dev, dev->port_ops, &val);
+	show_attrs(dev, dev->port_ops, port);
 }
 
 static void
-show_vlan(struct switch_dev *dev, int vlan, bool all)
+show_vlan(struct switch_dev *dev, int vlan)
 {
-	struct switch_val val;
-	struct switch_attr *attr;
+	printf("VLAN %d:\n", vlan);
+	show_attrs(dev, dev->vlan_ops, vlan);
+}
+
+static void
+show_all(struct switch_dev *dev)
+{
+	struct switch_attr *ports, *attr;
+	struct switch_val *vals, *val, *vlan_ports, *vlan_vals;
+	int n_global = count_attrs(dev->ops, NULL);
+	int n_port = count_attrs(dev->port_ops, NULL);
+	int n_vlan, n_used = 0;
+	int i, n;
+
+	/*
+	 * Fetch everything in as few requests as possible: the global and
+	 * port attributes plus the member ports of every vlan first, then the
+	 * remaining vlan attributes only for the vlans that are in use.
+	 */
+	ports = swlib_lookup_attr(dev, SWLIB_ATTR_GROUP_VLAN, "ports");
+	n_vlan = count_attrs(dev->vlan_ops, ports);
+
+	n = n_global + dev->ports * n_port + (ports ? dev->vlans : 0);
+	vals = calloc(n, sizeof(*vals));
+	if (!vals)
+		return;
+
+	val = add_attr_vals(vals, dev->ops, 0, NULL);
+	for (i = 0; i < dev->ports; i++)
+		val = add_attr_vals(val, dev->port_ops, i, NULL);
+	vlan_ports = val;
+	for (i = 0; ports && i < dev->vlans; i++, val++) {
+		val->attr = ports;
+		val->port_vlan = i;
+	}
+
+	swlib_get_attrs(dev, vals, n);
 
-	val.port_vlan = vlan;
+	for (i = 0; i < dev->vlans; i++)
+		if (vlan_in_use(ports ? &vlan_ports[i] : NULL))
+			n_used++;
 
-	if (all) {
-		attr = swlib_lookup_attr(dev, SWLIB_ATTR_GROUP_VLAN, "ports");
-		if (swlib_get_attr(dev, attr, &val) < 0)
-			return;
+	vlan_vals = calloc(n_used * n_vlan + 1, sizeof(*vlan_vals));
+	if (!vlan_vals)
+		goto out;
+
+	val = vlan_vals;
+	for (i = 0; i < dev->vlans; i++)
+		if (vlan_in_use(ports ? &vlan_ports[i] : NULL))
+			val = add_attr_vals(val, dev->vlan_ops, i, ports);
+
+	if (n_used * n_vlan)
+		swlib_get_attrs(dev, vlan_vals, n_used * n_vlan);
+
+	printf("Global attributes:\n");
+	print_attr_vals(vals, n_global);
 
-		if (!val.len)
-			return;
+	val = vals + n_global;
+	for (i = 0; i < dev->ports; i++, val += n_port) {
+		printf("Port %d:\n", i);
+		print_attr_vals(val, n_port);
 	}
 
-	printf("VLAN %d:\n", vlan);
-	show_attrs(dev, dev->vlan_ops, &val);
+	/* print in attribute order, with "ports" taken from the first pass */
+	val = vlan_vals;
+	for (i = 0; i < dev->vlans; i++) {
+		if (!vlan_in_use(ports ? &vlan_ports[i] : NULL))
+			continue;
+
+		printf("VLAN %d:\n", i);
+		for (attr = dev->vlan_ops; attr; attr = attr->next) {
+			if (attr->type == SWITCH_TYPE_NOVAL)
+				continue;
+
+			print_attr_line(attr == ports ? &vlan_ports[i] : val++);
+		}
+	}
+
+	free_attr_vals(vlan_vals, n_used * n_vlan);
+	free(vlan_vals);
+out:
+	free_attr_vals(vals, n);
+	free(vals);
 }
 
 static void
@@ -387,18 +505,12 @@ int main(int argc, char **argv)
 		swlib_print_portmap(dev, csegment);
 		break;
 	case CMD_SHOW:
-		if (cport >= 0 || cvlan >= 0) {
-			if (cport >= 0)
-				show_port(dev, cport);
-			else
-				show_vlan(dev, cvlan, false);
-		} else {
-			show_global(dev);
-			for (i=0; i < dev->ports; i++)
-				show_port(dev, i);
-			for (i=0; i < dev->vlans; i++)
-				show_vlan(dev, i, true);
-		}
+		if (cport >= 0)
+			show_port(dev, cport);
+		else if (cvlan >= 0)
+			show_vlan(dev, cvlan);
+		else
+			show_all(dev);
 		break;
 	}
 
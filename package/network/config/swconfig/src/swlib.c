@@ -20,6 +20,7 @@
 #include <inttypes.h>
 #include <errno.h>
 #include <stdint.h>
+#include <stdbool.h>
 #include <getopt.h>
 #include <sys/types.h>
 #include <sys/socket.h>
@@ -41,6 +42,7 @@ static struct nl_cache *cache;
 static struct genl_family *family;
 static struct nlattr *tb[SWITCH_ATTR_MAX + 1];
 static int refcount = 0;
+static int bulk_unsupported = 0;
 
 static struct nla_policy port_policy[SWITCH_ATTR_MAX] = {
 	[SWITCH_PORT_ID] = { .type = NLA_U32 },
@@ -243,6 +245,23 @@ out:
 	return err;
 }
 
+static int
+store_val_attrs(struct nl_msg *msg, struct nlattr **tb, struct switch_val *val)
+{
+	int err = 0;
+
+	if (tb[SWITCH_ATTR_OP_VALUE_INT])
+		val->value.i = nla_get_u32(tb[SWITCH_ATTR_OP_VALUE_INT]);
+	else if (tb[SWITCH_ATTR_OP_VALUE_STR])
+		val->value.s = strdup(nla_get_string(tb[SWITCH_ATTR_OP_VALUE_STR]));
+	else if (tb[SWITCH_ATTR_OP_VALUE_PORTS])
+		err = store_port_val(msg, tb[SWITCH_ATTR_OP_VALUE_PORTS], val);
+	else if (tb[SWITCH_ATTR_OP_VALUE_LINK])
+		err = store_link_val(msg, tb[SWITCH_ATTR_OP_VALUE_LINK], val);
+
+	return err;
+}
+
 static int
 store_val(struct nl_msg *msg, void *arg)
 {
@@ -257,15 +276,7 @@ store_val(struct nl_msg *msg, void *arg)
 		goto error;
 	}
 
-	if (tb[SWITCH_ATTR_OP_VALUE_INT])
-		val->value.i = nla_get_u32(tb[SWITCH_ATTR_OP_VALUE_INT]);
-	else if (tb[SWITCH_ATTR_OP_VALUE_STR])
-		val->value.s = strdup(nla_get_string(tb[SWITCH_ATTR_OP_VALUE_STR]));
-	else if (tb[SWITCH_ATTR_OP_VALUE_PORTS])
-		val->err = store_port_val(msg, tb[SWITCH_ATTR_OP_VALUE_PORTS], val);
-	else if (tb[SWITCH_ATTR_OP_VALUE_LINK])
-		val->err = store_link_val(msg, tb[SWITCH_ATTR_OP_VALUE_LINK], val);
-
+	store_val_attrs(msg, tb, val);
 	val->err = 0;
 	return 0;
 
@@ -273,25 +284,30 @@ error:
 	return NL_SKIP;
 }
 
-int
-swlib_get_attr(struct switch_dev *dev, struct switch_attr *attr, struct switch_val *val)
+static int
+attr_cmd(struct switch_attr *attr, bool set)
 {
-	int cmd;
-	int err;
-
 	switch(attr->atype) {
 	case SWLIB_ATTR_GROUP_GLOBAL:
-		cmd = SWITCH_CMD_GET_GLOBAL;
-		break;
+		return set ? SWITCH_CMD_SET_GLOBAL : SWITCH_CMD_GET_GLOBAL;
 	case SWLIB_ATTR_GROUP_PORT:
-		cmd = SWITCH_CMD_GET_PORT;
-		break;
+		return set ? SWITCH_CMD_SET_PORT : SWITCH_CMD_GET_PORT;
 	case SWLIB_ATTR_GROUP_VLAN:
-		cmd = SWITCH_CMD_GET_VLAN;
-		break;
+		return set ? SWITCH_CMD_SET_VLAN : SWITCH_CMD_GET_VLAN;
 	default:
 		return -EINVAL;
 	}
+}
+
+int
+swlib_get_attr(struct switch_dev *dev, struct switch_attr *attr, struct switch_val *val)
+{
+	int cmd;
+	int err;
+
+	cmd = attr_cmd(attr, false);
+	if (cmd < 0)
+		return cmd;
 
 	memset(&val->value, 0, sizeof(val->value));
 	val->len = 0;
@@ -404,24 +420,172 @@ swlib_set_attr(struct switch_dev *dev, struct switch_attr *attr, struct switch_v
 {
 	int cmd;
 
-	switch(attr->atype) {
-	case SWLIB_ATTR_GROUP_GLOBAL:
-		cmd = SWITCH_CMD_SET_GLOBAL;
-		break;
-	case SWLIB_ATTR_GROUP_PORT:
-		cmd = SWITCH_CMD_SET_PORT;
-		break;
-	case SWLIB_ATTR_GROUP_VLAN:
-		cmd = SWITCH_CMD_SET_VLAN;
-		break;
-	default:
-		return -EINVAL;
-	}
+	cmd = attr_cmd(attr, true);
+	if (cmd < 0)
+		return cmd;
 
 	val->attr = attr;
 	return swlib_call(cmd, NULL, send_attr_val, val);
 }
 
+struct bulk_arg {
+	struct switch_dev *dev;
+	struct switch_val *vals;
+	bool set;
+	int n;
+	int start;
+	int end;
+	int received;
+};
+
+static int
+send_bulk(struct nl_msg *msg, void *arg)
+{
+	struct bulk_arg *b = arg;
+	int i;
+
+	NLA_PUT_U32(msg, SWITCH_ATTR_ID, b->dev->id);
+
+	/* add as many operations as fit into the message */
+	for (i = b->start; i < b->n; i++) {
+		struct switch_val *val = &b->vals[i];
+		uint32_t len = nlmsg_hdr(msg)->nlmsg_len;
+		struct nlattr *n;
+		int cmd;
+
+		cmd = attr_cmd(val->attr, b->set);
+		if (cmd < 0)
+			break;
+
+		n = nla_nest_start(msg, SWITCH_ATTR_OP);
+		if (!n)
+			break;
+
+		if (nla_put_u32(msg, SWITCH_ATTR_OP_CMD, cmd) < 0 ||
+		    nla_put_u32(msg, SWITCH_ATTR_OP_INDEX, i) < 0 ||
+		    (b->set ? send_attr_val(msg, val) : send_attr(msg, val)) < 0) {
+			/* drop the partial operation */
+			nlmsg_hdr(msg)->nlmsg_len = len;
+			break;
+		}
+		nla_nest_end(msg, n);
+	}
+
+	b->end = i;
+	if (b->end == b->start)
+		goto nla_put_failure;
+
+	return 0;
+
+nla_put_failure:
+	return -1;
+}
+
+static int
+store_bulk(struct nl_msg *msg, void *arg)
+{
+	struct genlmsghdr *gnlh = nlmsg_data(nlmsg_hdr(msg));
+	struct nlattr *op_tb[SWITCH_ATTR_MAX + 1];
+	struct bulk_arg *b = arg;
+	struct nlattr *nla;
+	int remaining;
+
+	nla_for_each_attr(nla, genlmsg_attrdata(gnlh, 0), genlmsg_attrlen(gnlh, 0), remaining) {
+		struct switch_val *val;
+		unsigned int idx;
+
+		if (nla_type(nla) != SWITCH_ATTR_OP)
+			continue;
+
+		if (nla_parse_nested(op_tb, SWITCH_ATTR_MAX - 1, nla, NULL) < 0)
+			continue;
+
+		if (!op_tb[SWITCH_ATTR_OP_INDEX])
+			continue;
+
+		idx = nla_get_u32(op_tb[SWITCH_ATTR_OP_INDEX]);
+		if (idx < b->start || idx >= b->end)
+			continue;
+
+		val = &b->vals[idx];
+		val->err = 0;
+		if (op_tb[SWITCH_ATTR_OP_ERR])
+			val->err = -(int)nla_get_u32(op_tb[SWITCH_ATTR_OP_ERR]);
+		if (!b->set && !val->err)
+			val->err = store_val_attrs(msg, op_tb, val);
+
+		b->received++;
+	}
+
+	return NL_SKIP;
+}
+
+static int
+swlib_bulk(struct switch_dev *dev, struct switch_val *vals, int n, bool set)
+{
+	struct bulk_arg b = {
+		.dev = dev,
+		.vals = vals,
+		.set = set,
+		.n = n,
+	};
+	int err = 0;
+	int i;
+
+	for (i = 0; i < n; i++) {
+		if (!set) {
+			memset(&vals[i].value, 0, sizeof(vals[i].value));
+			vals[i].len = 0;
+		}
+		vals[i].err = -EINVAL;
+	}
+
+	if (bulk_unsupported)
+		goto fallback;
+
+	while (b.start < n) {
+		b.end = b.start;
+		err = swlib_call(SWITCH_CMD_BULK, store_bulk, send_bulk, &b);
+		if (b.end == b.start) {
+			/* value could not be encoded, leave its error set */
+			b.start++;
+			continue;
+		}
+		if (err < 0 && !b.received)
+			goto fallback;
+		if (err < 0)
+			return err;
+
+		b.start = b.end;
+	}
+
+	return 0;
+
+fallback:
+	/* kernel without SWITCH_CMD_BULK, one request per value */
+	bulk_unsupported = 1;
+	for (i = b.start; i < n; i++) {
+		if (set)
+			vals[i].err = swlib_set_attr(dev, vals[i].attr, &vals[i]);
+		else
+			swlib_get_attr(dev, vals[i].attr, &vals[i]);
+	}
+
+	return 0;
+}
+
+int
+swlib_get_attrs(struct switch_dev *dev, struct switch_val *vals, int n)
+{
+	return swlib_bulk(dev, vals, n, false);
+}
+
+int
+swlib_set_attrs(struct switch_dev *dev, struct switch_val *vals, int n)
+{
+	return swlib_bulk(dev, vals, n, true);
+}
+
 enum {
 	CMD_NONE,
 	CMD_DUPLEX,
@@ -429,27 +593,30 @@ enum {
 	CMD_SPEED,
 };
 
-int swlib_set_attr_string(struct switch_dev *dev, struct switch_attr *a, int port_vlan, const char *str)
+int swlib_parse_attr_string(struct switch_dev *dev, struct switch_attr *a, int port_vlan,
+		const char *str, struct switch_val *val)
 {
 	struct switch_port *ports;
 	struct switch_port_link *link;
-	struct switch_val val;
 	char *ptr;
 	int cmd = CMD_NONE;
 
-	memset(&val, 0, sizeof(val));
-	val.port_vlan = port_vlan;
+	memset(val, 0, sizeof(*val));
+	val->attr = a;
+	val->port_vlan = port_vlan;
 	switch(a->type) {
 	case SWITCH_TYPE_INT:
-		val.value.i = atoi(str);
+		val->value.i = atoi(str);
 		break;
 	case SWITCH_TYPE_STRING:
-		val.value.s = (char *)str;
+		val->value.s = (char *)str;
 		break;
 	case SWITCH_TYPE_PORTS:
-		ports = alloca(sizeof(struct switch_port) * dev->ports);
-		memset(ports, 0, sizeof(struct switch_port) * dev->ports);
-		val.len = 0;
+		ports = swlib_alloc(sizeof(struct switch_port) * dev->ports);
+		if (!ports)
+			return -1;
+		val->value.ports = ports;
+		val->len = 0;
 		ptr = (char *)str;
 		while(ptr && *ptr)
 		{
@@ -460,30 +627,31 @@ int swlib_set_attr_string(struct switch_dev *dev, struct switch_attr *a, int por
 				break;
 
 			if (!isdigit(*ptr))
-				return -1;
+				goto error;
 
-			if (val.len >= dev->ports)
-				return -1;
+			if (val->len >= dev->ports)
+				goto error;
 
-			ports[val.len].flags = 0;
-			ports[val.len].id = strtoul(ptr, &ptr, 10);
+			ports[val->len].flags = 0;
+			ports[val->len].id = strtoul(ptr, &ptr, 10);
 			while(*ptr && !isspace(*ptr)) {
 				if (*ptr == 't')
-					ports[val.len].flags |= SWLIB_PORT_FLAG_TAGGED;
+					ports[val->len].flags |= SWLIB_PORT_FLAG_TAGGED;
 				else
-					return -1;
+					goto error;
 
 				ptr++;
 			}
 			if (*ptr)
 				ptr++;
-			val.len++;
+			val->len++;
 		}
-		val.value.ports = ports;
 		break;
 	case SWITCH_TYPE_LINK:
-		link = malloc(sizeof(struct switch_port_link));
-		memset(link, 0, sizeof(struct switch_port_link));
+		link = swlib_alloc(sizeof(struct switch_port_link));
+		if (!link)
+			return -1;
+		val->value.link = link;
 		ptr = (char *)str;
 		for (ptr = strtok(ptr," "); ptr; ptr = strtok(NULL, " ")) {
 			switch (cmd) {
@@ -521,17 +689,50 @@ int swlib_set_attr_string(struct switch_dev *dev, struct switch_attr *a, int por
 				break;
 			}
 		}
-		val.value.link = link;
 		break;
 	case SWITCH_TYPE_NOVAL:
 		if (str && !strcmp(str, "0"))
-			return 0;
+			return 1;
 
 		break;
 	default:
 		return -1;
 	}
-	return swlib_set_attr(dev, a, &val);
+	return 0;
+
+error:
+	swlib_free_attr_string(val);
+	return -1;
+}
+
+void swlib_free_attr_string(struct switch_val *val)
+{
+	switch(val->attr->type) {
+	case SWITCH_TYPE_PORTS:
+		free(val->value.ports);
+		break;
+	case SWITCH_TYPE_LINK:
+		free(val->value.link);
+		break;
+	default:
+		break;
+	}
+	val->value.ports = NULL;
+}
+
+int swlib_set_attr_string(struct switch_dev *dev, struct switch_attr *a, int port_vlan, const char *str)
+{
+	struct switch_val val;
+	int ret;
+
+	ret = swlib_parse_attr_string(dev, a, port_vlan, str, &val);
+	if (ret)
+		return ret < 0 ? ret : 0;
+
+	ret = swlib_set_attr(dev, a, &val);
+	swlib_free_attr_string(&val);
+
+	return ret;
 }
 
 
@@ -259,6 +259,44 @@ int swlib_set_attr_string(struct switch_dev *dev, struct switch_attr *attr,
 int swlib_get_attr(struct switch_dev *dev, struct switch_attr *attr,
 		struct switch_val *val);
 
+/**
+ * swlib_parse_attr_string: convert a string into an attribute value
+ * @dev: switch device struct
+ * @attr: switch attribute struct
+ * @port_vlan: port or vlan (if applicable)
+ * @str: string value
+ * @val: attribute value to fill in
+ * returns 0 on success, 1 if there is nothing to set
+ * the value must be released with swlib_free_attr_string
+ */
+int swlib_parse_attr_string(struct switch_dev *dev, struct switch_attr *attr,
+		int port_vlan, const char *str, struct switch_val *val);
+
+/**
+ * swlib_free_attr_string: free a value from swlib_parse_attr_string
+ * @val: attribute value pointer
+ */
+void swlib_free_attr_string(struct switch_val *val);
+
+/**
+ * swlib_get_attrs: get the values for multiple attributes at once
+ * @dev: switch device struct
+ * @vals: array of values with attr and port_vlan filled in
+ * @n: number of values
+ * returns 0 on success, the result of each value is stored in its err field
+ * for string attributes, the result strings must be freed by the caller
+ */
+int swlib_get_attrs(struct switch_dev *dev, struct switch_val *vals, int n);
+
+/**
+ * swlib_set_attrs: set the values for multiple attributes at once
+ * @dev: switch device struct
+ * @vals: array of values with attr, port_vlan and value filled in
+ * @n: number of values, applied in order
+ * returns 0 on success, the result of each value is stored in its err field
+ */
+int swlib_set_attrs(struct switch_dev *dev, struct switch_val *vals, int n);
+
 /**
  * swlib_apply_from_uci: set up the switch from a uci configuration
  * @dev: switch device struct
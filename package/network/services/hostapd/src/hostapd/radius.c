@@ -17,10 +17,14 @@
 #include <libubox/kvlist.h>
 
 #include <sys/stat.h>
+#include <sys/inotify.h>
 #include <fnmatch.h>
 
 #define VENDOR_ID_WISPR 14122
 #define VENDOR_ATTR_SIZE 6
+#define RADIUS_MAX_IDENTITY_LEN 512
+#define RADIUS_WILDCARD_SPECIAL "*?[]\\"
+#define RADIUS_USERFILE_RELOAD_DELAY 100000 /* usec */
 
 struct radius_parse_attr_data {
 	unsigned int vendor;
@@ -39,13 +43,37 @@ struct radius_parse_attr_state {
 
 struct radius_user_state {
 	struct avl_node node;
+	struct blob_attr *entry;
 	struct eap_user data;
 };
 
+/*
+ * Wildcard patterns are indexed by their literal prefix, or by their literal
+ * suffix if they start with a special character. A lookup only runs fnmatch
+ * on patterns from groups whose key matches the start or end of the name.
+ */
+struct radius_wildcard {
+	struct list_head list;
+	struct blob_attr *data;
+	const char *pattern;
+	int index;
+};
+
+struct radius_wildcard_group {
+	struct avl_node node;
+	struct list_head list;
+};
+
 struct radius_user_data {
 	struct kvlist users;
 	struct avl_tree user_state;
 	struct blob_attr *wildcard;
+
+	struct radius_wildcard *wildcard_list;
+	struct avl_tree wildcard_prefix;
+	struct avl_tree wildcard_suffix;
+	bool wildcard_prefix_len[RADIUS_MAX_IDENTITY_LEN + 1];
+	bool wildcard_suffix_len[RADIUS_MAX_IDENTITY_LEN + 1];
 };
 
 struct radius_state {
@@ -54,7 +82,9 @@ struct radius_state {
 
 	struct radius_user_data phase1, phase2;
 	const char *user_file;
+	const char *user_file_name;
 	time_t user_file_ts;
+	int inotify_fd;
 
 	int n_attrs;
 	struct hostapd_radius_attr *attrs;
@@ -115,21 +145,192 @@ static void radius_userdata_init(struct radius_user_data *u)
 {
 	kvlist_init(&u->users, kvlist_blob_len);
 	avl_init(&u->user_state, avl_strcmp, false, NULL);
+	avl_init(&u->wildcard_prefix, avl_strcmp, false, NULL);
+	avl_init(&u->wildcard_suffix, avl_strcmp, false, NULL);
 }
 
-static void radius_userdata_free(struct radius_user_data *u)
+static void radius_userdata_clear(struct radius_user_data *u)
 {
-	struct radius_user_state *s, *tmp;
+	struct radius_wildcard_group *g, *tmp;
 
 	kvlist_free(&u->users);
 	free(u->wildcard);
 	u->wildcard = NULL;
+
+	avl_remove_all_elements(&u->wildcard_prefix, g, node, tmp)
+		free(g);
+	avl_remove_all_elements(&u->wildcard_suffix, g, node, tmp)
+		free(g);
+	free(u->wildcard_list);
+	u->wildcard_list = NULL;
+	memset(u->wildcard_prefix_len, 0, sizeof(u->wildcard_prefix_len));
+	memset(u->wildcard_suffix_len, 0, sizeof(u->wildcard_suffix_len));
+}
+
+static void radius_userdata_free(struct radius_user_data *u)
+{
+	struct radius_user_state *s, *tmp;
+
+	radius_userdata_clear(u);
 	avl_remove_all_elements(&u->user_state, s, node, tmp)
 		free(s);
 }
 
 static void
-radius_userdata_load(struct radius_user_data *u, struct blob_attr *data)
+radius_wildcard_add(struct radius_user_data *u, struct radius_wildcard *wc)
+{
+	struct radius_wildcard_group *group;
+	char key[RADIUS_MAX_IDENTITY_LEN + 1];
+	const char *p = wc->pattern;
+	size_t len = strlen(p);
+	size_t prefix, suffix = 0;
+	struct avl_tree *tree;
+	bool *key_len_used;
+	char *name_buf;
+	size_t key_len;
+
+	prefix = strcspn(p, RADIUS_WILDCARD_SPECIAL);
+	while (suffix < len && !strchr(RADIUS_WILDCARD_SPECIAL, p[len - suffix - 1]))
+		suffix++;
+
+	if (prefix > 0) {
+		tree = &u->wildcard_prefix;
+		key_len_used = u->wildcard_prefix_len;
+		key_len = prefix;
+	} else {
+		tree = &u->wildcard_suffix;
+		key_len_used = u->wildcard_suffix_len;
+		key_len = suffix;
+		p += len - suffix;
+	}
+
+	/* cannot match any valid identity */
+	if (key_len > RADIUS_MAX_IDENTITY_LEN)
+		return;
+
+	memcpy(key, p, key_len);
+	key[key_len] = 0;
+
+	group = avl_find_element(tree, key, group, node);
+	if (!group) {
+		group = calloc_a(sizeof(*group), &name_buf, key_len + 1);
+		if (!group)
+			return;
+
+		INIT_LIST_HEAD(&group->list);
+		group->node.key = strcpy(name_buf, key);
+		avl_insert(tree, &group->node);
+	}
+
+	list_add_tail(&wc->list, &group->list);
+	key_len_used[key_len] = true;
+}
+
+static void
+radius_wildcard_init(struct radius_user_data *u)
+{
+	static const struct blobmsg_policy policy = {
+		"name", BLOBMSG_TYPE_STRING
+	};
+	struct blob_attr *cur, *pattern;
+	int rem, n = 0;
+
+	blobmsg_for_each_attr(cur, u->wildcard, rem)
+		n++;
+
+	if (!n)
+		return;
+
+	u->wildcard_list = calloc(n, sizeof(*u->wildcard_list));
+	if (!u->wildcard_list)
+		return;
+
+	n = 0;
+	blobmsg_for_each_attr(cur, u->wildcard, rem) {
+		struct radius_wildcard *wc = &u->wildcard_list[n];
+
+		if (blobmsg_type(cur) != BLOBMSG_TYPE_TABLE)
+			continue;
+
+		blobmsg_parse(&policy, 1, &pattern, blobmsg_data(cur), blobmsg_len(cur));
+		if (!pattern)
+			continue;
+
+		wc->data = cur;
+		wc->pattern = blobmsg_get_string(pattern);
+		wc->index = n++;
+		radius_wildcard_add(u, wc);
+	}
+}
+
+static struct radius_wildcard *
+radius_wildcard_match(struct avl_tree *tree, const char *key, const char *name,
+		      struct radius_wildcard *best)
+{
+	struct radius_wildcard_group *group;
+	struct radius_wildcard *wc;
+
+	group = avl_find_element(tree, key, group, node);
+	if (!group)
+		return best;
+
+	/* groups are sorted by index, the first match in file order wins */
+	list_for_each_entry(wc, &group->list, list) {
+		if (best && wc->index > best->index)
+			break;
+
+		if (!fnmatch(wc->pattern, name, 0))
+			return wc;
+	}
+
+	return best;
+}
+
+static struct blob_attr *
+radius_user_get(struct radius_user_data *u, const char *name)
+{
+	struct radius_wildcard *best = NULL;
+	struct blob_attr *cur;
+	size_t len, i;
+	char *buf, c;
+
+	cur = kvlist_get(&u->users, name);
+	if (cur)
+		return cur;
+
+	if (!u->wildcard_list)
+		return NULL;
+
+	len = strlen(name);
+	if (len > RADIUS_MAX_IDENTITY_LEN)
+		return NULL;
+
+	buf = alloca(len + 1);
+	memcpy(buf, name, len + 1);
+	for (i = 1; i <= len; i++) {
+		if (!u->wildcard_prefix_len[i])
+			continue;
+
+		c = buf[i];
+		buf[i] = 0;
+		best = radius_wildcard_match(&u->wildcard_prefix, buf, name, best);
+		buf[i] = c;
+	}
+
+	for (i = 0; i <= len; i++) {
+		if (!u->wildcard_suffix_len[i])
+			continue;
+
+		best = radius_wildcard_match(&u->wildcard_suffix, name + len - i,
+					     name, best);
+	}
+
+	return best ? best->data : NULL;
+}
+
+static void
+radius_userdata_load(struct radius_user_data *u, struct blob_attr *data,
+		     int *kept, int *dropped)
 {
 	enum {
 		USERSTATE_USERS,
@@ -141,22 +342,39 @@ radius_userdata_load(struct radius_user_data *u, struct blob_attr *data)
 		[USERSTATE_WILDCARD] = { "wildcard", BLOBMSG_TYPE_ARRAY },
 	};
 	struct blob_attr *tb[__USERSTATE_MAX], *cur;
+	struct radius_user_state *s, *tmp;
 	int rem;
 
-	if (!data)
-		return;
+	radius_userdata_clear(u);
 
-	blobmsg_parse(policy, __USERSTATE_MAX, tb, blobmsg_data(data), blobmsg_len(data));
+	if (data) {
+		blobmsg_parse(policy, __USERSTATE_MAX, tb, blobmsg_data(data), blobmsg_len(data));
 
-	blobmsg_for_each_attr(cur, tb[USERSTATE_USERS], rem)
-		kvlist_set(&u->users, blobmsg_name(cur), cur);
+		blobmsg_for_each_attr(cur, tb[USERSTATE_USERS], rem)
+			kvlist_set(&u->users, blobmsg_name(cur), cur);
 
-	if (tb[USERSTATE_WILDCARD])
-		u->wildcard = blob_memdup(tb[USERSTATE_WILDCARD]);
+		if (tb[USERSTATE_WILDCARD]) {
+			u->wildcard = blob_memdup(tb[USERSTATE_WILDCARD]);
+			radius_wildcard_init(u);
+		}
+	}
+
+	/* keep parsed state of identities which still resolve to the same entry */
+	avl_for_each_element_safe(&u->user_state, s, node, tmp) {
+		cur = radius_user_get(u, s->node.key);
+		if (cur && blob_attr_equal(cur, s->entry)) {
+			(*kept)++;
+			continue;
+		}
+
+		avl_delete(&u->user_state, &s->node);
+		free(s);
+		(*dropped)++;
+	}
 }
 
 static void
-load_userfile(struct radius_state *s)
+load_userfile(struct radius_state *s, bool force)
 {
 	enum {
 		USERDATA_PHASE1,
@@ -167,58 +385,102 @@ load_userfile(struct radius_state *s)
 		[USERDATA_PHASE1] = { "phase1", BLOBMSG_TYPE_TABLE },
 		[USERDATA_PHASE2] = { "phase2", BLOBMSG_TYPE_TABLE },
 	};
-	struct blob_attr *tb[__USERDATA_MAX], *cur;
+	struct blob_attr *tb[__USERDATA_MAX];
 	static struct blob_buf b;
+	int kept = 0, dropped = 0;
 	struct stat st;
-	int rem;
 
 	if (stat(s->user_file, &st))
 		return;
 
-	if (s->user_file_ts == st.st_mtime)
+	if (!force && s->user_file_ts == st.st_mtime)
 		return;
 
 	s->user_file_ts = st.st_mtime;
-	radius_userdata_free(&s->phase1);
-	radius_userdata_free(&s->phase2);
 
 	blob_buf_init(&b, 0);
-	blobmsg_add_json_from_file(&b, s->user_file);
+	if (!blobmsg_add_json_from_file(&b, s->user_file)) {
+		wpa_printf(MSG_INFO, "radius: failed to parse user file %s, keeping previous users",
+			   s->user_file);
+		goto out;
+	}
+
 	blobmsg_parse(policy, __USERDATA_MAX, tb, blob_data(b.head), blob_len(b.head));
-	radius_userdata_load(&s->phase1, tb[USERDATA_PHASE1]);
-	radius_userdata_load(&s->phase2, tb[USERDATA_PHASE2]);
+	radius_userdata_load(&s->phase1, tb[USERDATA_PHASE1], &kept, &dropped);
+	radius_userdata_load(&s->phase2, tb[USERDATA_PHASE2], &kept, &dropped);
+
+	wpa_printf(MSG_DEBUG, "radius: loaded user file %s, kept %d cached users, dropped %d",
+		   s->user_file, kept, dropped);
 
+out:
 	blob_buf_free(&b);
 }
 
-static struct blob_attr *
-radius_user_get(struct radius_user_data *s, const char *name)
+static void radius_userfile_reload(void *eloop_ctx, void *user_ctx)
 {
-	struct blob_attr *cur;
-	int rem;
+	struct radius_state *s = eloop_ctx;
 
-	cur = kvlist_get(&s->users, name);
-	if (cur)
-		return cur;
+	load_userfile(s, true);
+}
 
-	blobmsg_for_each_attr(cur, s->wildcard, rem) {
-		static const struct blobmsg_policy policy = {
-			"name", BLOBMSG_TYPE_STRING
-		};
-		struct blob_attr *pattern;
+static void radius_userfile_event(int sock, void *eloop_ctx, void *sock_ctx)
+{
+	char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+	const struct inotify_event *ev;
+	struct radius_state *s = eloop_ctx;
+	bool changed = false;
+	ssize_t len;
+	char *pos;
+
+	while ((len = read(sock, buf, sizeof(buf))) > 0) {
+		for (pos = buf; pos < buf + len; pos += sizeof(*ev) + ev->len) {
+			ev = (const struct inotify_event *)pos;
+			if (ev->len && !strcmp(ev->name, s->user_file_name))
+				changed = true;
+		}
+	}
 
-		if (blobmsg_type(cur) != BLOBMSG_TYPE_TABLE)
-			continue;
+	if (!changed)
+		return;
 
-		blobmsg_parse(&policy, 1, &pattern, blobmsg_data(cur), blobmsg_len(cur));
-		if (!name)
-			continue;
+	/* coalesce multiple writes during provisioning */
+	eloop_cancel_timeout(radius_userfile_reload, s, NULL);
+	eloop_register_timeout(0, RADIUS_USERFILE_RELOAD_DELAY,
+			       radius_userfile_reload, s, NULL);
+}
 
-		if (!fnmatch(blobmsg_get_string(pattern), name, 0))
-			return cur;
+static void radius_userfile_watch(struct radius_state *s)
+{
+	const char *sep = strrchr(s->user_file, '/');
+	char *dir;
+	int fd;
+
+	s->user_file_name = sep ? sep + 1 : s->user_file;
+	if (sep)
+		dir = strndup(s->user_file, sep - s->user_file + 1);
+	else
+		dir = strdup(".");
+	if (!dir)
+		return;
+
+	fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (fd < 0)
+		goto out;
+
+	/* watch the directory to catch files being replaced by rename */
+	if (inotify_add_watch(fd, dir, IN_CLOSE_WRITE | IN_MOVED_TO) < 0 ||
+	    eloop_register_read_sock(fd, radius_userfile_event, s, NULL)) {
+		close(fd);
+		goto out;
 	}
 
-	return NULL;
+	s->inotify_fd = fd;
+
+out:
+	if (s->inotify_fd < 0)
+		wpa_printf(MSG_INFO, "radius: cannot watch %s, checking for changes on every request",
+			   s->user_file);
+	free(dir);
 }
 
 static struct radius_parse_attr_data *
@@ -451,7 +713,7 @@ radius_user_get_state(struct radius_user_data *u, struct blob_attr *data,
 		[USER_ATTR_MAX_RATE_DOWN] = { "max-rate-down", BLOBMSG_TYPE_INT32 },
 	};
 	struct blob_attr *tb[__USER_ATTR_MAX], *cur;
-	char *password_buf, *salt_buf, *name_buf;
+	char *password_buf, *salt_buf, *name_buf, *entry_buf;
 	struct radius_parse_attr_state astate = {};
 	struct hostapd_radius_attr *attr;
 	struct radius_user_state *state;
@@ -477,6 +739,7 @@ radius_user_get_state(struct radius_user_data *u, struct blob_attr *data,
 	radius_count_attrs(tb, &n_attr, &attrsize);
 
 	state = calloc_a(sizeof(*state), &name_buf, strlen(id) + 1,
+			 &entry_buf, blob_pad_len(data),
 			 &password_buf, pw_len,
 			 &salt_buf, salt_len,
 			 &astate.attr, n_attr * sizeof(*astate.attr),
@@ -505,6 +768,7 @@ radius_user_get_state(struct radius_user_data *u, struct blob_attr *data,
 		radius_parse_attrs(tb, &astate);
 	}
 
+	state->entry = memcpy(entry_buf, data, blob_pad_len(data));
 	state->node.key = strcpy(name_buf, id);
 	avl_insert(&u->user_state, &state->node);
 
@@ -525,10 +789,11 @@ static int radius_get_eap_user(void *ctx, const u8 *identity,
 	struct eap_user *data;
 	char *id;
 
-	if (identity_len > 512)
+	if (identity_len > RADIUS_MAX_IDENTITY_LEN)
 		return -1;
 
-	load_userfile(s);
+	if (s->inotify_fd < 0)
+		load_userfile(s, false);
 
 	id = alloca(identity_len + 1);
 	memcpy(id, identity, identity_len);
@@ -593,12 +858,19 @@ static int radius_setup(struct radius_state *s, struct radius_config *c)
 static int radius_init(struct radius_state *s)
 {
 	memset(s, 0, sizeof(*s));
+	s->inotify_fd = -1;
 	radius_userdata_init(&s->phase1);
 	radius_userdata_init(&s->phase2);
 }
 
 static void radius_deinit(struct radius_state *s)
 {
+	eloop_cancel_timeout(radius_userfile_reload, s, NULL);
+	if (s->inotify_fd >= 0) {
+		eloop_unregister_read_sock(s->inotify_fd);
+		close(s->inotify_fd);
+	}
+
 	if (s->radius)
 		radius_server_deinit(s->radius);
 
@@ -704,7 +976,8 @@ int radius_main(int argc, char **argv)
 	if (ret)
 		goto out;
 
-	load_userfile(&state);
+	radius_userfile_watch(&state);
+	load_userfile(&state, true);
 	eloop_run();
 
 out:
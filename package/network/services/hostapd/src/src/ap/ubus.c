@@ -34,9 +34,28 @@ static inline struct hostapd_data *get_hapd_from_object(struct ubus_object *obj)
 	return container_of(obj, struct hostapd_data, ubus.obj);
 }
 
+/*
+ * Per client verdicts, either from del_client ban_time or pushed ahead of
+ * time by a steering daemon through set_admission.
+ */
+enum ubus_client_verdict {
+	UBUS_CLIENT_DENY,
+	UBUS_CLIENT_ALLOW,
+	UBUS_CLIENT_DELAY,
+	__UBUS_CLIENT_VERDICT_MAX
+};
+
+static const char * const ubus_client_verdict_str[__UBUS_CLIENT_VERDICT_MAX] = {
+	[UBUS_CLIENT_DENY] = "deny",
+	[UBUS_CLIENT_ALLOW] = "allow",
+	[UBUS_CLIENT_DELAY] = "delay",
+};
+
 struct ubus_banned_client {
 	struct avl_node avl;
 	u8 addr[ETH_ALEN];
+	enum ubus_client_verdict verdict;
+	u16 status;
 };
 
 static void ubus_reconnect_timeout(void *eloop_data, void *user_ctx)
@@ -129,7 +148,9 @@ hostapd_bss_del_ban(void *eloop_data, void *user_ctx)
 }
 
 static void
-hostapd_bss_ban_client(struct hostapd_data *hapd, u8 *addr, int time)
+hostapd_bss_set_client_verdict(struct hostapd_data *hapd, u8 *addr,
+			       enum ubus_client_verdict verdict, u16 status,
+			       int time)
 {
 	struct ubus_banned_client *ban;
 
@@ -142,6 +163,9 @@ hostapd_bss_ban_client(struct hostapd_data *hapd, u8 *addr, int time)
 			return;
 
 		ban = os_zalloc(sizeof(*ban));
+		if (!ban)
+			return;
+
 		memcpy(ban->addr, addr, sizeof(ban->addr));
 		ban->avl.key = ban->addr;
 		avl_insert(&hapd->ubus.banned, &ban->avl);
@@ -153,7 +177,35 @@ hostapd_bss_ban_client(struct hostapd_data *hapd, u8 *addr, int time)
 		}
 	}
 
-	eloop_register_timeout(0, time * 1000, hostapd_bss_del_ban, ban, hapd);
+	ban->verdict = verdict;
+	ban->status = status;
+	eloop_register_timeout(time / 1000, (time % 1000) * 1000,
+			       hostapd_bss_del_ban, ban, hapd);
+}
+
+static void
+hostapd_bss_ban_client(struct hostapd_data *hapd, u8 *addr, int time)
+{
+	hostapd_bss_set_client_verdict(hapd, addr, UBUS_CLIENT_DENY,
+				       WLAN_STATUS_AP_UNABLE_TO_HANDLE_NEW_STA,
+				       time);
+}
+
+static int
+hostapd_bss_client_verdict(struct ubus_banned_client *ban,
+			   enum hostapd_ubus_event_type type)
+{
+	switch (ban->verdict) {
+	case UBUS_CLIENT_ALLOW:
+		return WLAN_STATUS_SUCCESS;
+	case UBUS_CLIENT_DELAY:
+		/* stay quiet on probes, but let the client connect */
+		if (type == HOSTAPD_UBUS_PROBE_REQ)
+			return WLAN_STATUS_AP_UNABLE_TO_HANDLE_NEW_STA;
+		return WLAN_STATUS_SUCCESS;
+	default:
+		return ban->status;
+	}
 }
 
 static int
@@ -235,16 +287,23 @@ hostapd_parse_capab_blobmsg(struct sta_info *sta)
 	blobmsg_close_table(&b, v);
 }
 
-static int
-hostapd_bss_get_clients(struct ubus_context *ctx, struct ubus_object *obj,
-			struct ubus_request_data *req, const char *method,
-			struct blob_attr *msg)
+static void
+blobmsg_add_macaddr(struct blob_buf *buf, const char *name, const u8 *addr)
+{
+	char *s;
+
+	s = blobmsg_alloc_string_buffer(buf, name, 20);
+	sprintf(s, MACSTR, MAC2STR(addr));
+	blobmsg_add_string_buffer(buf);
+}
+
+static void
+hostapd_ubus_add_sta_blobmsg(struct hostapd_data *hapd, struct sta_info *sta)
 {
-	struct hostapd_data *hapd = container_of(obj, struct hostapd_data, ubus.obj);
 	struct hostap_sta_driver_data sta_driver_data;
-	struct sta_info *sta;
-	void *list, *c;
 	char mac_buf[20];
+	void *r, *c;
+	int i;
 	static const struct {
 		const char *name;
 		uint32_t flag;
@@ -262,71 +321,310 @@ hostapd_bss_get_clients(struct ubus_context *ctx, struct ubus_object *obj,
 		{ "mfp", WLAN_STA_MFP },
 	};
 
-	blob_buf_init(&b, 0);
-	blobmsg_add_u32(&b, "freq", hapd->iface->freq);
-	list = blobmsg_open_table(&b, "clients");
-	for (sta = hapd->sta_list; sta; sta = sta->next) {
-		void *r;
-		int i;
-
-		sprintf(mac_buf, MACSTR, MAC2STR(sta->addr));
-		c = blobmsg_open_table(&b, mac_buf);
-		for (i = 0; i < ARRAY_SIZE(sta_flags); i++)
-			blobmsg_add_u8(&b, sta_flags[i].name,
-				       !!(sta->flags & sta_flags[i].flag));
+	sprintf(mac_buf, MACSTR, MAC2STR(sta->addr));
+	c = blobmsg_open_table(&b, mac_buf);
+	for (i = 0; i < ARRAY_SIZE(sta_flags); i++)
+		blobmsg_add_u8(&b, sta_flags[i].name,
+			       !!(sta->flags & sta_flags[i].flag));
 
 #ifdef CONFIG_MBO
-		blobmsg_add_u8(&b, "mbo", !!(sta->cell_capa));
+	blobmsg_add_u8(&b, "mbo", !!(sta->cell_capa));
 #endif
 
-		r = blobmsg_open_array(&b, "rrm");
-		for (i = 0; i < ARRAY_SIZE(sta->rrm_enabled_capa); i++)
-			blobmsg_add_u32(&b, "", sta->rrm_enabled_capa[i]);
-		blobmsg_close_array(&b, r);
+	r = blobmsg_open_array(&b, "rrm");
+	for (i = 0; i < ARRAY_SIZE(sta->rrm_enabled_capa); i++)
+		blobmsg_add_u32(&b, "", sta->rrm_enabled_capa[i]);
+	blobmsg_close_array(&b, r);
 
-		r = blobmsg_open_array(&b, "extended_capabilities");
-		/* Check if client advertises extended capabilities */
-		if (sta->ext_capability && sta->ext_capability[0] > 0) {
-			for (i = 0; i < sta->ext_capability[0]; i++) {
-				blobmsg_add_u32(&b, "", sta->ext_capability[1 + i]);
-			}
+	r = blobmsg_open_array(&b, "extended_capabilities");
+	/* Check if client advertises extended capabilities */
+	if (sta->ext_capability && sta->ext_capability[0] > 0) {
+		for (i = 0; i < sta->ext_capability[0]; i++) {
+			blobmsg_add_u32(&b, "", sta->ext_capability[1 + i]);
 		}
-		blobmsg_close_array(&b, r);
+	}
+	blobmsg_close_array(&b, r);
 
-		blobmsg_add_u32(&b, "aid", sta->aid);
+	blobmsg_add_u32(&b, "aid", sta->aid);
 #ifdef CONFIG_TAXONOMY
-		r = blobmsg_alloc_string_buffer(&b, "signature", 1024);
-		if (retrieve_sta_taxonomy(hapd, sta, r, 1024) > 0)
-			blobmsg_add_string_buffer(&b);
+	r = blobmsg_alloc_string_buffer(&b, "signature", 1024);
+	if (retrieve_sta_taxonomy(hapd, sta, r, 1024) > 0)
+		blobmsg_add_string_buffer(&b);
 #endif
 
-		/* Driver information */
-		if (hostapd_drv_read_sta_data(hapd, &sta_driver_data, sta->addr) >= 0) {
-			r = blobmsg_open_table(&b, "bytes");
-			blobmsg_add_u64(&b, "rx", sta_driver_data.rx_bytes);
-			blobmsg_add_u64(&b, "tx", sta_driver_data.tx_bytes);
-			blobmsg_close_table(&b, r);
-			r = blobmsg_open_table(&b, "airtime");
-			blobmsg_add_u64(&b, "rx", sta_driver_data.rx_airtime);
-			blobmsg_add_u64(&b, "tx", sta_driver_data.tx_airtime);
-			blobmsg_close_table(&b, r);
-			r = blobmsg_open_table(&b, "packets");
-			blobmsg_add_u32(&b, "rx", sta_driver_data.rx_packets);
-			blobmsg_add_u32(&b, "tx", sta_driver_data.tx_packets);
-			blobmsg_close_table(&b, r);
-			r = blobmsg_open_table(&b, "rate");
-			/* Rate in kbits */
-			blobmsg_add_u32(&b, "rx", sta_driver_data.current_rx_rate * 100);
-			blobmsg_add_u32(&b, "tx", sta_driver_data.current_tx_rate * 100);
-			blobmsg_close_table(&b, r);
-			blobmsg_add_u32(&b, "signal", sta_driver_data.signal);
+	/* Driver information */
+	if (hostapd_drv_read_sta_data(hapd, &sta_driver_data, sta->addr) >= 0) {
+		r = blobmsg_open_table(&b, "bytes");
+		blobmsg_add_u64(&b, "rx", sta_driver_data.rx_bytes);
+		blobmsg_add_u64(&b, "tx", sta_driver_data.tx_bytes);
+		blobmsg_close_table(&b, r);
+		r = blobmsg_open_table(&b, "airtime");
+		blobmsg_add_u64(&b, "rx", sta_driver_data.rx_airtime);
+		blobmsg_add_u64(&b, "tx", sta_driver_data.tx_airtime);
+		blobmsg_close_table(&b, r);
+		r = blobmsg_open_table(&b, "packets");
+		blobmsg_add_u32(&b, "rx", sta_driver_data.rx_packets);
+		blobmsg_add_u32(&b, "tx", sta_driver_data.tx_packets);
+		blobmsg_close_table(&b, r);
+		r = blobmsg_open_table(&b, "rate");
+		/* Rate in kbits */
+		blobmsg_add_u32(&b, "rx", sta_driver_data.current_rx_rate * 100);
+		blobmsg_add_u32(&b, "tx", sta_driver_data.current_tx_rate * 100);
+		blobmsg_close_table(&b, r);
+		blobmsg_add_u32(&b, "signal", sta_driver_data.signal);
+	}
+
+	hostapd_parse_capab_blobmsg(sta);
+
+	blobmsg_close_table(&b, c);
+}
+
+static int
+hostapd_bss_get_clients(struct ubus_context *ctx, struct ubus_object *obj,
+			struct ubus_request_data *req, const char *method,
+			struct blob_attr *msg)
+{
+	struct hostapd_data *hapd = container_of(obj, struct hostapd_data, ubus.obj);
+	struct sta_info *sta;
+	void *list;
+
+	blob_buf_init(&b, 0);
+	blobmsg_add_u32(&b, "freq", hapd->iface->freq);
+	list = blobmsg_open_table(&b, "clients");
+	for (sta = hapd->sta_list; sta; sta = sta->next)
+		hostapd_ubus_add_sta_blobmsg(hapd, sta);
+	blobmsg_close_array(&b, list);
+	ubus_send_reply(ctx, req, b.head);
+
+	return 0;
+}
+
+/*
+ * Incremental client listing. Every station is tracked by a fingerprint
+ * of its association state (flags, AID, VLAN and capabilities); whenever
+ * it changes, appears or disappears, the BSS generation is bumped and
+ * recorded for that station. Counters and signal coming from the driver
+ * are reported but do not count as a change.
+ */
+#define STA_STATE_TOMBSTONE_TIMEOUT	600	/* seconds */
+
+struct ubus_sta_state {
+	struct avl_node avl;
+	u8 addr[ETH_ALEN];
+	u32 hash;
+	u32 generation;
+	struct os_reltime removed_at;
+	bool removed;
+	bool seen;
+};
+
+static u32
+hostapd_ubus_hash(u32 hash, const void *data, size_t len)
+{
+	const u8 *pos = data;
+
+	/* FNV-1a */
+	while (len--)
+		hash = (hash ^ *pos++) * 16777619;
+
+	return hash;
+}
+
+static u32
+hostapd_ubus_sta_hash(struct sta_info *sta)
+{
+	u32 hash = 2166136261u;
+
+	hash = hostapd_ubus_hash(hash, &sta->flags, sizeof(sta->flags));
+	hash = hostapd_ubus_hash(hash, &sta->aid, sizeof(sta->aid));
+	hash = hostapd_ubus_hash(hash, &sta->vlan_id, sizeof(sta->vlan_id));
+	hash = hostapd_ubus_hash(hash, sta->rrm_enabled_capa,
+				 sizeof(sta->rrm_enabled_capa));
+	if (sta->ext_capability)
+		hash = hostapd_ubus_hash(hash, sta->ext_capability,
+					 1 + sta->ext_capability[0]);
+	if (sta->vht_capabilities)
+		hash = hostapd_ubus_hash(hash, sta->vht_capabilities,
+					 sizeof(*sta->vht_capabilities));
+
+	return hash;
+}
+
+static void
+hostapd_ubus_sta_sync(struct hostapd_data *hapd)
+{
+	struct ubus_sta_state *st, *tmp;
+	struct os_reltime now;
+	struct sta_info *sta;
+	u32 hash;
+
+	avl_for_each_element(&hapd->ubus.sta_state, st, avl)
+		st->seen = false;
+
+	for (sta = hapd->sta_list; sta; sta = sta->next) {
+		hash = hostapd_ubus_sta_hash(sta);
+
+		st = avl_find_element(&hapd->ubus.sta_state, sta->addr, st, avl);
+		if (!st) {
+			st = os_zalloc(sizeof(*st));
+			if (!st)
+				continue;
+
+			memcpy(st->addr, sta->addr, ETH_ALEN);
+			st->avl.key = st->addr;
+			avl_insert(&hapd->ubus.sta_state, &st->avl);
+			st->generation = ++hapd->ubus.sta_generation;
+		} else if (st->removed || st->hash != hash) {
+			st->generation = ++hapd->ubus.sta_generation;
 		}
 
-		hostapd_parse_capab_blobmsg(sta);
+		st->hash = hash;
+		st->removed = false;
+		st->seen = true;
+	}
 
-		blobmsg_close_table(&b, c);
+	os_get_reltime(&now);
+	avl_for_each_element_safe(&hapd->ubus.sta_state, st, avl, tmp) {
+		if (st->seen)
+			continue;
+
+		if (!st->removed) {
+			st->removed = true;
+			st->removed_at = now;
+			st->generation = ++hapd->ubus.sta_generation;
+			continue;
+		}
+
+		if (!os_reltime_expired(&now, &st->removed_at,
+					STA_STATE_TOMBSTONE_TIMEOUT))
+			continue;
+
+		/* removals older than this can no longer be reported */
+		if (st->generation > hapd->ubus.sta_generation_floor)
+			hapd->ubus.sta_generation_floor = st->generation;
+
+		avl_delete(&hapd->ubus.sta_state, &st->avl);
+		os_free(st);
+	}
+}
+
+/* fill b with all changes since generation @since, returns false if none */
+static bool
+hostapd_ubus_sta_delta_blobmsg(struct hostapd_data *hapd, u32 since)
+{
+	struct ubus_sta_state *st;
+	struct sta_info *sta;
+	bool full, changed = false;
+	void *list;
+
+	hostapd_ubus_sta_sync(hapd);
+
+	full = !since || since < hapd->ubus.sta_generation_floor ||
+	       since > hapd->ubus.sta_generation;
+
+	blob_buf_init(&b, 0);
+	blobmsg_add_u32(&b, "freq", hapd->iface->freq);
+	blobmsg_add_u32(&b, "generation", hapd->ubus.sta_generation);
+	blobmsg_add_u8(&b, "full", full);
+
+	list = blobmsg_open_table(&b, "clients");
+	for (sta = hapd->sta_list; sta; sta = sta->next) {
+		if (!full) {
+			st = avl_find_element(&hapd->ubus.sta_state, sta->addr, st, avl);
+			if (st && st->generation <= since)
+				continue;
+		}
+
+		hostapd_ubus_add_sta_blobmsg(hapd, sta);
+		changed = true;
+	}
+	blobmsg_close_table(&b, list);
+
+	list = blobmsg_open_array(&b, "removed");
+	if (!full) {
+		avl_for_each_element(&hapd->ubus.sta_state, st, avl) {
+			if (!st->removed || st->generation <= since)
+				continue;
+
+			blobmsg_add_macaddr(&b, NULL, st->addr);
+			changed = true;
+		}
 	}
 	blobmsg_close_array(&b, list);
+
+	return changed || full;
+}
+
+static void
+hostapd_ubus_sta_delta_notify(void *eloop_data, void *user_ctx)
+{
+	struct hostapd_data *hapd = eloop_data;
+	u32 since = hapd->ubus.sta_generation_notified;
+
+	if (!ctx || !hapd->ubus.obj.has_subscribers)
+		return;
+
+	if (!hostapd_ubus_sta_delta_blobmsg(hapd, since ? since : hapd->ubus.sta_generation_floor))
+		return;
+
+	ubus_notify(ctx, &hapd->ubus.obj, "clients_delta", b.head, -1);
+	hapd->ubus.sta_generation_notified = hapd->ubus.sta_generation;
+}
+
+static void
+hostapd_ubus_sta_changed(struct hostapd_data *hapd)
+{
+	if (!hapd->ubus.sta_delta_notify)
+		return;
+
+	/* let the station update finish and coalesce bursts of events */
+	eloop_cancel_timeout(hostapd_ubus_sta_delta_notify, hapd, NULL);
+	eloop_register_timeout(0, 100000, hostapd_ubus_sta_delta_notify, hapd, NULL);
+}
+
+static void
+hostapd_ubus_sta_state_free(struct hostapd_data *hapd)
+{
+	struct ubus_sta_state *st, *tmp;
+
+	eloop_cancel_timeout(hostapd_ubus_sta_delta_notify, hapd, NULL);
+	avl_remove_all_elements(&hapd->ubus.sta_state, st, avl, tmp)
+		os_free(st);
+}
+
+enum {
+	CLIENTS_DELTA_GENERATION,
+	CLIENTS_DELTA_NOTIFY,
+	__CLIENTS_DELTA_MAX
+};
+
+static const struct blobmsg_policy clients_delta_policy[__CLIENTS_DELTA_MAX] = {
+	[CLIENTS_DELTA_GENERATION] = { "generation", BLOBMSG_TYPE_INT32 },
+	[CLIENTS_DELTA_NOTIFY] = { "notify", BLOBMSG_TYPE_BOOL },
+};
+
+static int
+hostapd_bss_get_clients_delta(struct ubus_context *ctx, struct ubus_object *obj,
+			      struct ubus_request_data *req, const char *method,
+			      struct blob_attr *msg)
+{
+	struct blob_attr *tb[__CLIENTS_DELTA_MAX];
+	struct hostapd_data *hapd = get_hapd_from_object(obj);
+	u32 since = 0;
+
+	blobmsg_parse(clients_delta_policy, __CLIENTS_DELTA_MAX, tb,
+		      blob_data(msg), blob_len(msg));
+
+	if (tb[CLIENTS_DELTA_GENERATION])
+		since = blobmsg_get_u32(tb[CLIENTS_DELTA_GENERATION]);
+
+	if (tb[CLIENTS_DELTA_NOTIFY]) {
+		hapd->ubus.sta_delta_notify = blobmsg_get_bool(tb[CLIENTS_DELTA_NOTIFY]);
+		if (!hapd->ubus.sta_delta_notify)
+			eloop_cancel_timeout(hostapd_ubus_sta_delta_notify, hapd, NULL);
+	}
+
+	hostapd_ubus_sta_delta_blobmsg(hapd, since);
 	ubus_send_reply(ctx, req, b.head);
 
 	return 0;
@@ -353,7 +651,7 @@ hostapd_bss_get_status(struct ubus_context *ctx, struct ubus_object *obj,
 		       struct blob_attr *msg)
 {
 	struct hostapd_data *hapd = container_of(obj, struct hostapd_data, ubus.obj);
-	void *airtime_table, *dfs_table, *rrm_table, *wnm_table;
+	void *airtime_table, *dfs_table, *rrm_table, *wnm_table, *admission_table;
 	struct os_reltime now;
 	char ssid[SSID_MAX_LEN + 1];
 	char phy_name[17];
@@ -409,6 +707,14 @@ hostapd_bss_get_status(struct ubus_context *ctx, struct ubus_object *obj,
 	blobmsg_add_u16(&b, "utilization", hapd->iface->channel_utilization);
 	blobmsg_close_table(&b, airtime_table);
 
+	/* Admission cache */
+	admission_table = blobmsg_open_table(&b, "admission");
+	blobmsg_add_u8(&b, "enabled", hapd->ubus.admission_cache);
+	blobmsg_add_u64(&b, "cache_hits", hapd->ubus.admission_hits);
+	blobmsg_add_u64(&b, "cache_misses", hapd->ubus.admission_misses);
+	blobmsg_add_u64(&b, "forwarded", hapd->ubus.events_forwarded);
+	blobmsg_close_table(&b, admission_table);
+
 	/* DFS */
 	dfs_table = blobmsg_open_table(&b, "dfs");
 	blobmsg_add_u32(&b, "cac_seconds", hapd->iface->dfs_cac_ms / 1000);
@@ -425,11 +731,13 @@ hostapd_bss_get_status(struct ubus_context *ctx, struct ubus_object *obj,
 
 enum {
 	NOTIFY_RESPONSE,
+	NOTIFY_ADMISSION_CACHE,
 	__NOTIFY_MAX
 };
 
 static const struct blobmsg_policy notify_policy[__NOTIFY_MAX] = {
 	[NOTIFY_RESPONSE] = { "notify_response", BLOBMSG_TYPE_INT32 },
+	[NOTIFY_ADMISSION_CACHE] = { "admission_cache", BLOBMSG_TYPE_BOOL },
 };
 
 static int
@@ -446,10 +754,128 @@ hostapd_notify_response(struct ubus_context *ctx, struct ubus_object *obj,
 	blobmsg_parse(notify_policy, __NOTIFY_MAX, tb,
 		      blob_data(msg), blob_len(msg));
 
-	if (!tb[NOTIFY_RESPONSE])
+	if (!tb[NOTIFY_RESPONSE] && !tb[NOTIFY_ADMISSION_CACHE])
 		return UBUS_STATUS_INVALID_ARGUMENT;
 
-	hapd->ubus.notify_response = blobmsg_get_u32(tb[NOTIFY_RESPONSE]);
+	if (tb[NOTIFY_RESPONSE])
+		hapd->ubus.notify_response = blobmsg_get_u32(tb[NOTIFY_RESPONSE]);
+
+	if (tb[NOTIFY_ADMISSION_CACHE])
+		hapd->ubus.admission_cache = blobmsg_get_bool(tb[NOTIFY_ADMISSION_CACHE]);
+
+	return UBUS_STATUS_OK;
+}
+
+enum {
+	PROBE_SUMMARY_INTERVAL,
+	__PROBE_SUMMARY_MAX
+};
+
+static const struct blobmsg_policy probe_summary_policy[__PROBE_SUMMARY_MAX] = {
+	[PROBE_SUMMARY_INTERVAL] = { "interval", BLOBMSG_TYPE_INT32 },
+};
+
+static void hostapd_ubus_probe_summary_free(struct hostapd_data *hapd);
+
+static int
+hostapd_bss_probe_summary(struct ubus_context *ctx, struct ubus_object *obj,
+			  struct ubus_request_data *req, const char *method,
+			  struct blob_attr *msg)
+{
+	struct blob_attr *tb[__PROBE_SUMMARY_MAX];
+	struct hostapd_data *hapd = get_hapd_from_object(obj);
+	int interval;
+
+	blobmsg_parse(probe_summary_policy, __PROBE_SUMMARY_MAX, tb,
+		      blob_data(msg), blob_len(msg));
+
+	if (!tb[PROBE_SUMMARY_INTERVAL])
+		return UBUS_STATUS_INVALID_ARGUMENT;
+
+	interval = blobmsg_get_u32(tb[PROBE_SUMMARY_INTERVAL]);
+	if (interval < 0)
+		return UBUS_STATUS_INVALID_ARGUMENT;
+
+	if (!interval)
+		hostapd_ubus_probe_summary_free(hapd);
+
+	hapd->ubus.probe_summary_interval = interval;
+
+	return UBUS_STATUS_OK;
+}
+
+enum {
+	ADMISSION_ADDR,
+	ADMISSION_VERDICT,
+	ADMISSION_STATUS,
+	ADMISSION_TTL,
+	__ADMISSION_MAX
+};
+
+static const struct blobmsg_policy admission_policy[__ADMISSION_MAX] = {
+	[ADMISSION_ADDR] = { "addr", BLOBMSG_TYPE_UNSPEC },
+	[ADMISSION_VERDICT] = { "verdict", BLOBMSG_TYPE_STRING },
+	[ADMISSION_STATUS] = { "status", BLOBMSG_TYPE_INT32 },
+	[ADMISSION_TTL] = { "ttl", BLOBMSG_TYPE_INT32 },
+};
+
+static int
+hostapd_bss_set_admission(struct ubus_context *ctx, struct ubus_object *obj,
+			  struct ubus_request_data *req, const char *method,
+			  struct blob_attr *msg)
+{
+	struct blob_attr *tb[__ADMISSION_MAX];
+	struct hostapd_data *hapd = get_hapd_from_object(obj);
+	enum ubus_client_verdict verdict;
+	u16 status = WLAN_STATUS_AP_UNABLE_TO_HANDLE_NEW_STA;
+	struct blob_attr *cur;
+	u8 addr[ETH_ALEN];
+	int ttl;
+	int rem;
+
+	blobmsg_parse(admission_policy, __ADMISSION_MAX, tb,
+		      blob_data(msg), blob_len(msg));
+
+	/* ttl is in ms, 0 drops the verdict of the addresses */
+	if (!tb[ADMISSION_ADDR] || !tb[ADMISSION_VERDICT] || !tb[ADMISSION_TTL])
+		return UBUS_STATUS_INVALID_ARGUMENT;
+
+	ttl = blobmsg_get_u32(tb[ADMISSION_TTL]);
+	if (ttl < 0)
+		return UBUS_STATUS_INVALID_ARGUMENT;
+
+	for (verdict = 0; verdict < __UBUS_CLIENT_VERDICT_MAX; verdict++)
+		if (!strcmp(blobmsg_get_string(tb[ADMISSION_VERDICT]),
+			    ubus_client_verdict_str[verdict]))
+			break;
+
+	if (verdict == __UBUS_CLIENT_VERDICT_MAX)
+		return UBUS_STATUS_INVALID_ARGUMENT;
+
+	if (tb[ADMISSION_STATUS])
+		status = blobmsg_get_u32(tb[ADMISSION_STATUS]);
+
+	/* addr is either a single address or an array of addresses */
+	switch (blobmsg_type(tb[ADMISSION_ADDR])) {
+	case BLOBMSG_TYPE_STRING:
+		if (hwaddr_aton(blobmsg_data(tb[ADMISSION_ADDR]), addr))
+			return UBUS_STATUS_INVALID_ARGUMENT;
+
+		hostapd_bss_set_client_verdict(hapd, addr, verdict, status, ttl);
+		break;
+	case BLOBMSG_TYPE_ARRAY:
+		blobmsg_for_each_attr(cur, tb[ADMISSION_ADDR], rem) {
+			if (blobmsg_type(cur) != BLOBMSG_TYPE_STRING ||
+			    hwaddr_aton(blobmsg_data(cur), addr))
+				return UBUS_STATUS_INVALID_ARGUMENT;
+
+			hostapd_bss_set_client_verdict(hapd, addr, verdict,
+						       status, ttl);
+		}
+		break;
+	default:
+		return UBUS_STATUS_INVALID_ARGUMENT;
+	}
 
 	return UBUS_STATUS_OK;
 }
@@ -512,16 +938,6 @@ hostapd_bss_del_client(struct ubus_context *ctx, struct ubus_object *obj,
 	return 0;
 }
 
-static void
-blobmsg_add_macaddr(struct blob_buf *buf, const char *name, const u8 *addr)
-{
-	char *s;
-
-	s = blobmsg_alloc_string_buffer(buf, name, 20);
-	sprintf(s, MACSTR, MAC2STR(addr));
-	blobmsg_add_string_buffer(buf);
-}
-
 static int
 hostapd_bss_list_bans(struct ubus_context *ctx, struct ubus_object *obj,
 		      struct ubus_request_data *req, const char *method,
@@ -534,7 +950,8 @@ hostapd_bss_list_bans(struct ubus_context *ctx, struct ubus_object *obj,
 	blob_buf_init(&b, 0);
 	c = blobmsg_open_array(&b, "clients");
 	avl_for_each_element(&hapd->ubus.banned, ban, avl)
-		blobmsg_add_macaddr(&b, NULL, ban->addr);
+		if (ban->verdict == UBUS_CLIENT_DENY)
+			blobmsg_add_macaddr(&b, NULL, ban->addr);
 	blobmsg_close_array(&b, c);
 	ubus_send_reply(ctx, req, b.head);
 
@@ -1617,6 +2034,7 @@ hostapd_bss_get_sta_ies(struct ubus_context *ctx, struct ubus_object *obj,
 static const struct ubus_method bss_methods[] = {
 	UBUS_METHOD_NOARG("reload", hostapd_bss_reload),
 	UBUS_METHOD_NOARG("get_clients", hostapd_bss_get_clients),
+	UBUS_METHOD("get_clients_delta", hostapd_bss_get_clients_delta, clients_delta_policy),
 #ifdef CONFIG_TAXONOMY
 	UBUS_METHOD("get_sta_ies", hostapd_bss_get_sta_ies, addr_policy),
 #endif
@@ -1638,6 +2056,8 @@ static const struct ubus_method bss_methods[] = {
 #endif
 	UBUS_METHOD("set_vendor_elements", hostapd_vendor_elements, ve_policy),
 	UBUS_METHOD("notify_response", hostapd_notify_response, notify_policy),
+	UBUS_METHOD("set_admission", hostapd_bss_set_admission, admission_policy),
+	UBUS_METHOD("probe_summary", hostapd_bss_probe_summary, probe_summary_policy),
 	UBUS_METHOD("bss_mgmt_enable", hostapd_bss_mgmt_enable, bss_mgmt_enable_policy),
 	UBUS_METHOD_NOARG("rrm_nr_get_own", hostapd_rrm_nr_get_own),
 	UBUS_METHOD_NOARG("rrm_nr_list", hostapd_rrm_nr_list),
@@ -1675,6 +2095,8 @@ void hostapd_ubus_add_bss(struct hostapd_data *hapd)
 		return;
 
 	avl_init(&hapd->ubus.banned, avl_compare_macaddr, false, NULL);
+	avl_init(&hapd->ubus.probes, avl_compare_macaddr, false, NULL);
+	avl_init(&hapd->ubus.sta_state, avl_compare_macaddr, false, NULL);
 	obj->name = name;
 	obj->type = &bss_object_type;
 	obj->methods = bss_object_type.methods;
@@ -1696,6 +2118,11 @@ void hostapd_ubus_free_bss(struct hostapd_data *hapd)
 	if (!ctx)
 		return;
 
+	if (obj->name) {
+		hostapd_ubus_probe_summary_free(hapd);
+		hostapd_ubus_sta_state_free(hapd);
+	}
+
 	if (obj->id) {
 		ubus_remove_object(ctx, obj);
 		hostapd_ubus_ref_dec();
@@ -1741,6 +2168,193 @@ void hostapd_ubus_remove_vlan(struct hostapd_data *hapd, struct hostapd_vlan *vl
 	hostapd_ubus_vlan_action(hapd, vlan, "vlan_remove");
 }
 
+static void
+blobmsg_add_ht_vht_capabilities(const struct ieee80211_ht_capabilities *ht_capabilities,
+				const struct ieee80211_vht_capabilities *vht_capabilities)
+{
+	if (ht_capabilities) {
+		void *ht_cap, *ht_cap_mcs_set, *mcs_set;
+
+		ht_cap = blobmsg_open_table(&b, "ht_capabilities");
+		blobmsg_add_u16(&b, "ht_capabilities_info", ht_capabilities->ht_capabilities_info);
+		ht_cap_mcs_set = blobmsg_open_table(&b, "supported_mcs_set");
+		blobmsg_add_u16(&b, "a_mpdu_params", ht_capabilities->a_mpdu_params);
+		blobmsg_add_u16(&b, "ht_extended_capabilities", ht_capabilities->ht_extended_capabilities);
+		blobmsg_add_u32(&b, "tx_bf_capability_info", ht_capabilities->tx_bf_capability_info);
+		blobmsg_add_u16(&b, "asel_capabilities", ht_capabilities->asel_capabilities);
+		mcs_set = blobmsg_open_array(&b, "supported_mcs_set");
+		for (int i = 0; i < 16; i++) {
+			blobmsg_add_u16(&b, NULL, (u16) ht_capabilities->supported_mcs_set[i]);
+		}
+		blobmsg_close_array(&b, mcs_set);
+		blobmsg_close_table(&b, ht_cap_mcs_set);
+		blobmsg_close_table(&b, ht_cap);
+	}
+	if (vht_capabilities) {
+		void *vht_cap, *vht_cap_mcs_set;
+
+		vht_cap = blobmsg_open_table(&b, "vht_capabilities");
+		blobmsg_add_u32(&b, "vht_capabilities_info", vht_capabilities->vht_capabilities_info);
+		vht_cap_mcs_set = blobmsg_open_table(&b, "vht_supported_mcs_set");
+		blobmsg_add_u16(&b, "rx_map", vht_capabilities->vht_supported_mcs_set.rx_map);
+		blobmsg_add_u16(&b, "rx_highest", vht_capabilities->vht_supported_mcs_set.rx_highest);
+		blobmsg_add_u16(&b, "tx_map", vht_capabilities->vht_supported_mcs_set.tx_map);
+		blobmsg_add_u16(&b, "tx_highest", vht_capabilities->vht_supported_mcs_set.tx_highest);
+		blobmsg_close_table(&b, vht_cap_mcs_set);
+		blobmsg_close_table(&b, vht_cap);
+	}
+}
+
+/*
+ * Probe summary mode: instead of one notification per probe request,
+ * probes are aggregated per client and sent as a single "probe_summary"
+ * notification every probe_summary_interval milliseconds. Capabilities
+ * are only included the first time a client is seen or when they change.
+ */
+#define PROBE_SUMMARY_IDLE_TIMEOUT	300	/* seconds */
+
+struct ubus_probe_client {
+	struct avl_node avl;
+	u8 addr[ETH_ALEN];
+	u8 target[ETH_ALEN];
+	unsigned int count;
+	int signal_min;
+	int signal_max;
+	int signal_last;
+	struct os_reltime last_seen;
+	bool has_ht, has_vht;
+	bool caps_changed;
+	struct ieee80211_ht_capabilities ht;
+	struct ieee80211_vht_capabilities vht;
+};
+
+static void
+hostapd_ubus_probe_summary_flush(void *eloop_data, void *user_ctx)
+{
+	struct hostapd_data *hapd = eloop_data;
+	struct ubus_probe_client *pc, *tmp;
+	struct os_reltime now;
+	void *arr, *c;
+	int n = 0;
+
+	os_get_reltime(&now);
+
+	blob_buf_init(&b, 0);
+	blobmsg_add_u32(&b, "freq", hapd->iface->freq);
+	blobmsg_add_u32(&b, "interval", hapd->ubus.probe_summary_interval);
+	arr = blobmsg_open_array(&b, "clients");
+	avl_for_each_element_safe(&hapd->ubus.probes, pc, avl, tmp) {
+		if (!pc->count) {
+			if (os_reltime_expired(&now, &pc->last_seen,
+					       PROBE_SUMMARY_IDLE_TIMEOUT)) {
+				avl_delete(&hapd->ubus.probes, &pc->avl);
+				os_free(pc);
+			}
+			continue;
+		}
+
+		c = blobmsg_open_table(&b, NULL);
+		blobmsg_add_macaddr(&b, "address", pc->addr);
+		blobmsg_add_macaddr(&b, "target", pc->target);
+		blobmsg_add_u32(&b, "count", pc->count);
+		if (pc->signal_last) {
+			blobmsg_add_u32(&b, "signal", pc->signal_last);
+			blobmsg_add_u32(&b, "signal_min", pc->signal_min);
+			blobmsg_add_u32(&b, "signal_max", pc->signal_max);
+		}
+		if (pc->caps_changed)
+			blobmsg_add_ht_vht_capabilities(pc->has_ht ? &pc->ht : NULL,
+							pc->has_vht ? &pc->vht : NULL);
+		blobmsg_close_table(&b, c);
+
+		pc->count = 0;
+		pc->signal_last = 0;
+		pc->caps_changed = false;
+		n++;
+	}
+	blobmsg_close_array(&b, arr);
+
+	if (n && ctx && hapd->ubus.obj.has_subscribers &&
+	    !ubus_notify(ctx, &hapd->ubus.obj, "probe_summary", b.head, -1))
+		hapd->ubus.events_forwarded++;
+
+	if (!avl_is_empty(&hapd->ubus.probes))
+		eloop_register_timeout(hapd->ubus.probe_summary_interval / 1000,
+				       (hapd->ubus.probe_summary_interval % 1000) * 1000,
+				       hostapd_ubus_probe_summary_flush, hapd, NULL);
+}
+
+static void
+hostapd_ubus_probe_summary_add(struct hostapd_data *hapd, const u8 *addr,
+			       struct hostapd_ubus_request *req)
+{
+	const struct ieee80211_ht_capabilities *ht = NULL;
+	const struct ieee80211_vht_capabilities *vht = NULL;
+	struct ubus_probe_client *pc;
+
+	pc = avl_find_element(&hapd->ubus.probes, addr, pc, avl);
+	if (!pc) {
+		pc = os_zalloc(sizeof(*pc));
+		if (!pc)
+			return;
+
+		memcpy(pc->addr, addr, ETH_ALEN);
+		pc->avl.key = pc->addr;
+		avl_insert(&hapd->ubus.probes, &pc->avl);
+		pc->caps_changed = true;
+	}
+
+	if (req->elems) {
+		ht = (const void *) req->elems->ht_capabilities;
+		vht = (const void *) req->elems->vht_capabilities;
+	}
+
+	if (!!ht != pc->has_ht || (ht && memcmp(ht, &pc->ht, sizeof(pc->ht)))) {
+		pc->has_ht = !!ht;
+		if (ht)
+			memcpy(&pc->ht, ht, sizeof(pc->ht));
+		pc->caps_changed = true;
+	}
+
+	if (!!vht != pc->has_vht || (vht && memcmp(vht, &pc->vht, sizeof(pc->vht)))) {
+		pc->has_vht = !!vht;
+		if (vht)
+			memcpy(&pc->vht, vht, sizeof(pc->vht));
+		pc->caps_changed = true;
+	}
+
+	if (req->mgmt_frame)
+		memcpy(pc->target, req->mgmt_frame->da, ETH_ALEN);
+
+	if (req->ssi_signal) {
+		if (!pc->signal_last) {
+			pc->signal_min = req->ssi_signal;
+			pc->signal_max = req->ssi_signal;
+		}
+		pc->signal_min = MIN(pc->signal_min, req->ssi_signal);
+		pc->signal_max = MAX(pc->signal_max, req->ssi_signal);
+		pc->signal_last = req->ssi_signal;
+	}
+
+	pc->count++;
+	os_get_reltime(&pc->last_seen);
+
+	if (!eloop_is_timeout_registered(hostapd_ubus_probe_summary_flush, hapd, NULL))
+		eloop_register_timeout(hapd->ubus.probe_summary_interval / 1000,
+				       (hapd->ubus.probe_summary_interval % 1000) * 1000,
+				       hostapd_ubus_probe_summary_flush, hapd, NULL);
+}
+
+static void
+hostapd_ubus_probe_summary_free(struct hostapd_data *hapd)
+{
+	struct ubus_probe_client *pc, *tmp;
+
+	eloop_cancel_timeout(hostapd_ubus_probe_summary_flush, hapd, NULL);
+	avl_remove_all_elements(&hapd->ubus.probes, pc, avl, tmp)
+		os_free(pc);
+}
+
 struct ubus_event_req {
 	struct ubus_notify_request nreq;
 	int resp;
@@ -1764,6 +2378,7 @@ int hostapd_ubus_handle_event(struct hostapd_data *hapd, struct hostapd_ubus_req
 	};
 	const char *type = "mgmt";
 	struct ubus_event_req ureq = {};
+	int resp = WLAN_STATUS_SUCCESS;
 	const u8 *addr;
 
 	if (req->mgmt_frame)
@@ -1772,11 +2387,24 @@ int hostapd_ubus_handle_event(struct hostapd_data *hapd, struct hostapd_ubus_req
 		addr = req->addr;
 
 	ban = avl_find_element(&hapd->ubus.banned, addr, ban, avl);
-	if (ban)
-		return WLAN_STATUS_AP_UNABLE_TO_HANDLE_NEW_STA;
+	if (ban) {
+		hapd->ubus.admission_hits++;
+		resp = hostapd_bss_client_verdict(ban, req->type);
+		if (!hapd->ubus.admission_cache)
+			return resp;
+	} else if (hapd->ubus.admission_cache) {
+		hapd->ubus.admission_misses++;
+	}
 
 	if (!hapd->ubus.obj.has_subscribers)
-		return WLAN_STATUS_SUCCESS;
+		return resp;
+
+	/* nobody waits for a reply to this probe, fold it into the summary */
+	if (req->type == HOSTAPD_UBUS_PROBE_REQ && hapd->ubus.probe_summary_interval &&
+	    (!hapd->ubus.notify_response || hapd->ubus.admission_cache)) {
+		hostapd_ubus_probe_summary_add(hapd, addr, req);
+		return resp;
+	}
 
 	if (req->type < ARRAY_SIZE(types))
 		type = types[req->type];
@@ -1789,55 +2417,27 @@ int hostapd_ubus_handle_event(struct hostapd_data *hapd, struct hostapd_ubus_req
 		blobmsg_add_u32(&b, "signal", req->ssi_signal);
 	blobmsg_add_u32(&b, "freq", hapd->iface->freq);
 
-	if (req->elems) {
-		if(req->elems->ht_capabilities)
-		{
-			struct ieee80211_ht_capabilities *ht_capabilities;
-			void *ht_cap, *ht_cap_mcs_set, *mcs_set;
-
-
-			ht_capabilities = (struct ieee80211_ht_capabilities*) req->elems->ht_capabilities;
-			ht_cap = blobmsg_open_table(&b, "ht_capabilities");
-			blobmsg_add_u16(&b, "ht_capabilities_info", ht_capabilities->ht_capabilities_info);
-			ht_cap_mcs_set = blobmsg_open_table(&b, "supported_mcs_set");
-			blobmsg_add_u16(&b, "a_mpdu_params", ht_capabilities->a_mpdu_params);
-			blobmsg_add_u16(&b, "ht_extended_capabilities", ht_capabilities->ht_extended_capabilities);
-			blobmsg_add_u32(&b, "tx_bf_capability_info", ht_capabilities->tx_bf_capability_info);
-			blobmsg_add_u16(&b, "asel_capabilities", ht_capabilities->asel_capabilities);
-			mcs_set = blobmsg_open_array(&b, "supported_mcs_set");
-			for (int i = 0; i < 16; i++) {
-				blobmsg_add_u16(&b, NULL, (u16) ht_capabilities->supported_mcs_set[i]);
-			}
-			blobmsg_close_array(&b, mcs_set);
-			blobmsg_close_table(&b, ht_cap_mcs_set);
-			blobmsg_close_table(&b, ht_cap);
-		}
-		if(req->elems->vht_capabilities)
-		{
-			struct ieee80211_vht_capabilities *vht_capabilities;
-			void *vht_cap, *vht_cap_mcs_set;
-
-			vht_capabilities = (struct ieee80211_vht_capabilities*) req->elems->vht_capabilities;
-			vht_cap = blobmsg_open_table(&b, "vht_capabilities");
-			blobmsg_add_u32(&b, "vht_capabilities_info", vht_capabilities->vht_capabilities_info);
-			vht_cap_mcs_set = blobmsg_open_table(&b, "vht_supported_mcs_set");
-			blobmsg_add_u16(&b, "rx_map", vht_capabilities->vht_supported_mcs_set.rx_map);
-			blobmsg_add_u16(&b, "rx_highest", vht_capabilities->vht_supported_mcs_set.rx_highest);
-			blobmsg_add_u16(&b, "tx_map", vht_capabilities->vht_supported_mcs_set.tx_map);
-			blobmsg_add_u16(&b, "tx_highest", vht_capabilities->vht_supported_mcs_set.tx_highest);
-			blobmsg_close_table(&b, vht_cap_mcs_set);
-			blobmsg_close_table(&b, vht_cap);
-		}
-	}
-
-	if (!hapd->ubus.notify_response) {
-		ubus_notify(ctx, &hapd->ubus.obj, type, b.head, -1);
-		return WLAN_STATUS_SUCCESS;
+	if (req->elems)
+		blobmsg_add_ht_vht_capabilities(
+			(const struct ieee80211_ht_capabilities *) req->elems->ht_capabilities,
+			(const struct ieee80211_vht_capabilities *) req->elems->vht_capabilities);
+
+	/*
+	 * With the admission cache the verdict is already known (or the
+	 * client is admitted by default), so the event is only forwarded and
+	 * the event loop never waits for the subscriber.
+	 */
+	if (!hapd->ubus.notify_response || hapd->ubus.admission_cache) {
+		if (!ubus_notify(ctx, &hapd->ubus.obj, type, b.head, -1))
+			hapd->ubus.events_forwarded++;
+		return resp;
 	}
 
 	if (ubus_notify_async(ctx, &hapd->ubus.obj, type, b.head, &ureq.nreq))
 		return WLAN_STATUS_SUCCESS;
 
+	hapd->ubus.events_forwarded++;
+
 	ureq.nreq.status_cb = ubus_event_cb;
 	ubus_complete_request(ctx, &ureq.nreq.req, 100);
 
@@ -1849,6 +2449,8 @@ int hostapd_ubus_handle_event(struct hostapd_data *hapd, struct hostapd_ubus_req
 
 void hostapd_ubus_notify(struct hostapd_data *hapd, const char *type, const u8 *addr)
 {
+	hostapd_ubus_sta_changed(hapd);
+
 	if (!hapd->ubus.obj.has_subscribers)
 		return;
 
@@ -1864,6 +2466,8 @@ void hostapd_ubus_notify(struct hostapd_data *hapd, const char *type, const u8 *
 void hostapd_ubus_notify_authorized(struct hostapd_data *hapd, struct sta_info *sta,
 				    const char *auth_alg)
 {
+	hostapd_ubus_sta_changed(hapd);
+
 	if (!hapd->ubus.obj.has_subscribers)
 		return;
 
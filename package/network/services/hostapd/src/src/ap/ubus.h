@@ -40,6 +40,17 @@ struct hostapd_ubus_bss {
 	struct ubus_object obj;
 	struct avl_tree banned;
 	int notify_response;
+	bool admission_cache;
+	u64 admission_hits;
+	u64 admission_misses;
+	u64 events_forwarded;
+	struct avl_tree probes;
+	int probe_summary_interval;
+	struct avl_tree sta_state;
+	u32 sta_generation;
+	u32 sta_generation_floor;
+	u32 sta_generation_notified;
+	bool sta_delta_notify;
 };
 
 void hostapd_ubus_add_iface(struct hostapd_iface *iface);
@@ -25,6 +25,7 @@
 #include <byteswap.h>
 #include <endian.h>
 #include <limits.h>
+#include <pthread.h>
 #include <unistd.h>
 #include <stdlib.h>
 #include <stdio.h>
@@ -83,6 +84,7 @@ enum mtd_image_format {
 };
 
 static char *buf = NULL;
+static char *cmpbuf = NULL;
 static char *imagefile = NULL;
 static enum mtd_image_format imageformat = MTD_IMAGE_FORMAT_UNKNOWN;
 static char *jffs2file = NULL, *jffs2dir = JFFS2_DEFAULT_DIR;
@@ -90,6 +92,7 @@ static char *tpl_uboot_args_part;
 static int buflen = 0;
 int quiet;
 int no_erase;
+int delta_write;
 int mtdsize = 0;
 int erasesize = 0;
 int jffs2_skip_bytes=0;
@@ -184,6 +187,29 @@ int mtd_write_buffer(int fd, const char *buf, int offset, int length)
 	return 0;
 }
 
+/*
+ * Compare one erase block on flash with the data about to be written.
+ * Any read problem counts as a difference, so the block simply gets
+ * rewritten as usual.
+ */
+static int mtd_block_unchanged(int fd, const char *data, off_t offset)
+{
+	ssize_t len = 0;
+	ssize_t r;
+
+	while (len < erasesize) {
+		r = pread(fd, cmpbuf + len, erasesize - len, offset + len);
+		if (r < 0 && errno == EINTR)
+			continue;
+		if (r <= 0)
+			return 0;
+
+		len += r;
+	}
+
+	return memcmp(cmpbuf, data, erasesize) == 0;
+}
+
 static int
 image_check(int imagefd, const char *mtd)
 {
@@ -260,6 +286,9 @@ static int mtd_check(const char *mtd)
 		if (!buf)
 			buf = malloc(erasesize);
 
+		if (delta_write && !cmpbuf)
+			cmpbuf = malloc(erasesize);
+
 		close(fd);
 		mtd = next;
 	} while (next);
@@ -456,6 +485,158 @@ out:
 	return ret;
 }
 
+/*
+ * The image usually arrives through a pipe (wget, ssh), so reading it
+ * is slow and so is erasing and programming NOR flash. A helper thread
+ * reads the image ahead into PREFETCH_BUFS erase block sized buffers,
+ * so the next block is being received while the current one is being
+ * erased and written. mtd_write() consumes the data through
+ * prefetch_read(), which has the same semantics as read().
+ */
+#define PREFETCH_BUFS	2
+
+static struct {
+	pthread_t thread;
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+	char *data[PREFETCH_BUFS];
+	ssize_t len[PREFETCH_BUFS];
+	int head;	/* buffer consumed next */
+	int count;	/* number of filled buffers */
+	ssize_t pos;	/* read position inside the head buffer */
+	ssize_t size;
+	int fd;
+	int err;
+	bool eof;
+	bool active;
+} prefetch = {
+	.lock = PTHREAD_MUTEX_INITIALIZER,
+	.cond = PTHREAD_COND_INITIALIZER,
+};
+
+static void *prefetch_thread(void *arg)
+{
+	bool done = false;
+
+	while (!done) {
+		ssize_t len = 0, r;
+		int err = 0;
+		int idx;
+
+		pthread_mutex_lock(&prefetch.lock);
+		while (prefetch.count == PREFETCH_BUFS)
+			pthread_cond_wait(&prefetch.cond, &prefetch.lock);
+		idx = (prefetch.head + prefetch.count) % PREFETCH_BUFS;
+		pthread_mutex_unlock(&prefetch.lock);
+
+		while (len < prefetch.size) {
+			r = read(prefetch.fd, prefetch.data[idx] + len, prefetch.size - len);
+			if (r < 0) {
+				if ((errno == EINTR) || (errno == EAGAIN))
+					continue;
+
+				err = errno;
+				break;
+			}
+
+			if (r == 0)
+				break;
+
+			len += r;
+		}
+
+		done = err || len < prefetch.size;
+
+		pthread_mutex_lock(&prefetch.lock);
+		prefetch.len[idx] = len;
+		if (len > 0)
+			prefetch.count++;
+		prefetch.err = err;
+		prefetch.eof = done;
+		pthread_cond_signal(&prefetch.cond);
+		pthread_mutex_unlock(&prefetch.lock);
+	}
+
+	return NULL;
+}
+
+static void prefetch_start(int imagefd)
+{
+	int i;
+
+	prefetch.fd = imagefd;
+	prefetch.size = erasesize;
+
+	for (i = 0; i < PREFETCH_BUFS; i++) {
+		prefetch.data[i] = malloc(prefetch.size);
+		if (!prefetch.data[i])
+			goto error;
+	}
+
+	if (pthread_create(&prefetch.thread, NULL, prefetch_thread, NULL))
+		goto error;
+
+	prefetch.active = true;
+	return;
+
+error:
+	/* fall back to reading the image synchronously */
+	for (i = 0; i < PREFETCH_BUFS; i++) {
+		free(prefetch.data[i]);
+		prefetch.data[i] = NULL;
+	}
+}
+
+static void prefetch_stop(void)
+{
+	int i;
+
+	if (!prefetch.active)
+		return;
+
+	/* only called once the thread has hit the end of the image */
+	pthread_join(prefetch.thread, NULL);
+	prefetch.active = false;
+
+	for (i = 0; i < PREFETCH_BUFS; i++) {
+		free(prefetch.data[i]);
+		prefetch.data[i] = NULL;
+	}
+}
+
+static ssize_t prefetch_read(int fd, char *dst, size_t len)
+{
+	ssize_t n;
+
+	if (!prefetch.active)
+		return read(fd, dst, len);
+
+	pthread_mutex_lock(&prefetch.lock);
+	while (!prefetch.count && !prefetch.eof)
+		pthread_cond_wait(&prefetch.cond, &prefetch.lock);
+
+	if (!prefetch.count) {
+		n = prefetch.err ? -1 : 0;
+		errno = prefetch.err;
+		goto out;
+	}
+
+	n = MIN((ssize_t) len, prefetch.len[prefetch.head] - prefetch.pos);
+	memcpy(dst, prefetch.data[prefetch.head] + prefetch.pos, n);
+	prefetch.pos += n;
+
+	if (prefetch.pos == prefetch.len[prefetch.head]) {
+		prefetch.head = (prefetch.head + 1) % PREFETCH_BUFS;
+		prefetch.count--;
+		prefetch.pos = 0;
+		pthread_cond_signal(&prefetch.cond);
+	}
+
+out:
+	pthread_mutex_unlock(&prefetch.lock);
+	return n;
+}
+
 static void
 indicate_writing(const char *mtd)
 {
@@ -478,6 +659,7 @@ mtd_write(int imagefd, const char *mtd, char *fis_layout, size_t part_offset)
 	int buflen_raw = 0;
 	int jffs2_replaced = 0;
 	int skip_bad_blocks = 0;
+	int n_skipped = 0, n_erased = 0, n_written = 0;
 
 #ifdef FIS_SUPPORT
 	static struct fis_part new_parts[MAX_ARGS];
@@ -542,6 +724,8 @@ next:
 		mtd = str;
 	}
 
+	prefetch_start(imagefd);
+
 	r = 0;
 
 resume:
@@ -578,7 +762,7 @@ resume:
 	for (;;) {
 		/* buffer may contain data already (from trx check or last mtd partition write attempt) */
 		while (buflen < erasesize) {
-			r = read(imagefd, buf + buflen, erasesize - buflen);
+			r = prefetch_read(imagefd, buf + buflen, erasesize - buflen);
 			if (r < 0) {
 				if ((errno == EINTR) || (errno == EAGAIN))
 					continue;
@@ -642,6 +826,34 @@ resume:
 			mtd_parse_jffs2data(buf, jffs2dir);
 		}
 
+		/*
+		 * In delta mode, leave whole blocks alone if the flash already
+		 * holds exactly this data. Only compare when the next block has
+		 * not been erased yet and the buffer covers it completely.
+		 */
+		if (delta_write && cmpbuf && !no_erase && !offset &&
+		    buflen == erasesize && w == e - skip_bad_blocks) {
+			while (mtd_block_is_bad(fd, e)) {
+				if (!quiet)
+					fprintf(stderr, "\nSkipping bad block at 0x%08zx   ", e);
+
+				skip_bad_blocks += erasesize;
+				e += erasesize;
+				lseek(fd, erasesize, SEEK_CUR);
+			}
+
+			if (mtd_block_unchanged(fd, buf, e + part_offset)) {
+				if (!quiet)
+					fprintf(stderr, "\b\b\b[s]");
+
+				lseek(fd, erasesize, SEEK_CUR);
+				e += erasesize;
+				w += buflen;
+				n_skipped++;
+				goto written;
+			}
+		}
+
 		/* need to erase the next block before writing data to it */
 		if(!no_erase)
 		{
@@ -681,6 +893,7 @@ resume:
 
 				/* erase the chunk */
 				e += erasesize;
+				n_erased++;
 			}
 		}
 
@@ -697,7 +910,9 @@ resume:
 			}
 		}
 		w += buflen;
+		n_written++;
 
+written:
 #ifdef FIS_SUPPORT
 		if (cur_part && cur_part->size
 		&& cur_part < &new_parts[MAX_ARGS - 1]
@@ -713,6 +928,8 @@ resume:
 		offset = 0;
 	}
 
+	prefetch_stop();
+
 	if (jffs2_replaced) {
 		switch (imageformat) {
 		case MTD_IMAGE_FORMAT_TRX:
@@ -742,6 +959,10 @@ resume:
 	if (quiet < 2)
 		fprintf(stderr, "\n");
 
+	if (delta_write && quiet < 2)
+		fprintf(stderr, "Delta write: %d blocks unchanged, %d erased, %d written\n",
+			n_skipped, n_erased, n_written);
+
 #ifdef FIS_SUPPORT
 	if (fis_layout) {
 		if (fis_remap(old_parts, n_old, new_parts, n_new) < 0)
@@ -801,6 +1022,8 @@ static void usage(void)
 	"        -q                      quiet mode (once: no [w] on writing,\n"
 	"                                           twice: no status messages)\n"
 	"        -n                      write without first erasing the blocks\n"
+	"        -D                      delta write: skip erase blocks whose contents\n"
+	"                                are already identical on flash\n"
 	"        -r                      reboot after successful command\n"
 	"        -f                      force write without trx checks\n"
 	"        -e <device>             erase <device> before executing the command\n"
@@ -874,12 +1097,13 @@ int main (int argc, char **argv)
 	buflen = 0;
 	quiet = 0;
 	no_erase = 0;
+	delta_write = 0;
 
 	while ((ch = getopt(argc, argv,
 #ifdef FIS_SUPPORT
 			"F:"
 #endif
-			"frnqe:d:s:j:p:o:c:t:l:M:")) != -1)
+			"frnDqe:d:s:j:p:o:c:t:l:M:")) != -1)
 		switch (ch) {
 			case 'f':
 				force = 1;
@@ -890,6 +1114,9 @@ int main (int argc, char **argv)
 			case 'n':
 				no_erase = 1;
 				break;
+			case 'D':
+				delta_write = 1;
+				break;
 			case 'j':
 				jffs2file = optarg;
 				break;
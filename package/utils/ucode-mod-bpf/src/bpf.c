@@ -2,6 +2,7 @@
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <net/if.h>
+#include <linux/if_link.h>
 
 #include <stdint.h>
 #include <stdio.h>
@@ -11,13 +12,25 @@
 #include <bpf/bpf.h>
 #include <bpf/libbpf.h>
 
+#include <libubox/uloop.h>
+
 #include "ucode/module.h"
 
 #define err_return_int(err, ...) do { set_error(err, __VA_ARGS__); return -1; } while(0)
 #define err_return(err, ...) do { set_error(err, __VA_ARGS__); return NULL; } while(0)
 #define TRUE ucv_boolean_new(true)
 
+#ifndef ENOTSUPP
+#define ENOTSUPP 524
+#endif
+
+#define UC_BPF_BATCH_SIZE	256
+#define UC_BPF_EVENT_BATCH	64
+#define UC_BPF_PERF_PAGES	8
+#define UC_BPF_PERCPU_STRIDE(size)	(((size) + 7) & ~7)
+
 static uc_resource_type_t *module_type, *map_type, *map_iter_type, *program_type;
+static uc_resource_type_t *consumer_type;
 static uc_value_t *registry;
 static uc_vm_t *debug_vm;
 
@@ -34,6 +47,46 @@ struct uc_bpf_fd {
 struct uc_bpf_map {
 	struct uc_bpf_fd fd; /* must be first */
 	unsigned int key_size, val_size;
+	unsigned int n_cpus; /* 0 for non per-CPU maps */
+	enum bpf_map_type type;
+};
+
+struct uc_bpf_consumer {
+	struct uloop_fd fd;
+	uc_vm_t *vm;
+
+	struct ring_buffer *rb;
+	struct perf_buffer *pb;
+
+	uc_value_t *records;
+	size_t registry_index;
+	unsigned int batch;
+	bool registered;
+	bool dispatching;
+	bool closed;
+
+	uint64_t n_records;
+	uint64_t n_batches;
+	uint64_t n_lost;
+};
+
+struct uc_bpf_batch_opts {
+	bool aggregate;
+	bool binary;
+	bool int_keys;
+	bool delete;
+};
+
+typedef void (*uc_bpf_batch_cb)(void *ctx, const void *keys, const void *vals,
+				__u32 count);
+
+struct uc_bpf_dump_ctx {
+	uc_vm_t *vm;
+	struct uc_bpf_map *map;
+	struct uc_bpf_batch_opts *opts;
+	uc_value_t *list;
+	uc_stringbuf_t *keys, *vals;
+	size_t count;
 };
 
 struct uc_bpf_map_iter {
@@ -187,16 +240,38 @@ uc_bpf_open_module(uc_vm_t *vm, size_t nargs)
 	return uc_resource_new(module_type, obj);
 }
 
+static bool
+uc_bpf_map_type_percpu(enum bpf_map_type type)
+{
+	switch (type) {
+	case BPF_MAP_TYPE_PERCPU_HASH:
+	case BPF_MAP_TYPE_PERCPU_ARRAY:
+	case BPF_MAP_TYPE_LRU_PERCPU_HASH:
+	case BPF_MAP_TYPE_PERCPU_CGROUP_STORAGE:
+		return true;
+	default:
+		return false;
+	}
+}
+
 static uc_value_t *
-uc_bpf_map_create(int fd, unsigned int key_size, unsigned int val_size, bool close)
+uc_bpf_map_create(int fd, unsigned int key_size, unsigned int val_size,
+		  enum bpf_map_type type, bool close)
 {
 	struct uc_bpf_map *uc_map;
+	int n_cpus;
 
 	uc_map = xalloc(sizeof(*uc_map));
 	uc_map->fd.fd = fd;
 	uc_map->key_size = key_size;
 	uc_map->val_size = val_size;
 	uc_map->fd.close = close;
+	uc_map->type = type;
+
+	if (uc_bpf_map_type_percpu(type)) {
+		n_cpus = libbpf_num_possible_cpus();
+		uc_map->n_cpus = n_cpus > 0 ? n_cpus : 1;
+	}
 
 	return uc_resource_new(map_type, uc_map);
 }
@@ -223,7 +298,7 @@ uc_bpf_open_map(uc_vm_t *vm, size_t nargs)
 		err_return(errno, NULL);
 	}
 
-	return uc_bpf_map_create(fd, info.key_size, info.value_size, true);
+	return uc_bpf_map_create(fd, info.key_size, info.value_size, info.type, true);
 }
 
 static uc_value_t *
@@ -284,7 +359,8 @@ uc_bpf_module_get_map(uc_vm_t *vm, size_t nargs)
 	if (fd < 0)
 		err_return(EINVAL, NULL);
 
-	return uc_bpf_map_create(fd, bpf_map__key_size(map), bpf_map__value_size(map), false);
+	return uc_bpf_map_create(fd, bpf_map__key_size(map), bpf_map__value_size(map),
+				 bpf_map__type(map), false);
 }
 
 static uc_value_t *
@@ -361,11 +437,145 @@ uc_bpf_map_arg(uc_value_t *val, const char *kind, unsigned int size)
 	err_return(EINVAL, "%s size mismatch (expected: %d)", kind, size);
 }
 
+static bool
+uc_bpf_batch_unsupported(int err)
+{
+	return err == EINVAL || err == EOPNOTSUPP || err == ENOTSUPP;
+}
+
+static unsigned int
+uc_bpf_map_value_size(struct uc_bpf_map *map)
+{
+	if (!map->n_cpus)
+		return map->val_size;
+
+	return UC_BPF_PERCPU_STRIDE(map->val_size) * map->n_cpus;
+}
+
+static int
+uc_bpf_batch_opts_parse(uc_value_t *opts, struct uc_bpf_batch_opts *o)
+{
+	memset(o, 0, sizeof(*o));
+
+	if (!opts)
+		return 0;
+
+	if (ucv_type(opts) != UC_OBJECT)
+		err_return_int(EINVAL, "options argument");
+
+	o->aggregate = ucv_is_truish(ucv_object_get(opts, "aggregate", NULL));
+	o->binary = ucv_is_truish(ucv_object_get(opts, "binary", NULL));
+	o->int_keys = ucv_is_truish(ucv_object_get(opts, "int_keys", NULL));
+	o->delete = ucv_is_truish(ucv_object_get(opts, "delete", NULL));
+
+	return 0;
+}
+
+/* sum per-CPU values as 64 bit (or 32 bit, if the size requires it) counters */
+static bool
+uc_bpf_map_percpu_sum(struct uc_bpf_map *map, const void *val, void *sum)
+{
+	unsigned int stride = UC_BPF_PERCPU_STRIDE(map->val_size);
+	unsigned int cpu, i;
+
+	memset(sum, 0, map->val_size);
+	if (!(map->val_size % 8)) {
+		uint64_t *dest = sum;
+
+		for (cpu = 0; cpu < map->n_cpus; cpu++, val += stride)
+			for (i = 0; i < map->val_size / 8; i++)
+				dest[i] += ((const uint64_t *)val)[i];
+	} else if (!(map->val_size % 4)) {
+		uint32_t *dest = sum;
+
+		for (cpu = 0; cpu < map->n_cpus; cpu++, val += stride)
+			for (i = 0; i < map->val_size / 4; i++)
+				dest[i] += ((const uint32_t *)val)[i];
+	} else {
+		return false;
+	}
+
+	return true;
+}
+
+static uc_value_t *
+uc_bpf_map_key_new(struct uc_bpf_map *map, const void *key, bool int_keys)
+{
+	uint32_t val32;
+	uint64_t val64;
+
+	if (int_keys && map->key_size == 4) {
+		memcpy(&val32, key, sizeof(val32));
+		return ucv_int64_new(val32);
+	}
+
+	if (int_keys && map->key_size == 8) {
+		memcpy(&val64, key, sizeof(val64));
+		return ucv_int64_new(val64);
+	}
+
+	return ucv_string_new_length(key, map->key_size);
+}
+
+static uc_value_t *
+uc_bpf_map_value_new(uc_vm_t *vm, struct uc_bpf_map *map, const void *val,
+		     bool aggregate)
+{
+	unsigned int stride = UC_BPF_PERCPU_STRIDE(map->val_size);
+	unsigned int cpu;
+	uc_value_t *rv;
+	void *sum;
+
+	if (!map->n_cpus)
+		return ucv_string_new_length(val, map->val_size);
+
+	sum = alloca(map->val_size);
+	if (aggregate && uc_bpf_map_percpu_sum(map, val, sum))
+		return ucv_string_new_length(sum, map->val_size);
+
+	rv = ucv_array_new(vm);
+	for (cpu = 0; cpu < map->n_cpus; cpu++, val += stride)
+		ucv_array_push(rv, ucv_string_new_length(val, map->val_size));
+
+	return rv;
+}
+
+static bool
+uc_bpf_map_value_put(struct uc_bpf_map *map, uc_value_t *val, void *dest)
+{
+	unsigned int stride = UC_BPF_PERCPU_STRIDE(map->val_size);
+	unsigned int cpu;
+	void *data;
+
+	/* per-CPU maps take either the raw value for all CPUs or one value
+	 * which is copied to every CPU */
+	if (map->n_cpus && ucv_type(val) == UC_STRING &&
+	    ucv_string_length(val) == uc_bpf_map_value_size(map)) {
+		memcpy(dest, ucv_string_get(val), uc_bpf_map_value_size(map));
+		return true;
+	}
+
+	data = uc_bpf_map_arg(val, "value", map->val_size);
+	if (!data)
+		return false;
+
+	if (!map->n_cpus) {
+		memcpy(dest, data, map->val_size);
+		return true;
+	}
+
+	for (cpu = 0; cpu < map->n_cpus; cpu++)
+		memcpy(dest + cpu * stride, data, map->val_size);
+
+	return true;
+}
+
 static uc_value_t *
 uc_bpf_map_get(uc_vm_t *vm, size_t nargs)
 {
 	struct uc_bpf_map *map = uc_fn_thisval("bpf.map");
 	uc_value_t *a_key = uc_fn_arg(0);
+	uc_value_t *rv = NULL;
 	void *key, *val;
 
 	if (!map)
@@ -375,11 +585,12 @@ uc_bpf_map_get(uc_vm_t *vm, size_t nargs)
 	if (!key)
 		return NULL;
 
-	val = alloca(map->val_size);
-	if (bpf_map_lookup_elem(map->fd.fd, key, val))
-		return NULL;
+	val = xalloc(uc_bpf_map_value_size(map));
+	if (!bpf_map_lookup_elem(map->fd.fd, key, val))
+		rv = uc_bpf_map_value_new(vm, map, val, false);
+	free(val);
 
-	return ucv_string_new_length(val, map->val_size);
+	return rv;
 }
 
 static uc_value_t *
@@ -389,20 +600,13 @@ uc_bpf_map_set(uc_vm_t *vm, size_t nargs)
 	uc_value_t *a_key = uc_fn_arg(0);
 	uc_value_t *a_val = uc_fn_arg(1);
 	uc_value_t *a_flags = uc_fn_arg(2);
+	uc_value_t *rv = NULL;
 	uint64_t flags;
 	void *key, *val;
 
 	if (!map)
 		err_return(EINVAL, NULL);
 
-	key = uc_bpf_map_arg(a_key, "key", map->key_size);
-	if (!key)
-		return NULL;
-
-	val = uc_bpf_map_arg(a_val, "value", map->val_size);
-	if (!val)
-		return NULL;
-
 	if (!a_flags)
 		flags = BPF_ANY;
 	else if (ucv_type(a_flags) != UC_INTEGER)
@@ -410,10 +614,19 @@ uc_bpf_map_set(uc_vm_t *vm, size_t nargs)
 	else
 		flags = ucv_int64_get(a_flags);
 
-	if (bpf_map_update_elem(map->fd.fd, key, val, flags))
-		return NULL;
+	/* copy the value first, integer keys and values share a buffer */
+	val = xalloc(uc_bpf_map_value_size(map));
+	if (!uc_bpf_map_value_put(map, a_val, val))
+		goto out;
+
+	key = uc_bpf_map_arg(a_key, "key", map->key_size);
+	if (key && !bpf_map_update_elem(map->fd.fd, key, val, flags))
+		rv = uc_bpf_map_value_new(vm, map, val, false);
 
-	return ucv_string_new_length(val, map->val_size);
+out:
+	free(val);
+
+	return rv;
 }
 
 static uc_value_t *
@@ -422,7 +635,8 @@ uc_bpf_map_delete(uc_vm_t *vm, size_t nargs)
 	struct uc_bpf_map *map = uc_fn_thisval("bpf.map");
 	uc_value_t *a_key = uc_fn_arg(0);
 	uc_value_t *a_return = uc_fn_arg(1);
-	void *key, *val = NULL;
+	uc_value_t *rv = NULL;
+	void *key, *val;
 	int ret;
 
 	if (!map)
@@ -438,11 +652,384 @@ uc_bpf_map_delete(uc_vm_t *vm, size_t nargs)
 		return ucv_boolean_new(ret == 0);
 	}
 
-	val = alloca(map->val_size);
-	if (bpf_map_lookup_and_delete_elem(map->fd.fd, key, val))
+	val = xalloc(uc_bpf_map_value_size(map));
+	if (!bpf_map_lookup_and_delete_elem(map->fd.fd, key, val))
+		rv = uc_bpf_map_value_new(vm, map, val, false);
+	free(val);
+
+	return rv;
+}
+
+/* convert an array of keys/values or a binary blob of concatenated elements */
+static void *
+uc_bpf_map_pack(struct uc_bpf_map *map, uc_value_t *list, bool is_val,
+		__u32 *count)
+{
+	unsigned int size = is_val ? uc_bpf_map_value_size(map) : map->key_size;
+	const char *kind = is_val ? "value" : "key";
+	uc_value_t *cur;
+	void *buf, *data;
+	size_t i, len;
+
+	switch (ucv_type(list)) {
+	case UC_STRING:
+		len = ucv_string_length(list);
+		if (len % size)
+			err_return(EINVAL, "%s data size mismatch (expected multiple of %d)",
+				   kind, size);
+
+		*count = len / size;
+		buf = xalloc(len + 1);
+		memcpy(buf, ucv_string_get(list), len);
+
+		return buf;
+	case UC_ARRAY:
+		len = ucv_array_length(list);
+		*count = len;
+		buf = xalloc(len * size + 1);
+		for (i = 0; i < len; i++) {
+			cur = ucv_array_get(list, i);
+			if (is_val) {
+				if (!uc_bpf_map_value_put(map, cur, buf + i * size))
+					goto error;
+
+				continue;
+			}
+
+			data = uc_bpf_map_arg(cur, kind, size);
+			if (!data)
+				goto error;
+
+			memcpy(buf + i * size, data, size);
+		}
+
+		return buf;
+	default:
+		err_return(EINVAL, "%s list", kind);
+	}
+
+error:
+	free(buf);
+	return NULL;
+}
+
+static int
+uc_bpf_map_walk_single(struct uc_bpf_map *map, bool del, uc_bpf_batch_cb cb,
+		       void *ctx)
+{
+	bool has_next;
+	void *key, *next, *val;
+
+	key = alloca(map->key_size);
+	next = alloca(map->key_size);
+	val = xalloc(uc_bpf_map_value_size(map));
+	has_next = !bpf_map_get_next_key(map->fd.fd, NULL, next);
+	while (has_next) {
+		memcpy(key, next, map->key_size);
+		has_next = !bpf_map_get_next_key(map->fd.fd, next, next);
+
+		if (bpf_map_lookup_elem(map->fd.fd, key, val))
+			continue;
+
+		if (del)
+			bpf_map_delete_elem(map->fd.fd, key);
+
+		if (cb)
+			cb(ctx, key, val, 1);
+	}
+	free(val);
+
+	return 0;
+}
+
+/*
+ * Walk all map elements with (lookup_and_delete_)batch calls, falling back to
+ * per-element syscalls on kernels or map types without batch support.
+ */
+static int
+uc_bpf_map_walk(struct uc_bpf_map *map, bool del, uc_bpf_batch_cb cb, void *ctx)
+{
+	DECLARE_LIBBPF_OPTS(bpf_map_batch_opts, opts);
+	unsigned int val_len = uc_bpf_map_value_size(map);
+	unsigned int token_len = map->key_size > 8 ? map->key_size : 8;
+	__u32 n = UC_BPF_BATCH_SIZE, count;
+	void *keys, *vals, *in, *out;
+	bool first = true;
+	int ret, err;
+
+	in = alloca(token_len);
+	out = alloca(token_len);
+	keys = xalloc(n * map->key_size);
+	vals = xalloc(n * val_len);
+
+	while (1) {
+		count = n;
+		if (del)
+			ret = bpf_map_lookup_and_delete_batch(map->fd.fd,
+							      first ? NULL : in, out,
+							      keys, vals, &count, &opts);
+		else
+			ret = bpf_map_lookup_batch(map->fd.fd, first ? NULL : in, out,
+						   keys, vals, &count, &opts);
+		err = ret ? errno : 0;
+
+		if (first && !count && uc_bpf_batch_unsupported(err)) {
+			err = uc_bpf_map_walk_single(map, del, cb, ctx);
+			break;
+		}
+
+		/* a hash bucket did not fit into the buffer */
+		if (err == ENOSPC && !count) {
+			n *= 2;
+			keys = xrealloc(keys, n * map->key_size);
+			vals = xrealloc(vals, n * val_len);
+			continue;
+		}
+
+		if (count && cb)
+			cb(ctx, keys, vals, count);
+
+		if (err)
+			break;
+
+		memcpy(in, out, token_len);
+		first = false;
+	}
+
+	free(keys);
+	free(vals);
+
+	return err == ENOENT ? 0 : err;
+}
+
+static void
+uc_bpf_map_dump_cb(void *ptr, const void *keys, const void *vals, __u32 count)
+{
+	struct uc_bpf_dump_ctx *ctx = ptr;
+	struct uc_bpf_map *map = ctx->map;
+	unsigned int val_len = uc_bpf_map_value_size(map);
+	void *sum = alloca(map->val_size);
+	uc_value_t *entry;
+	__u32 i;
+
+	for (i = 0; i < count; i++, keys += map->key_size, vals += val_len) {
+		ctx->count++;
+
+		if (!ctx->opts->binary) {
+			entry = ucv_array_new(ctx->vm);
+			ucv_array_push(entry, uc_bpf_map_key_new(map, keys, ctx->opts->int_keys));
+			ucv_array_push(entry, uc_bpf_map_value_new(ctx->vm, map, vals,
+								   ctx->opts->aggregate));
+			ucv_array_push(ctx->list, entry);
+			continue;
+		}
+
+		ucv_stringbuf_addstr(ctx->keys, keys, map->key_size);
+		if (map->n_cpus && ctx->opts->aggregate &&
+		    uc_bpf_map_percpu_sum(map, vals, sum))
+			ucv_stringbuf_addstr(ctx->vals, sum, map->val_size);
+		else
+			ucv_stringbuf_addstr(ctx->vals, vals, val_len);
+	}
+}
+
+static uc_value_t *
+uc_bpf_map_dump(uc_vm_t *vm, size_t nargs)
+{
+	struct uc_bpf_map *map = uc_fn_thisval("bpf.map");
+	struct uc_bpf_batch_opts opts;
+	struct uc_bpf_dump_ctx ctx = {
+		.vm = vm,
+		.map = map,
+		.opts = &opts,
+	};
+	uc_value_t *rv;
+	int err;
+
+	if (!map)
+		err_return(EINVAL, NULL);
+
+	if (uc_bpf_batch_opts_parse(uc_fn_arg(0), &opts))
+		return NULL;
+
+	if (opts.binary) {
+		ctx.keys = ucv_stringbuf_new();
+		ctx.vals = ucv_stringbuf_new();
+	} else {
+		ctx.list = ucv_array_new(vm);
+	}
+
+	err = uc_bpf_map_walk(map, opts.delete, uc_bpf_map_dump_cb, &ctx);
+
+	if (!opts.binary) {
+		rv = ctx.list;
+	} else {
+		rv = ucv_object_new(vm);
+		ucv_object_add(rv, "count", ucv_int64_new(ctx.count));
+		ucv_object_add(rv, "keys", ucv_stringbuf_finish(ctx.keys));
+		ucv_object_add(rv, "values", ucv_stringbuf_finish(ctx.vals));
+	}
+
+	if (err) {
+		ucv_put(rv);
+		err_return(err, NULL);
+	}
+
+	return rv;
+}
+
+static uc_value_t *
+uc_bpf_map_get_batch(uc_vm_t *vm, size_t nargs)
+{
+	struct uc_bpf_map *map = uc_fn_thisval("bpf.map");
+	uc_value_t *a_keys = uc_fn_arg(0);
+	struct uc_bpf_batch_opts opts;
+	void *keys, *val;
+	uc_value_t *rv;
+	__u32 count, i;
+
+	if (!map)
+		err_return(EINVAL, NULL);
+
+	if (uc_bpf_batch_opts_parse(uc_fn_arg(1), &opts))
+		return NULL;
+
+	keys = uc_bpf_map_pack(map, a_keys, false, &count);
+	if (!keys)
+		return NULL;
+
+	/* the kernel only batches lookups by position, not by key */
+	rv = ucv_array_new(vm);
+	val = xalloc(uc_bpf_map_value_size(map));
+	for (i = 0; i < count; i++) {
+		if (bpf_map_lookup_elem(map->fd.fd, keys + i * map->key_size, val))
+			ucv_array_set(rv, i, NULL);
+		else
+			ucv_array_set(rv, i, uc_bpf_map_value_new(vm, map, val, opts.aggregate));
+	}
+
+	free(keys);
+	free(val);
+
+	return rv;
+}
+
+static uc_value_t *
+uc_bpf_map_set_batch(uc_vm_t *vm, size_t nargs)
+{
+	DECLARE_LIBBPF_OPTS(bpf_map_batch_opts, opts);
+	struct uc_bpf_map *map = uc_fn_thisval("bpf.map");
+	uc_value_t *a_keys = uc_fn_arg(0);
+	uc_value_t *a_vals = uc_fn_arg(1);
+	uc_value_t *a_flags = uc_fn_arg(2);
+	unsigned int val_len;
+	__u32 n_keys, n_vals, count, i;
+	void *keys = NULL, *vals = NULL;
+	uc_value_t *rv = NULL;
+	int err = 0;
+
+	if (!map)
+		err_return(EINVAL, NULL);
+
+	if (!a_flags)
+		opts.elem_flags = BPF_ANY;
+	else if (ucv_type(a_flags) != UC_INTEGER)
+		err_return(EINVAL, "flags");
+	else
+		opts.elem_flags = ucv_int64_get(a_flags);
+
+	keys = uc_bpf_map_pack(map, a_keys, false, &n_keys);
+	if (!keys)
+		goto out;
+
+	vals = uc_bpf_map_pack(map, a_vals, true, &n_vals);
+	if (!vals)
+		goto out;
+
+	if (n_keys != n_vals) {
+		set_error(EINVAL, "key/value count mismatch");
+		goto out;
+	}
+
+	count = n_keys;
+	if (count && bpf_map_update_batch(map->fd.fd, keys, vals, &count, &opts)) {
+		err = errno;
+		if (count || !uc_bpf_batch_unsupported(err))
+			goto error;
+
+		val_len = uc_bpf_map_value_size(map);
+		for (i = 0; i < n_keys; i++, count++)
+			if (bpf_map_update_elem(map->fd.fd, keys + i * map->key_size,
+						vals + i * val_len, opts.elem_flags))
+				break;
+
+		if (count < n_keys) {
+			err = errno;
+			goto error;
+		}
+	}
+
+	rv = ucv_int64_new(count);
+	goto out;
+
+error:
+	set_error(err, "%u of %u elements updated", count, n_keys);
+out:
+	free(keys);
+	free(vals);
+
+	return rv;
+}
+
+static uc_value_t *
+uc_bpf_map_delete_batch(uc_vm_t *vm, size_t nargs)
+{
+	DECLARE_LIBBPF_OPTS(bpf_map_batch_opts, opts);
+	struct uc_bpf_map *map = uc_fn_thisval("bpf.map");
+	uc_value_t *a_keys = uc_fn_arg(0);
+	__u32 n_keys, done = 0, deleted = 0, count;
+	void *keys;
+	int err;
+
+	if (!map)
+		err_return(EINVAL, NULL);
+
+	keys = uc_bpf_map_pack(map, a_keys, false, &n_keys);
+	if (!keys)
 		return NULL;
 
-	return ucv_string_new_length(val, map->val_size);
+	while (done < n_keys) {
+		count = n_keys - done;
+		if (!bpf_map_delete_batch(map->fd.fd, keys + done * map->key_size,
+					  &count, &opts)) {
+			deleted += count;
+			break;
+		}
+
+		err = errno;
+		deleted += count;
+		done += count;
+
+		/* the kernel stops at the first missing key */
+		if (err == ENOENT) {
+			done++;
+			continue;
+		}
+
+		if (!done && uc_bpf_batch_unsupported(err)) {
+			for (; done < n_keys; done++)
+				if (!bpf_map_delete_elem(map->fd.fd, keys + done * map->key_size))
+					deleted++;
+			break;
+		}
+
+		free(keys);
+		err_return(err, NULL);
+	}
+
+	free(keys);
+
+	return ucv_int64_new(deleted);
 }
 
 static uc_value_t *
@@ -456,6 +1043,15 @@ uc_bpf_map_delete_all(uc_vm_t *vm, size_t nargs)
 	if (!map)
 		err_return(EINVAL, NULL);
 
+	if (!ucv_is_callable(filter)) {
+		int err = uc_bpf_map_walk(map, true, NULL, NULL);
+
+		if (err)
+			err_return(err, NULL);
+
+		return TRUE;
+	}
+
 	key = alloca(map->key_size);
 	next = alloca(map->key_size);
 	has_next = !bpf_map_get_next_key(map->fd.fd, NULL, next);
@@ -582,6 +1178,251 @@ uc_bpf_map_foreach(uc_vm_t *vm, size_t nargs)
 	return ucv_boolean_new(ret);
 }
 
+static size_t
+uc_bpf_registry_add(uc_value_t *val)
+{
+	size_t i;
+
+	/* slot 0 is used by the debug handler */
+	for (i = 1; i < ucv_array_length(registry); i++)
+		if (!ucv_array_get(registry, i))
+			break;
+
+	ucv_array_set(registry, i, ucv_get(val));
+
+	return i;
+}
+
+static void
+uc_bpf_consumer_flush(struct uc_bpf_consumer *c)
+{
+	uc_value_t *records = c->records;
+	uc_vm_t *vm = c->vm;
+
+	if (!ucv_array_length(records))
+		return;
+
+	c->records = ucv_array_new(vm);
+	c->n_batches++;
+
+	uc_vm_stack_push(vm, ucv_get(ucv_array_get(registry, c->registry_index)));
+	uc_vm_stack_push(vm, records);
+	if (uc_vm_call(vm, false, 1) == EXCEPTION_NONE)
+		ucv_put(uc_vm_stack_pop(vm));
+}
+
+static int
+uc_bpf_consumer_add(struct uc_bpf_consumer *c, const void *data, size_t size)
+{
+	/* copied once, straight from the ring/perf buffer mapping */
+	ucv_array_push(c->records, ucv_string_new_length(data, size));
+	c->n_records++;
+
+	if (ucv_array_length(c->records) >= c->batch)
+		uc_bpf_consumer_flush(c);
+
+	return c->closed ? -ECANCELED : 0;
+}
+
+static int
+uc_bpf_ringbuf_sample(void *ctx, void *data, size_t size)
+{
+	return uc_bpf_consumer_add(ctx, data, size);
+}
+
+static void
+uc_bpf_perf_sample(void *ctx, int cpu, void *data, __u32 size)
+{
+	uc_bpf_consumer_add(ctx, data, size);
+}
+
+static void
+uc_bpf_perf_lost(void *ctx, int cpu, __u64 cnt)
+{
+	struct uc_bpf_consumer *c = ctx;
+
+	c->n_lost += cnt;
+}
+
+static void
+uc_bpf_consumer_release(struct uc_bpf_consumer *c)
+{
+	if (c->registered)
+		uloop_fd_delete(&c->fd);
+	c->registered = false;
+
+	ring_buffer__free(c->rb);
+	c->rb = NULL;
+	perf_buffer__free(c->pb);
+	c->pb = NULL;
+
+	if (c->registry_index)
+		ucv_array_set(registry, c->registry_index, NULL);
+	c->registry_index = 0;
+
+	ucv_put(c->records);
+	c->records = NULL;
+}
+
+static int
+uc_bpf_consumer_run(struct uc_bpf_consumer *c, int timeout)
+{
+	int ret;
+
+	if (c->closed)
+		return -EBADF;
+
+	c->dispatching = true;
+	if (c->rb)
+		ret = timeout ? ring_buffer__poll(c->rb, timeout) :
+				ring_buffer__consume(c->rb);
+	else
+		ret = timeout ? perf_buffer__poll(c->pb, timeout) :
+				perf_buffer__consume(c->pb);
+	if (!c->closed)
+		uc_bpf_consumer_flush(c);
+	c->dispatching = false;
+
+	/* closed from within the callback */
+	if (c->closed)
+		uc_bpf_consumer_release(c);
+
+	return ret == -ECANCELED ? 0 : ret;
+}
+
+static void
+uc_bpf_consumer_fd_cb(struct uloop_fd *fd, unsigned int events)
+{
+	struct uc_bpf_consumer *c = container_of(fd, struct uc_bpf_consumer, fd);
+
+	uc_bpf_consumer_run(c, 0);
+}
+
+static uc_value_t *
+uc_bpf_map_consumer(uc_vm_t *vm, size_t nargs, bool perf)
+{
+	struct uc_bpf_map *map = uc_fn_thisval("bpf.map");
+	uc_value_t *cb = uc_fn_arg(0);
+	uc_value_t *opts = uc_fn_arg(1);
+	uint64_t batch = UC_BPF_EVENT_BATCH;
+	uint64_t pages = UC_BPF_PERF_PAGES;
+	struct uc_bpf_consumer *c;
+	uc_value_t *val;
+	int err;
+
+	if (!map || !ucv_is_callable(cb))
+		err_return(EINVAL, NULL);
+
+	if (map->type != (perf ? BPF_MAP_TYPE_PERF_EVENT_ARRAY : BPF_MAP_TYPE_RINGBUF))
+		err_return(EINVAL, "map type");
+
+	if (opts && ucv_type(opts) != UC_OBJECT)
+		err_return(EINVAL, "options argument");
+
+	if ((val = ucv_object_get(opts, "batch", NULL)) != NULL) {
+		if (ucv_type(val) != UC_INTEGER || ucv_int64_get(val) < 1)
+			err_return(EINVAL, "batch");
+		batch = ucv_int64_get(val);
+	}
+
+	if ((val = ucv_object_get(opts, "pages", NULL)) != NULL) {
+		if (ucv_type(val) != UC_INTEGER || ucv_int64_get(val) < 1)
+			err_return(EINVAL, "pages");
+		pages = ucv_int64_get(val);
+	}
+
+	c = xalloc(sizeof(*c));
+	c->vm = vm;
+	c->batch = batch;
+
+	if (perf)
+		c->pb = perf_buffer__new(map->fd.fd, pages, uc_bpf_perf_sample,
+					 uc_bpf_perf_lost, c, NULL);
+	else
+		c->rb = ring_buffer__new(map->fd.fd, uc_bpf_ringbuf_sample, c, NULL);
+
+	if (!c->pb && !c->rb) {
+		err = errno;
+		free(c);
+		err_return(err, NULL);
+	}
+
+	c->records = ucv_array_new(vm);
+	c->registry_index = uc_bpf_registry_add(cb);
+
+	/* without a running uloop, records can still be fetched with poll() */
+	c->fd.fd = perf ? perf_buffer__epoll_fd(c->pb) : ring_buffer__epoll_fd(c->rb);
+	c->fd.cb = uc_bpf_consumer_fd_cb;
+	if (!uloop_init() && !uloop_fd_add(&c->fd, ULOOP_READ))
+		c->registered = true;
+
+	return uc_resource_new(consumer_type, c);
+}
+
+static uc_value_t *
+uc_bpf_map_ringbuf(uc_vm_t *vm, size_t nargs)
+{
+	return uc_bpf_map_consumer(vm, nargs, false);
+}
+
+static uc_value_t *
+uc_bpf_map_perf_buffer(uc_vm_t *vm, size_t nargs)
+{
+	return uc_bpf_map_consumer(vm, nargs, true);
+}
+
+static uc_value_t *
+uc_bpf_consumer_poll(uc_vm_t *vm, size_t nargs)
+{
+	struct uc_bpf_consumer *c = uc_fn_thisval("bpf.consumer");
+	uc_value_t *timeout = uc_fn_arg(0);
+	int ret;
+
+	if (!c || (timeout && ucv_type(timeout) != UC_INTEGER))
+		err_return(EINVAL, NULL);
+
+	ret = uc_bpf_consumer_run(c, timeout ? ucv_int64_get(timeout) : 0);
+	if (ret < 0)
+		err_return(-ret, NULL);
+
+	return ucv_int64_new(ret);
+}
+
+static uc_value_t *
+uc_bpf_consumer_stats(uc_vm_t *vm, size_t nargs)
+{
+	struct uc_bpf_consumer *c = uc_fn_thisval("bpf.consumer");
+	uc_value_t *rv;
+
+	if (!c)
+		err_return(EINVAL, NULL);
+
+	rv = ucv_object_new(vm);
+	ucv_object_add(rv, "records", ucv_int64_new(c->n_records));
+	ucv_object_add(rv, "batches", ucv_int64_new(c->n_batches));
+	ucv_object_add(rv, "lost", ucv_int64_new(c->n_lost));
+	if (c->rb)
+		ucv_object_add(rv, "backlog",
+			       ucv_int64_new(ring__avail_data_size(ring_buffer__ring(c->rb, 0))));
+
+	return rv;
+}
+
+static uc_value_t *
+uc_bpf_consumer_close(uc_vm_t *vm, size_t nargs)
+{
+	struct uc_bpf_consumer *c = uc_fn_thisval("bpf.consumer");
+
+	if (!c)
+		err_return(EINVAL, NULL);
+
+	c->closed = true;
+	if (!c->dispatching)
+		uc_bpf_consumer_release(c);
+
+	return TRUE;
+}
+
 static uc_value_t *
 uc_bpf_obj_pin(uc_vm_t *vm, size_t nargs, const char *type)
 {
@@ -684,6 +1525,183 @@ uc_bpf_tc_detach(uc_vm_t *vm, size_t nargs)
 	return uc_bpf_set_tc_hook(ifname, type, prio, -1);
 }
 
+static int
+uc_bpf_xdp_flags(uc_value_t *mode, uc_value_t *flags, __u32 *val)
+{
+	const char *mode_str;
+
+	*val = 0;
+	if (flags) {
+		if (ucv_type(flags) != UC_INTEGER)
+			err_return_int(EINVAL, "flags");
+
+		*val = ucv_int64_get(flags);
+	}
+
+	if (!mode)
+		return 0;
+
+	if (ucv_type(mode) != UC_STRING)
+		err_return_int(EINVAL, "mode");
+
+	mode_str = ucv_string_get(mode);
+	if (!strcmp(mode_str, "native") || !strcmp(mode_str, "drv"))
+		*val |= XDP_FLAGS_DRV_MODE;
+	else if (!strcmp(mode_str, "generic") || !strcmp(mode_str, "skb"))
+		*val |= XDP_FLAGS_SKB_MODE;
+	else if (!strcmp(mode_str, "offload") || !strcmp(mode_str, "hw"))
+		*val |= XDP_FLAGS_HW_MODE;
+	else if (strcmp(mode_str, "auto") != 0)
+		err_return_int(EINVAL, "mode");
+
+	return 0;
+}
+
+static int
+uc_bpf_xdp_args(uc_vm_t *vm, size_t nargs, int *ifindex, __u32 *flags,
+		struct bpf_xdp_attach_opts *opts)
+{
+	uc_value_t *ifname = uc_fn_arg(0);
+	uc_value_t *old = uc_fn_arg(3);
+	struct uc_bpf_fd *old_f;
+
+	if (ucv_type(ifname) != UC_STRING)
+		err_return_int(EINVAL, "ifname");
+
+	if (uc_bpf_xdp_flags(uc_fn_arg(1), uc_fn_arg(2), flags))
+		return -1;
+
+	/* only replace/detach if the given program is still attached */
+	if (old) {
+		old_f = ucv_resource_data(old, "bpf.program");
+		if (!old_f)
+			err_return_int(EINVAL, "old program");
+
+		opts->old_prog_fd = old_f->fd;
+		*flags |= XDP_FLAGS_REPLACE;
+	}
+
+	*ifindex = if_nametoindex(ucv_string_get(ifname));
+	if (!*ifindex)
+		err_return_int(ENODEV, NULL);
+
+	return 0;
+}
+
+static uc_value_t *
+uc_bpf_program_xdp_attach(uc_vm_t *vm, size_t nargs)
+{
+	DECLARE_LIBBPF_OPTS(bpf_xdp_attach_opts, opts);
+	struct uc_bpf_fd *f = uc_fn_thisval("bpf.program");
+	__u32 flags;
+	int ifindex;
+
+	if (!f)
+		err_return(EINVAL, NULL);
+
+	if (uc_bpf_xdp_args(vm, nargs, &ifindex, &flags, &opts))
+		return NULL;
+
+	if (bpf_xdp_attach(ifindex, f->fd, flags, &opts))
+		err_return(errno, NULL);
+
+	return TRUE;
+}
+
+static uc_value_t *
+uc_bpf_xdp_detach(uc_vm_t *vm, size_t nargs)
+{
+	DECLARE_LIBBPF_OPTS(bpf_xdp_attach_opts, opts);
+	__u32 flags;
+	int ifindex;
+
+	if (uc_bpf_xdp_args(vm, nargs, &ifindex, &flags, &opts))
+		return NULL;
+
+	if (bpf_xdp_detach(ifindex, flags, &opts))
+		err_return(errno, NULL);
+
+	return TRUE;
+}
+
+static uc_value_t *
+uc_bpf_prog_info_new(uc_vm_t *vm, __u32 id)
+{
+	struct bpf_prog_info info = {};
+	__u32 len = sizeof(info);
+	uc_value_t *rv;
+	int fd;
+
+	rv = ucv_object_new(vm);
+	ucv_object_add(rv, "id", ucv_int64_new(id));
+
+	fd = bpf_prog_get_fd_by_id(id);
+	if (fd < 0)
+		return rv;
+
+	if (!bpf_obj_get_info_by_fd(fd, &info, &len)) {
+		ucv_object_add(rv, "name", ucv_string_new(info.name));
+		ucv_object_add(rv, "type", ucv_int64_new(info.type));
+	}
+	close(fd);
+
+	return rv;
+}
+
+static uc_value_t *
+uc_bpf_xdp_query(uc_vm_t *vm, size_t nargs)
+{
+	DECLARE_LIBBPF_OPTS(bpf_xdp_query_opts, opts);
+	uc_value_t *ifname = uc_fn_arg(0);
+	uc_value_t *rv, *progs;
+	const char *mode;
+	int ifindex;
+
+	if (ucv_type(ifname) != UC_STRING)
+		err_return(EINVAL, "ifname");
+
+	ifindex = if_nametoindex(ucv_string_get(ifname));
+	if (!ifindex)
+		err_return(ENODEV, NULL);
+
+	if (bpf_xdp_query(ifindex, 0, &opts))
+		err_return(errno, NULL);
+
+	switch (opts.attach_mode) {
+	case XDP_ATTACHED_DRV:
+		mode = "native";
+		break;
+	case XDP_ATTACHED_SKB:
+		mode = "generic";
+		break;
+	case XDP_ATTACHED_HW:
+		mode = "offload";
+		break;
+	case XDP_ATTACHED_MULTI:
+		mode = "multi";
+		break;
+	default:
+		mode = NULL;
+		break;
+	}
+
+	rv = ucv_object_new(vm);
+	ucv_object_add(rv, "mode", mode ? ucv_string_new(mode) : NULL);
+	ucv_object_add(rv, "feature_flags", ucv_int64_new(opts.feature_flags));
+
+	/* one program per mode can be attached at the same time */
+	progs = ucv_object_new(vm);
+	if (opts.drv_prog_id)
+		ucv_object_add(progs, "native", uc_bpf_prog_info_new(vm, opts.drv_prog_id));
+	if (opts.skb_prog_id)
+		ucv_object_add(progs, "generic", uc_bpf_prog_info_new(vm, opts.skb_prog_id));
+	if (opts.hw_prog_id)
+		ucv_object_add(progs, "offload", uc_bpf_prog_info_new(vm, opts.hw_prog_id));
+	ucv_object_add(rv, "programs", progs);
+
+	return rv;
+}
+
 static int
 uc_bpf_debug_print(enum libbpf_print_level level, const char *format,
 		   va_list args)
@@ -740,11 +1758,18 @@ register_constants(uc_vm_t *vm, uc_value_t *scope)
 #define ADD_CONST(x) ucv_object_add(scope, #x, ucv_int64_new(x))
 	ADD_CONST(BPF_PROG_TYPE_SCHED_CLS);
 	ADD_CONST(BPF_PROG_TYPE_SCHED_ACT);
+	ADD_CONST(BPF_PROG_TYPE_XDP);
 
 	ADD_CONST(BPF_ANY);
 	ADD_CONST(BPF_NOEXIST);
 	ADD_CONST(BPF_EXIST);
 	ADD_CONST(BPF_F_LOCK);
+
+	ADD_CONST(XDP_FLAGS_UPDATE_IF_NOEXIST);
+	ADD_CONST(XDP_FLAGS_SKB_MODE);
+	ADD_CONST(XDP_FLAGS_DRV_MODE);
+	ADD_CONST(XDP_FLAGS_HW_MODE);
+	ADD_CONST(XDP_FLAGS_REPLACE);
 }
 
 static const uc_function_list_t module_fns[] = {
@@ -769,6 +1794,12 @@ static const uc_function_list_t map_fns[] = {
 	{ "delete_all",			uc_bpf_map_delete_all },
 	{ "foreach",			uc_bpf_map_foreach },
 	{ "iterator",			uc_bpf_map_iterator },
+	{ "get_batch",			uc_bpf_map_get_batch },
+	{ "set_batch",			uc_bpf_map_set_batch },
+	{ "delete_batch",		uc_bpf_map_delete_batch },
+	{ "dump",			uc_bpf_map_dump },
+	{ "ringbuf",			uc_bpf_map_ringbuf },
+	{ "perf_buffer",		uc_bpf_map_perf_buffer },
 };
 
 static void uc_bpf_fd_free(void *ptr)
@@ -785,9 +1816,24 @@ static const uc_function_list_t map_iter_fns[] = {
 	{ "next_int",			uc_bpf_map_iter_next_int },
 };
 
+static const uc_function_list_t consumer_fns[] = {
+	{ "poll",			uc_bpf_consumer_poll },
+	{ "stats",			uc_bpf_consumer_stats },
+	{ "close",			uc_bpf_consumer_close },
+};
+
+static void consumer_free(void *ptr)
+{
+	struct uc_bpf_consumer *c = ptr;
+
+	uc_bpf_consumer_release(c);
+	free(c);
+}
+
 static const uc_function_list_t prog_fns[] = {
 	{ "pin",			uc_bpf_program_pin },
 	{ "tc_attach",			uc_bpf_program_tc_attach },
+	{ "xdp_attach",			uc_bpf_program_xdp_attach },
 };
 
 static const uc_function_list_t global_fns[] = {
@@ -797,6 +1843,8 @@ static const uc_function_list_t global_fns[] = {
 	{ "open_map",			uc_bpf_open_map },
 	{ "open_program",		uc_bpf_open_program },
 	{ "tc_detach",			uc_bpf_tc_detach },
+	{ "xdp_detach",			uc_bpf_xdp_detach },
+	{ "xdp_query",			uc_bpf_xdp_query },
 };
 
 void uc_module_init(uc_vm_t *vm, uc_value_t *scope)
@@ -811,4 +1859,5 @@ void uc_module_init(uc_vm_t *vm, uc_value_t *scope)
 	map_type = uc_type_declare(vm, "bpf.map", map_fns, uc_bpf_fd_free);
 	map_iter_type = uc_type_declare(vm, "bpf.map_iter", map_iter_fns, free);
 	program_type = uc_type_declare(vm, "bpf.program", prog_fns, uc_bpf_fd_free);
+	consumer_type = uc_type_declare(vm, "bpf.consumer", consumer_fns, consumer_free);
 }
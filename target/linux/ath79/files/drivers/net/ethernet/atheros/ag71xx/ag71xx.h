@@ -34,9 +34,20 @@
 #include <linux/of.h>
 #include <linux/mfd/syscon.h>
 #include <linux/regmap.h>
+#include <linux/bpf.h>
+#include <linux/bpf_trace.h>
 
 #include <linux/bitops.h>
 
+#include <net/xdp.h>
+#include <net/tso.h>
+#include <net/ip6_checksum.h>
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6,6,0)
+#include <net/page_pool/helpers.h>
+#else
+#include <net/page_pool.h>
+#endif
+
 #include <asm/mach-ath79/ar71xx_regs.h>
 #include <asm/mach-ath79/ath79.h>
 
@@ -65,6 +76,9 @@
 #define AG71XX_TX_RING_SIZE_DEFAULT	128
 #define AG71XX_RX_RING_SIZE_DEFAULT	256
 
+/* per TX descriptor header slot used by the driver side TSO */
+#define AG71XX_TX_HDR_SIZE		128
+
 #define AG71XX_TX_RING_SIZE_MAX		256
 #define AG71XX_RX_RING_SIZE_MAX		256
 
@@ -95,21 +109,31 @@ struct ag71xx_desc {
 #define AG71XX_DESC_SIZE	roundup(sizeof(struct ag71xx_desc), \
 					L1_CACHE_BYTES)
 
+enum ag71xx_buf_type {
+	AG71XX_BUF_SKB,
+	AG71XX_BUF_XDP_TX,	/* frame from our own page_pool, XDP_TX */
+	AG71XX_BUF_XDP_NDO,	/* frame mapped by ndo_xdp_xmit */
+};
+
 struct ag71xx_buf {
 	union {
 		struct sk_buff	*skb;
+		struct xdp_frame *xdpf;
 		void		*rx_buf;
 	};
 	union {
 		dma_addr_t	dma_addr;
 		unsigned int		len;
 	};
+	u8			type;
 };
 
 struct ag71xx_ring {
 	struct ag71xx_buf	*buf;
 	u8			*descs_cpu;
 	dma_addr_t		descs_dma;
+	u8			*tso_hdrs;
+	dma_addr_t		tso_hdrs_dma;
 	u16			desc_split;
 	u16			order;
 	unsigned int		curr;
@@ -126,6 +150,18 @@ struct ag71xx_int_stats {
 	unsigned long		total;
 };
 
+struct ag71xx_xdp_stats {
+	unsigned long		pass;
+	unsigned long		drop;
+	unsigned long		tx;
+	unsigned long		tx_err;
+	unsigned long		redirect;
+	unsigned long		redirect_err;
+	unsigned long		aborted;
+	unsigned long		xmit;
+	unsigned long		xmit_err;
+};
+
 struct ag71xx_napi_stats {
 	unsigned long		napi_calls;
 	unsigned long		rx_count;
@@ -137,6 +173,9 @@ struct ag71xx_napi_stats {
 
 	unsigned long		rx[AG71XX_NAPI_WEIGHT + 1];
 	unsigned long		tx[AG71XX_NAPI_WEIGHT + 1];
+
+	/* also updated from ndo_xdp_xmit, which may run on any CPU */
+	struct ag71xx_xdp_stats	__percpu *xdp;
 };
 
 struct ag71xx_debug {
@@ -158,6 +197,7 @@ struct ag71xx {
 
 	u16			desc_pktlen_mask;
 	u16			rx_buf_size;
+	u16			rx_headroom;
 	u8			rx_buf_offset;
 	u8			tx_hang_workaround:1;
 
@@ -167,6 +207,10 @@ struct ag71xx {
 	struct napi_struct	napi;
 	u32			msg_enable;
 
+	struct page_pool	*page_pool;
+	struct bpf_prog		*xdp_prog;
+	struct xdp_rxq_info	xdp_rxq;
+
 	/*
 	 * From this point onwards we're not looking at per-packet fields.
 	 */
@@ -432,6 +476,8 @@ int ag71xx_debugfs_init(struct ag71xx *ag);
 void ag71xx_debugfs_exit(struct ag71xx *ag);
 void ag71xx_debugfs_update_int_stats(struct ag71xx *ag, u32 status);
 void ag71xx_debugfs_update_napi_stats(struct ag71xx *ag, int rx, int tx);
+void ag71xx_debugfs_update_xdp_stats(struct ag71xx *ag,
+				     const struct ag71xx_xdp_stats *xdp);
 #else
 static inline int ag71xx_debugfs_root_init(void) { return 0; }
 static inline void ag71xx_debugfs_root_exit(void) {}
@@ -441,6 +487,8 @@ static inline void ag71xx_debugfs_update_int_stats(struct ag71xx *ag,
 						   u32 status) {}
 static inline void ag71xx_debugfs_update_napi_stats(struct ag71xx *ag,
 						    int rx, int tx) {}
+static inline void ag71xx_debugfs_update_xdp_stats(struct ag71xx *ag,
+				const struct ag71xx_xdp_stats *xdp) {}
 #endif /* CONFIG_AG71XX_DEBUG_FS */
 
 int ag71xx_ar7240_init(struct ag71xx *ag, struct device_node *np);
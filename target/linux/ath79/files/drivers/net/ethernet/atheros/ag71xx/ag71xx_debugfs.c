@@ -12,6 +12,7 @@
  */
 
 #include <linux/debugfs.h>
+#include <linux/percpu.h>
 
 #include "ag71xx.h"
 
@@ -94,17 +95,39 @@ void ag71xx_debugfs_update_napi_stats(struct ag71xx *ag, int rx, int tx)
 	}
 }
 
+void ag71xx_debugfs_update_xdp_stats(struct ag71xx *ag,
+				     const struct ag71xx_xdp_stats *xdp)
+{
+	struct ag71xx_xdp_stats *stats;
+
+	if (!ag->debug.napi_stats.xdp)
+		return;
+
+	stats = this_cpu_ptr(ag->debug.napi_stats.xdp);
+	stats->pass += xdp->pass;
+	stats->drop += xdp->drop;
+	stats->tx += xdp->tx;
+	stats->tx_err += xdp->tx_err;
+	stats->redirect += xdp->redirect;
+	stats->redirect_err += xdp->redirect_err;
+	stats->aborted += xdp->aborted;
+	stats->xmit += xdp->xmit;
+	stats->xmit_err += xdp->xmit_err;
+}
+
 static ssize_t read_file_napi_stats(struct file *file, char __user *user_buf,
 				    size_t count, loff_t *ppos)
 {
 	struct ag71xx *ag = file->private_data;
 	struct ag71xx_napi_stats *stats = &ag->debug.napi_stats;
+	struct ag71xx_xdp_stats xdp = {};
 	char *buf;
 	unsigned int buflen;
 	unsigned int len = 0;
 	unsigned long rx_avg = 0;
 	unsigned long tx_avg = 0;
 	int ret;
+	int cpu;
 	int i;
 
 	buflen = 2048;
@@ -137,6 +160,40 @@ static ssize_t read_file_napi_stats(struct file *file, char __user *user_buf,
 	len += snprintf(buf + len, buflen - len, "%3s: %10lu %10lu\n",
 			"pkt", stats->rx_packets, stats->tx_packets);
 
+	for_each_possible_cpu(cpu) {
+		const struct ag71xx_xdp_stats *s;
+
+		if (!stats->xdp)
+			break;
+
+		s = per_cpu_ptr(stats->xdp, cpu);
+		xdp.pass += READ_ONCE(s->pass);
+		xdp.drop += READ_ONCE(s->drop);
+		xdp.tx += READ_ONCE(s->tx);
+		xdp.tx_err += READ_ONCE(s->tx_err);
+		xdp.redirect += READ_ONCE(s->redirect);
+		xdp.redirect_err += READ_ONCE(s->redirect_err);
+		xdp.aborted += READ_ONCE(s->aborted);
+		xdp.xmit += READ_ONCE(s->xmit);
+		xdp.xmit_err += READ_ONCE(s->xmit_err);
+	}
+
+#define PR_XDP_STAT(_label, _field)					\
+	len += snprintf(buf + len, buflen - len,			\
+		"%20s: %10lu\n", _label, xdp._field);
+
+	len += snprintf(buf + len, buflen - len, "\n");
+	PR_XDP_STAT("XDP pass", pass);
+	PR_XDP_STAT("XDP drop", drop);
+	PR_XDP_STAT("XDP aborted", aborted);
+	PR_XDP_STAT("XDP TX", tx);
+	PR_XDP_STAT("XDP TX error", tx_err);
+	PR_XDP_STAT("XDP redirect", redirect);
+	PR_XDP_STAT("XDP redirect error", redirect_err);
+	PR_XDP_STAT("XDP xmit", xmit);
+	PR_XDP_STAT("XDP xmit error", xmit_err);
+#undef PR_XDP_STAT
+
 	ret = simple_read_from_buffer(user_buf, count, ppos, buf, len);
 	kfree(buf);
 
@@ -241,16 +298,24 @@ static const struct file_operations ag71xx_fops_rx_ring = {
 void ag71xx_debugfs_exit(struct ag71xx *ag)
 {
 	debugfs_remove_recursive(ag->debug.debugfs_dir);
+	free_percpu(ag->debug.napi_stats.xdp);
+	ag->debug.napi_stats.xdp = NULL;
 }
 
 int ag71xx_debugfs_init(struct ag71xx *ag)
 {
 	struct device *dev = &ag->pdev->dev;
 
+	ag->debug.napi_stats.xdp = alloc_percpu(struct ag71xx_xdp_stats);
+	if (!ag->debug.napi_stats.xdp)
+		return -ENOMEM;
+
 	ag->debug.debugfs_dir = debugfs_create_dir(dev_name(dev),
 						   ag71xx_debugfs_root);
 	if (!ag->debug.debugfs_dir) {
 		dev_err(dev, "unable to create debugfs directory\n");
+		free_percpu(ag->debug.napi_stats.xdp);
+		ag->debug.napi_stats.xdp = NULL;
 		return -ENOENT;
 	}
 
@@ -101,6 +101,9 @@ static void ag71xx_ring_tx_clean(struct ag71xx *ag)
 	int ring_mask = BIT(ring->order) - 1;
 	u32 bytes_compl = 0, pkts_compl = 0;
 
+	if (!ring->buf)
+		return;
+
 	while (ring->curr != ring->dirty) {
 		struct ag71xx_desc *desc;
 		u32 i = ring->dirty & ring_mask;
@@ -112,11 +115,16 @@ static void ag71xx_ring_tx_clean(struct ag71xx *ag)
 		}
 
 		if (ring->buf[i].skb) {
-			bytes_compl += ring->buf[i].len;
-			pkts_compl++;
-			dev_kfree_skb_any(ring->buf[i].skb);
+			if (ring->buf[i].type == AG71XX_BUF_SKB) {
+				bytes_compl += ring->buf[i].len;
+				pkts_compl++;
+				dev_kfree_skb_any(ring->buf[i].skb);
+			} else {
+				xdp_return_frame(ring->buf[i].xdpf);
+			}
 		}
 		ring->buf[i].skb = NULL;
+		ring->buf[i].type = AG71XX_BUF_SKB;
 		ring->dirty++;
 	}
 
@@ -141,6 +149,7 @@ static void ag71xx_ring_tx_init(struct ag71xx *ag)
 
 		desc->ctrl = DESC_EMPTY;
 		ring->buf[i].skb = NULL;
+		ring->buf[i].type = AG71XX_BUF_SKB;
 	}
 
 	/* flush descriptors */
@@ -162,9 +171,10 @@ static void ag71xx_ring_rx_clean(struct ag71xx *ag)
 
 	for (i = 0; i < ring_size; i++)
 		if (ring->buf[i].rx_buf) {
-			dma_unmap_single(&ag->pdev->dev, ring->buf[i].dma_addr,
-					 ag->rx_buf_size, DMA_FROM_DEVICE);
-			skb_free_frag(ring->buf[i].rx_buf);
+			page_pool_put_full_page(ag->page_pool,
+						virt_to_head_page(ring->buf[i].rx_buf),
+						false);
+			ring->buf[i].rx_buf = NULL;
 		}
 }
 
@@ -174,25 +184,100 @@ static int ag71xx_buffer_size(struct ag71xx *ag)
 	       SKB_DATA_ALIGN(sizeof(struct skb_shared_info));
 }
 
-static bool ag71xx_fill_rx_buf(struct ag71xx *ag, struct ag71xx_buf *buf,
-			       int offset,
-			       void *(*alloc)(unsigned int size))
+/* RX buffers are whole (compound) pages handed out by the page_pool */
+static unsigned int ag71xx_rx_page_order(struct ag71xx *ag)
+{
+	return get_order(ag71xx_buffer_size(ag));
+}
+
+static unsigned int ag71xx_rx_frame_size(struct ag71xx *ag)
+{
+	return PAGE_SIZE << ag71xx_rx_page_order(ag);
+}
+
+/*
+ * XDP programs need XDP_PACKET_HEADROOM in front of the frame and the
+ * page must not be shared with anything else, so the buffer layout is
+ * chosen whenever the RX ring is set up.
+ */
+static void ag71xx_rx_buf_setup(struct ag71xx *ag)
+{
+	unsigned int max_frame_len = ag71xx_max_frame_len(ag->dev->mtu);
+
+	ag->rx_headroom = ag->rx_buf_offset;
+	if (ag->xdp_prog)
+		ag->rx_headroom += XDP_PACKET_HEADROOM - NET_SKB_PAD;
+
+	ag->rx_buf_size = SKB_DATA_ALIGN(max_frame_len + ag->rx_headroom);
+}
+
+static bool ag71xx_fill_rx_buf(struct ag71xx *ag, struct ag71xx_buf *buf)
 {
 	struct ag71xx_ring *ring = &ag->rx_ring;
 	struct ag71xx_desc *desc = ag71xx_ring_desc(ring, buf - &ring->buf[0]);
-	void *data;
+	struct page *page;
 
-	data = alloc(ag71xx_buffer_size(ag));
-	if (!data)
+	page = page_pool_dev_alloc_pages(ag->page_pool);
+	if (!page)
 		return false;
 
-	buf->rx_buf = data;
-	buf->dma_addr = dma_map_single(&ag->pdev->dev, data, ag->rx_buf_size,
-				       DMA_FROM_DEVICE);
-	desc->data = (u32) buf->dma_addr + offset;
+	buf->rx_buf = page_address(page);
+	buf->dma_addr = page_pool_get_dma_addr(page);
+	desc->data = (u32) buf->dma_addr + ag->rx_headroom;
 	return true;
 }
 
+static int ag71xx_page_pool_create(struct ag71xx *ag)
+{
+	struct page_pool_params pp_params = {
+		.order = ag71xx_rx_page_order(ag),
+		.flags = PP_FLAG_DMA_MAP | PP_FLAG_DMA_SYNC_DEV,
+		.pool_size = BIT(ag->rx_ring.order),
+		.nid = NUMA_NO_NODE,
+		.dev = &ag->pdev->dev,
+		.dma_dir = ag->xdp_prog ? DMA_BIDIRECTIONAL : DMA_FROM_DEVICE,
+		.offset = ag->rx_headroom,
+		.max_len = ag->rx_buf_size - ag->rx_headroom,
+	};
+	int err;
+
+	ag->page_pool = page_pool_create(&pp_params);
+	if (IS_ERR(ag->page_pool)) {
+		err = PTR_ERR(ag->page_pool);
+		ag->page_pool = NULL;
+		return err;
+	}
+
+	err = xdp_rxq_info_reg(&ag->xdp_rxq, ag->dev, 0, ag->napi.napi_id);
+	if (err)
+		goto err_destroy;
+
+	err = xdp_rxq_info_reg_mem_model(&ag->xdp_rxq, MEM_TYPE_PAGE_POOL,
+					 ag->page_pool);
+	if (err)
+		goto err_unreg;
+
+	return 0;
+
+err_unreg:
+	xdp_rxq_info_unreg(&ag->xdp_rxq);
+err_destroy:
+	page_pool_destroy(ag->page_pool);
+	ag->page_pool = NULL;
+	return err;
+}
+
+static void ag71xx_page_pool_destroy(struct ag71xx *ag)
+{
+	if (!ag->page_pool)
+		return;
+
+	if (xdp_rxq_info_is_reg(&ag->xdp_rxq))
+		xdp_rxq_info_unreg(&ag->xdp_rxq);
+	page_pool_destroy(ag->page_pool);
+	ag->page_pool = NULL;
+}
+
 static int ag71xx_ring_rx_init(struct ag71xx *ag)
 {
 	struct ag71xx_ring *ring = &ag->rx_ring;
@@ -215,8 +300,7 @@ static int ag71xx_ring_rx_init(struct ag71xx *ag)
 	for (i = 0; i < ring_size; i++) {
 		struct ag71xx_desc *desc = ag71xx_ring_desc(ring, i);
 
-		if (!ag71xx_fill_rx_buf(ag, &ring->buf[i], ag->rx_buf_offset,
-					netdev_alloc_frag)) {
+		if (!ag71xx_fill_rx_buf(ag, &ring->buf[i])) {
 			ret = -ENOMEM;
 			break;
 		}
@@ -238,7 +322,6 @@ static int ag71xx_ring_rx_refill(struct ag71xx *ag)
 	struct ag71xx_ring *ring = &ag->rx_ring;
 	int ring_mask = BIT(ring->order) - 1;
 	unsigned int count;
-	int offset = ag->rx_buf_offset;
 
 	count = 0;
 	for (; ring->curr - ring->dirty > 0; ring->dirty++) {
@@ -249,8 +332,7 @@ static int ag71xx_ring_rx_refill(struct ag71xx *ag)
 		desc = ag71xx_ring_desc(ring, i);
 
 		if (!ring->buf[i].rx_buf &&
-		    !ag71xx_fill_rx_buf(ag, &ring->buf[i], offset,
-					napi_alloc_frag))
+		    !ag71xx_fill_rx_buf(ag, &ring->buf[i]))
 			break;
 
 		desc->ctrl = DESC_EMPTY;
@@ -265,49 +347,76 @@ static int ag71xx_ring_rx_refill(struct ag71xx *ag)
 	return count;
 }
 
+static void ag71xx_rings_free(struct ag71xx *ag)
+{
+	struct ag71xx_ring *tx = &ag->tx_ring;
+	struct ag71xx_ring *rx = &ag->rx_ring;
+	int ring_size = BIT(tx->order) + BIT(rx->order);
+
+	if (tx->descs_cpu)
+		dma_free_coherent(&ag->pdev->dev, ring_size * AG71XX_DESC_SIZE,
+				  tx->descs_cpu, tx->descs_dma);
+
+	if (tx->tso_hdrs)
+		dma_free_coherent(&ag->pdev->dev,
+				  BIT(tx->order) * AG71XX_TX_HDR_SIZE,
+				  tx->tso_hdrs, tx->tso_hdrs_dma);
+
+	kfree(tx->buf);
+
+	tx->tso_hdrs = NULL;
+	tx->descs_cpu = NULL;
+	rx->descs_cpu = NULL;
+	tx->buf = NULL;
+	rx->buf = NULL;
+}
+
 static int ag71xx_rings_init(struct ag71xx *ag)
 {
 	struct ag71xx_ring *tx = &ag->tx_ring;
 	struct ag71xx_ring *rx = &ag->rx_ring;
 	int ring_size = BIT(tx->order) + BIT(rx->order);
 	int tx_size = BIT(tx->order);
+	int err;
+
+	err = ag71xx_page_pool_create(ag);
+	if (err)
+		return err;
 
+	err = -ENOMEM;
 	tx->buf = kzalloc(ring_size * sizeof(*tx->buf), GFP_KERNEL);
 	if (!tx->buf)
-		return -ENOMEM;
+		goto err_pool_destroy;
 
 	tx->descs_cpu = dma_alloc_coherent(&ag->pdev->dev, ring_size * AG71XX_DESC_SIZE,
 					   &tx->descs_dma, GFP_KERNEL);
-	if (!tx->descs_cpu) {
-		kfree(tx->buf);
-		tx->buf = NULL;
-		return -ENOMEM;
-	}
+	if (!tx->descs_cpu)
+		goto err_rings_free;
+
+	tx->tso_hdrs = dma_alloc_coherent(&ag->pdev->dev,
+					  tx_size * AG71XX_TX_HDR_SIZE,
+					  &tx->tso_hdrs_dma, GFP_KERNEL);
+	if (!tx->tso_hdrs)
+		goto err_rings_free;
 
 	rx->buf = &tx->buf[tx_size];
 	rx->descs_cpu = ((void *)tx->descs_cpu) + tx_size * AG71XX_DESC_SIZE;
 	rx->descs_dma = tx->descs_dma + tx_size * AG71XX_DESC_SIZE;
 
 	ag71xx_ring_tx_init(ag);
-	return ag71xx_ring_rx_init(ag);
-}
-
-static void ag71xx_rings_free(struct ag71xx *ag)
-{
-	struct ag71xx_ring *tx = &ag->tx_ring;
-	struct ag71xx_ring *rx = &ag->rx_ring;
-	int ring_size = BIT(tx->order) + BIT(rx->order);
-
-	if (tx->descs_cpu)
-		dma_free_coherent(&ag->pdev->dev, ring_size * AG71XX_DESC_SIZE,
-				  tx->descs_cpu, tx->descs_dma);
+	err = ag71xx_ring_rx_init(ag);
+	if (err)
+		goto err_rx_clean;
 
-	kfree(tx->buf);
+	return 0;
 
-	tx->descs_cpu = NULL;
-	rx->descs_cpu = NULL;
-	tx->buf = NULL;
-	rx->buf = NULL;
+err_rx_clean:
+	ag71xx_ring_rx_clean(ag);
+err_rings_free:
+	ag71xx_rings_free(ag);
+err_pool_destroy:
+	ag71xx_page_pool_destroy(ag);
+	return err;
 }
 
 static void ag71xx_rings_cleanup(struct ag71xx *ag)
@@ -315,6 +424,7 @@ static void ag71xx_rings_cleanup(struct ag71xx *ag)
 	ag71xx_ring_rx_clean(ag);
 	ag71xx_ring_tx_clean(ag);
 	ag71xx_rings_free(ag);
+	ag71xx_page_pool_destroy(ag);
 
 	netdev_reset_queue(ag->dev);
 }
@@ -1003,7 +1113,7 @@ static int ag71xx_open(struct net_device *dev)
 
 	netif_carrier_off(dev);
 	max_frame_len = ag71xx_max_frame_len(dev->mtu);
-	ag->rx_buf_size = SKB_DATA_ALIGN(max_frame_len + NET_SKB_PAD + NET_IP_ALIGN);
+	ag71xx_rx_buf_setup(ag);
 
 	/* setup max frame length */
 	ag71xx_wr(ag, AG71XX_REG_MAC_MFL, max_frame_len);
@@ -1011,15 +1121,11 @@ static int ag71xx_open(struct net_device *dev)
 
 	ret = ag71xx_hw_enable(ag);
 	if (ret)
-		goto err;
+		return ret;
 
 	phy_start(ag->phy_dev);
 
 	return 0;
-
-err:
-	ag71xx_rings_cleanup(ag);
-	return ret;
 }
 
 static int ag71xx_stop(struct net_device *dev)
@@ -1042,7 +1148,23 @@ static int ag71xx_stop(struct net_device *dev)
 	return 0;
 }
 
-static int ag71xx_fill_dma_desc(struct ag71xx_ring *ring, u32 addr, int len)
+static void ag71xx_tx_unwind(struct ag71xx_ring *ring, unsigned int start,
+			     int ndesc)
+{
+	int ring_mask = BIT(ring->order) - 1;
+
+	while (ndesc-- > 0)
+		ag71xx_ring_desc(ring, (ring->curr + start++) & ring_mask)->ctrl =
+			DESC_EMPTY;
+}
+
+/*
+ * Place one buffer into the TX ring, starting @start descriptors after
+ * ring->curr. @more chains the last descriptor to the next buffer of the
+ * same packet.
+ */
+static int ag71xx_fill_dma_desc(struct ag71xx_ring *ring, unsigned int start,
+				u32 addr, int len, bool more)
 {
 	int i;
 	struct ag71xx_desc *desc;
@@ -1056,11 +1178,13 @@ static int ag71xx_fill_dma_desc(struct ag71xx_ring *ring, u32 addr, int len)
 	while (len > 0) {
 		unsigned int cur_len = len;
 
-		i = (ring->curr + ndesc) & ring_mask;
+		i = (ring->curr + start + ndesc) & ring_mask;
 		desc = ag71xx_ring_desc(ring, i);
 
-		if (!ag71xx_desc_empty(desc))
+		if (!ag71xx_desc_empty(desc)) {
+			ag71xx_tx_unwind(ring, start, ndesc);
 			return -1;
+		}
 
 		if (cur_len > split) {
 			cur_len = split;
@@ -1077,11 +1201,11 @@ static int ag71xx_fill_dma_desc(struct ag71xx_ring *ring, u32 addr, int len)
 		addr += cur_len;
 		len -= cur_len;
 
-		if (len > 0)
+		if (len > 0 || more)
 			cur_len |= DESC_MORE;
 
 		/* prevent early tx attempt of this descriptor */
-		if (!ndesc)
+		if (!start && !ndesc)
 			cur_len |= DESC_EMPTY;
 
 		desc->ctrl = cur_len;
@@ -1091,6 +1215,239 @@ static int ag71xx_fill_dma_desc(struct ag71xx_ring *ring, u32 addr, int len)
 	return ndesc;
 }
 
+static int ag71xx_tx_desc_count(struct ag71xx_ring *ring, unsigned int len)
+{
+	if (!ring->desc_split)
+		return 1;
+
+	return DIV_ROUND_UP(len, ring->desc_split);
+}
+
+static int ag71xx_skb_desc_count(struct ag71xx_ring *ring, struct sk_buff *skb)
+{
+	int i, n;
+
+	n = ag71xx_tx_desc_count(ring, skb_headlen(skb));
+	for (i = 0; i < skb_shinfo(skb)->nr_frags; i++)
+		n += ag71xx_tx_desc_count(ring,
+				skb_frag_size(&skb_shinfo(skb)->frags[i]));
+
+	return n;
+}
+
+/* upper bound of the descriptors used by ag71xx_tx_map_tso() */
+static int ag71xx_tso_desc_count(struct ag71xx_ring *ring, struct sk_buff *skb)
+{
+	unsigned int payload = skb->len - skb_tcp_all_headers(skb);
+	int segs = skb_shinfo(skb)->gso_segs;
+	int n;
+
+	/* one header per segment, segments and frags both start a buffer */
+	n = 2 * segs + skb_shinfo(skb)->nr_frags + 1;
+	if (ring->desc_split)
+		n += DIV_ROUND_UP(payload, ring->desc_split);
+
+	return n;
+}
+
+static bool ag71xx_tx_need_linearize(struct ag71xx_ring *ring,
+				     struct sk_buff *skb)
+{
+	int i;
+
+	if (!skb_is_nonlinear(skb))
+		return false;
+
+	if (skb_headlen(skb) <= 4)
+		return true;
+
+	for (i = 0; i < skb_shinfo(skb)->nr_frags; i++)
+		if (skb_frag_size(&skb_shinfo(skb)->frags[i]) <= 4)
+			return true;
+
+	return ag71xx_skb_desc_count(ring, skb) > BIT(ring->order) / 4;
+}
+
+/*
+ * Walk the payload the same way ag71xx_tx_map_tso() does and check that
+ * no DMA buffer of the resulting segments ends up <= 4 bytes long.
+ */
+static bool ag71xx_tso_ok(struct ag71xx_ring *ring, struct sk_buff *skb)
+{
+	struct skb_shared_info *shinfo = skb_shinfo(skb);
+	unsigned int hdr_len, payload, src_left, seg_left, n;
+	int f = 0;
+
+	if (!(shinfo->gso_type & (SKB_GSO_TCPV4 | SKB_GSO_TCPV6)))
+		return false;
+
+	hdr_len = skb_tcp_all_headers(skb);
+	if (hdr_len > AG71XX_TX_HDR_SIZE || hdr_len > skb_headlen(skb))
+		return false;
+
+	if (ag71xx_tso_desc_count(ring, skb) > BIT(ring->order) / 4)
+		return false;
+
+	payload = skb->len - hdr_len;
+	src_left = skb_headlen(skb) - hdr_len;
+	seg_left = min_t(unsigned int, shinfo->gso_size, payload);
+
+	while (payload) {
+		while (!src_left)
+			src_left = skb_frag_size(&shinfo->frags[f++]);
+
+		n = min(src_left, seg_left);
+		if (n <= 4)
+			return false;
+
+		src_left -= n;
+		seg_left -= n;
+		payload -= n;
+		if (!seg_left)
+			seg_left = min_t(unsigned int, shinfo->gso_size,
+					 payload);
+	}
+
+	return true;
+}
+
+static netdev_features_t ag71xx_features_check(struct sk_buff *skb,
+					       struct net_device *dev,
+					       netdev_features_t features)
+{
+	struct ag71xx *ag = netdev_priv(dev);
+
+	if (skb_is_gso(skb) && !ag71xx_tso_ok(&ag->tx_ring, skb))
+		features &= ~NETIF_F_GSO_MASK;
+
+	return features;
+}
+
+static int ag71xx_tx_map_skb(struct ag71xx *ag, struct sk_buff *skb)
+{
+	struct ag71xx_ring *ring = &ag->tx_ring;
+	struct device *dev = &ag->pdev->dev;
+	int nr_frags = skb_shinfo(skb)->nr_frags;
+	unsigned int len = skb_headlen(skb);
+	dma_addr_t dma_addr;
+	int i, n, ndesc;
+
+	dma_addr = dma_map_single(dev, skb->data, len, DMA_TO_DEVICE);
+	ndesc = ag71xx_fill_dma_desc(ring, 0, (u32) dma_addr,
+				     len & ag->desc_pktlen_mask, nr_frags > 0);
+	if (ndesc < 0)
+		return -1;
+
+	for (i = 0; i < nr_frags; i++) {
+		skb_frag_t *frag = &skb_shinfo(skb)->frags[i];
+
+		len = skb_frag_size(frag);
+		dma_addr = skb_frag_dma_map(dev, frag, 0, len, DMA_TO_DEVICE);
+		n = ag71xx_fill_dma_desc(ring, ndesc, (u32) dma_addr, len,
+					 i < nr_frags - 1);
+		if (n < 0) {
+			ag71xx_tx_unwind(ring, 0, ndesc);
+			return -1;
+		}
+		ndesc += n;
+	}
+
+	return ndesc;
+}
+
+/* The MAC has no checksum engine, finish both checksums of a segment */
+static void ag71xx_tso_csum(struct sk_buff *skb, u8 *hdr, struct tso_t *tso,
+			    __wsum csum, int size)
+{
+	struct tcphdr *th = (struct tcphdr *)(hdr + skb_transport_offset(skb));
+	void *nh = hdr + skb_network_offset(skb);
+
+	th->check = 0;
+	csum = csum_partial(th, tso->tlen, csum);
+
+	if (tso->ipv6) {
+		struct ipv6hdr *ip6h = nh;
+
+		th->check = csum_ipv6_magic(&ip6h->saddr, &ip6h->daddr,
+					    tso->tlen + size, IPPROTO_TCP,
+					    csum);
+	} else {
+		struct iphdr *iph = nh;
+
+		ip_send_check(iph);
+		th->check = csum_tcpudp_magic(iph->saddr, iph->daddr,
+					      tso->tlen + size, IPPROTO_TCP,
+					      csum);
+	}
+}
+
+/*
+ * Segment a TSO skb in the driver: every segment gets its headers built
+ * in the header slot of its first descriptor, the payload is mapped
+ * straight from the skb.
+ */
+static int ag71xx_tx_map_tso(struct ag71xx *ag, struct sk_buff *skb)
+{
+	struct ag71xx_ring *ring = &ag->tx_ring;
+	struct device *dev = &ag->pdev->dev;
+	int ring_mask = BIT(ring->order) - 1;
+	int hdr_len, total_len, ndesc = 0, n;
+	struct tso_t tso;
+
+	hdr_len = tso_start(skb, &tso);
+	total_len = skb->len - hdr_len;
+
+	while (total_len > 0) {
+		int data_left = min_t(int, skb_shinfo(skb)->gso_size,
+				      total_len);
+		unsigned int slot = (ring->curr + ndesc) & ring_mask;
+		u8 *hdr = ring->tso_hdrs + slot * AG71XX_TX_HDR_SIZE;
+		int seg_len = data_left;
+		__wsum csum = 0;
+		int offset = 0;
+
+		total_len -= data_left;
+		tso_build_hdr(skb, hdr, &tso, data_left, total_len == 0);
+
+		n = ag71xx_fill_dma_desc(ring, ndesc, (u32) (ring->tso_hdrs_dma +
+					 slot * AG71XX_TX_HDR_SIZE),
+					 hdr_len, true);
+		if (n < 0)
+			goto err;
+		ndesc += n;
+
+		while (data_left > 0) {
+			int size = min_t(int, tso.size, data_left);
+			dma_addr_t dma_addr;
+
+			csum = csum_block_add(csum,
+					      csum_partial(tso.data, size, 0),
+					      offset);
+			dma_addr = dma_map_single(dev, tso.data, size,
+						  DMA_TO_DEVICE);
+			data_left -= size;
+			offset += size;
+
+			n = ag71xx_fill_dma_desc(ring, ndesc, (u32) dma_addr,
+						 size,
+						 data_left > 0 || total_len > 0);
+			if (n < 0)
+				goto err;
+			ndesc += n;
+
+			tso_build_data(skb, &tso, size);
+		}
+
+		ag71xx_tso_csum(skb, hdr, &tso, csum, seg_len);
+	}
+
+	return ndesc;
+
+err:
+	ag71xx_tx_unwind(ring, 0, ndesc);
+	return -1;
+}
+
 static netdev_tx_t ag71xx_hard_start_xmit(struct sk_buff *skb,
 					  struct net_device *dev)
 {
@@ -1099,7 +1456,6 @@ static netdev_tx_t ag71xx_hard_start_xmit(struct sk_buff *skb,
 	int ring_mask = BIT(ring->order) - 1;
 	int ring_size = BIT(ring->order);
 	struct ag71xx_desc *desc;
-	dma_addr_t dma_addr;
 	int i, n, ring_min;
 
 	if (skb->len <= 4) {
@@ -1107,16 +1463,35 @@ static netdev_tx_t ag71xx_hard_start_xmit(struct sk_buff *skb,
 		goto err_drop;
 	}
 
-	dma_addr = dma_map_single(&ag->pdev->dev, skb->data, skb->len,
-				  DMA_TO_DEVICE);
+	if (skb_is_gso(skb)) {
+		n = ag71xx_tso_desc_count(ring, skb);
+	} else {
+		if (ag71xx_tx_need_linearize(ring, skb) && __skb_linearize(skb))
+			goto err_drop;
+
+		/* no checksum engine, it is only advertised for SG and TSO */
+		if (skb->ip_summed == CHECKSUM_PARTIAL && skb_checksum_help(skb))
+			goto err_drop;
+
+		n = ag71xx_skb_desc_count(ring, skb);
+	}
+
+	if (ring->curr - ring->dirty + n > ring_size) {
+		DBG("%s: tx queue full\n", dev->name);
+		netif_stop_queue(dev);
+		return NETDEV_TX_BUSY;
+	}
 
 	i = ring->curr & ring_mask;
 	desc = ag71xx_ring_desc(ring, i);
 
 	/* setup descriptor fields */
-	n = ag71xx_fill_dma_desc(ring, (u32) dma_addr, skb->len & ag->desc_pktlen_mask);
+	if (skb_is_gso(skb))
+		n = ag71xx_tx_map_tso(ag, skb);
+	else
+		n = ag71xx_tx_map_skb(ag, skb);
 	if (n < 0)
-		goto err_drop_unmap;
+		goto err_drop;
 
 	i = (ring->curr + n - 1) & ring_mask;
 	ring->buf[i].len = skb->len;
@@ -1135,6 +1510,8 @@ static netdev_tx_t ag71xx_hard_start_xmit(struct sk_buff *skb,
 	ring_min = 2;
 	if (ring->desc_split)
 	    ring_min *= AG71XX_TX_RING_DS_PER_PKT;
+	if (dev->features & NETIF_F_SG)
+		ring_min += MAX_SKB_FRAGS;
 
 	if (ring->curr - ring->dirty >= ring_size - ring_min) {
 		DBG("%s: tx queue full\n", dev->name);
@@ -1148,9 +1525,6 @@ static netdev_tx_t ag71xx_hard_start_xmit(struct sk_buff *skb,
 
 	return NETDEV_TX_OK;
 
-err_drop_unmap:
-	dma_unmap_single(&ag->pdev->dev, dma_addr, skb->len, DMA_TO_DEVICE);
-
 err_drop:
 	dev->stats.tx_dropped++;
 
@@ -1158,6 +1532,198 @@ err_drop:
 	return NETDEV_TX_OK;
 }
 
+static int ag71xx_xdp_submit_frame(struct ag71xx *ag, struct xdp_frame *xdpf,
+				   bool dma_map)
+{
+	struct ag71xx_ring *ring = &ag->tx_ring;
+	int ring_mask = BIT(ring->order) - 1;
+	int ring_size = BIT(ring->order);
+	struct device *dev = &ag->pdev->dev;
+	struct ag71xx_desc *desc;
+	dma_addr_t dma_addr;
+	int i, n, ring_min;
+	u8 type;
+
+	if (xdpf->len <= 4)
+		return -EINVAL;
+
+	ring_min = 2;
+	if (ring->desc_split)
+		ring_min *= AG71XX_TX_RING_DS_PER_PKT;
+
+	if (ring->curr - ring->dirty >= ring_size - ring_min)
+		return -EBUSY;
+
+	if (dma_map) {
+		dma_addr = dma_map_single(dev, xdpf->data, xdpf->len,
+					  DMA_TO_DEVICE);
+		if (dma_mapping_error(dev, dma_addr))
+			return -ENOMEM;
+		type = AG71XX_BUF_XDP_NDO;
+	} else {
+		/* XDP_TX: the page is still mapped by our page_pool */
+		struct page *page = virt_to_head_page(xdpf->data);
+
+		dma_addr = page_pool_get_dma_addr(page) +
+			   (xdpf->data - page_address(page));
+		dma_sync_single_for_device(dev, dma_addr, xdpf->len,
+					   DMA_BIDIRECTIONAL);
+		type = AG71XX_BUF_XDP_TX;
+	}
+
+	i = ring->curr & ring_mask;
+	desc = ag71xx_ring_desc(ring, i);
+
+	n = ag71xx_fill_dma_desc(ring, 0, (u32) dma_addr,
+				 xdpf->len & ag->desc_pktlen_mask, false);
+	if (n < 0) {
+		if (dma_map)
+			dma_unmap_single(dev, dma_addr, xdpf->len,
+					 DMA_TO_DEVICE);
+		return -EBUSY;
+	}
+
+	i = (ring->curr + n - 1) & ring_mask;
+	ring->buf[i].len = xdpf->len;
+	ring->buf[i].xdpf = xdpf;
+	ring->buf[i].type = type;
+
+	desc->ctrl &= ~DESC_EMPTY;
+	ring->curr += n;
+
+	/* flush descriptor */
+	wmb();
+
+	return 0;
+}
+
+static int ag71xx_xdp_xmit_back(struct ag71xx *ag, struct xdp_buff *xdp)
+{
+	struct netdev_queue *txq = netdev_get_tx_queue(ag->dev, 0);
+	struct xdp_frame *xdpf;
+	int ret;
+
+	xdpf = xdp_convert_buff_to_frame(xdp);
+	if (unlikely(!xdpf))
+		return -EOVERFLOW;
+
+	__netif_tx_lock(txq, smp_processor_id());
+	ret = ag71xx_xdp_submit_frame(ag, xdpf, false);
+	__netif_tx_unlock(txq);
+
+	return ret;
+}
+
+static int ag71xx_xdp_xmit(struct net_device *dev, int n,
+			   struct xdp_frame **frames, u32 flags)
+{
+	struct ag71xx *ag = netdev_priv(dev);
+	struct ag71xx_xdp_stats stats = {};
+	struct netdev_queue *txq;
+	int i, nxmit = 0;
+
+	if (unlikely(flags & ~XDP_XMIT_FLAGS_MASK))
+		return -EINVAL;
+
+	if (unlikely(!netif_running(dev) || !netif_carrier_ok(dev)))
+		return -ENETDOWN;
+
+	txq = netdev_get_tx_queue(dev, 0);
+	__netif_tx_lock(txq, smp_processor_id());
+
+	for (i = 0; i < n; i++) {
+		if (ag71xx_xdp_submit_frame(ag, frames[i], true))
+			break;
+		nxmit++;
+	}
+
+	/* enable TX engine */
+	if (nxmit)
+		ag71xx_wr(ag, AG71XX_REG_TX_CTRL, TX_CTRL_TXE);
+
+	__netif_tx_unlock(txq);
+
+	stats.xmit = nxmit;
+	stats.xmit_err = n - nxmit;
+	ag71xx_debugfs_update_xdp_stats(ag, &stats);
+
+	return nxmit;
+}
+
+static bool ag71xx_xdp_mtu_ok(struct ag71xx *ag, int mtu)
+{
+	unsigned int headroom;
+
+	headroom = ag->rx_buf_offset + XDP_PACKET_HEADROOM - NET_SKB_PAD;
+
+	return SKB_DATA_ALIGN(ag71xx_max_frame_len(mtu) + headroom) +
+	       SKB_DATA_ALIGN(sizeof(struct skb_shared_info)) <= PAGE_SIZE;
+}
+
+static int ag71xx_xdp_setup(struct net_device *dev, struct bpf_prog *prog,
+			    struct netlink_ext_ack *extack)
+{
+	struct ag71xx *ag = netdev_priv(dev);
+	bool running = netif_running(dev);
+	struct bpf_prog *old_prog;
+	bool need_reset;
+	int err;
+
+	if (prog && !ag71xx_xdp_mtu_ok(ag, dev->mtu)) {
+		NL_SET_ERR_MSG_MOD(extack, "MTU too large for XDP");
+		return -EOPNOTSUPP;
+	}
+
+	/* headroom and DMA direction of the RX buffers change */
+	need_reset = !!ag->xdp_prog != !!prog;
+	if (running && need_reset)
+		ag71xx_hw_disable(ag);
+
+	old_prog = xchg(&ag->xdp_prog, prog);
+
+	if (running && need_reset) {
+		ag71xx_rx_buf_setup(ag);
+		err = ag71xx_hw_enable(ag);
+		if (err) {
+			NL_SET_ERR_MSG_MOD(extack, "failed to restart the interface");
+
+			/* bring the interface back up with the old program */
+			xchg(&ag->xdp_prog, old_prog);
+			ag71xx_rx_buf_setup(ag);
+			if (ag71xx_hw_enable(ag)) {
+				netdev_err(dev, "unable to restart the interface\n");
+				/*
+				 * The rings are gone, shut the interface down.
+				 * ag71xx_stop() expects NAPI to be enabled.
+				 */
+				napi_enable(&ag->napi);
+				dev_close(dev);
+				return err;
+			}
+			if (ag->link)
+				__ag71xx_link_adjust(ag, false);
+			return err;
+		}
+		if (ag->link)
+			__ag71xx_link_adjust(ag, false);
+	}
+
+	if (old_prog)
+		bpf_prog_put(old_prog);
+
+	return 0;
+}
+
+static int ag71xx_bpf(struct net_device *dev, struct netdev_bpf *bpf)
+{
+	switch (bpf->command) {
+	case XDP_SETUP_PROG:
+		return ag71xx_xdp_setup(dev, bpf->prog, bpf->extack);
+	default:
+		return -EINVAL;
+	}
+}
+
 static int ag71xx_do_ioctl(struct net_device *dev, struct ifreq *ifr, int cmd)
 {
 	struct ag71xx *ag = netdev_priv(dev);
@@ -1253,6 +1819,8 @@ static int ag71xx_tx_packets(struct ag71xx *ag, bool flush, int budget)
 	int ring_size = BIT(ring->order);
 	int sent = 0;
 	int bytes_compl = 0;
+	int skb_sent = 0;
+	int skb_bytes_compl = 0;
 	int n = 0;
 
 	DBG("%s: processing TX ring\n", ag->dev->name);
@@ -1278,7 +1846,18 @@ static int ag71xx_tx_packets(struct ag71xx *ag, bool flush, int budget)
 		if (!skb)
 			continue;
 
-		napi_consume_skb(skb, budget);
+		/* XDP frames are not accounted in BQL */
+		if (ring->buf[i].type == AG71XX_BUF_SKB) {
+			napi_consume_skb(skb, budget);
+			skb_bytes_compl += ring->buf[i].len;
+			skb_sent++;
+		} else {
+			if (budget)
+				xdp_return_frame_rx_napi(ring->buf[i].xdpf);
+			else
+				xdp_return_frame(ring->buf[i].xdpf);
+			ring->buf[i].type = AG71XX_BUF_SKB;
+		}
 		ring->buf[i].skb = NULL;
 
 		bytes_compl += ring->buf[i].len;
@@ -1300,7 +1879,7 @@ static int ag71xx_tx_packets(struct ag71xx *ag, bool flush, int budget)
 	ag->dev->stats.tx_bytes += bytes_compl;
 	ag->dev->stats.tx_packets += sent;
 
-	netdev_completed_queue(ag->dev, sent, bytes_compl);
+	netdev_completed_queue(ag->dev, skb_sent, skb_bytes_compl);
 	if ((ring->curr - ring->dirty) < (ring_size * 3) / 4)
 		netif_wake_queue(ag->dev);
 
@@ -1310,14 +1889,58 @@ static int ag71xx_tx_packets(struct ag71xx *ag, bool flush, int budget)
 	return sent;
 }
 
+static u32 ag71xx_run_xdp(struct ag71xx *ag, struct bpf_prog *prog,
+			  struct xdp_buff *xdp, struct ag71xx_xdp_stats *stats)
+{
+	struct net_device *dev = ag->dev;
+	u32 act;
+
+	act = bpf_prog_run_xdp(prog, xdp);
+	switch (act) {
+	case XDP_PASS:
+		stats->pass++;
+		return act;
+	case XDP_TX:
+		if (ag71xx_xdp_xmit_back(ag, xdp)) {
+			stats->tx_err++;
+			break;
+		}
+		stats->tx++;
+		return act;
+	case XDP_REDIRECT:
+		if (xdp_do_redirect(dev, xdp, prog)) {
+			stats->redirect_err++;
+			break;
+		}
+		stats->redirect++;
+		return act;
+	default:
+		bpf_warn_invalid_xdp_action(dev, prog, act);
+		fallthrough;
+	case XDP_ABORTED:
+		trace_xdp_exception(dev, prog, act);
+		stats->aborted++;
+		break;
+	case XDP_DROP:
+		stats->drop++;
+		break;
+	}
+
+	page_pool_put_full_page(ag->page_pool, virt_to_head_page(xdp->data),
+				true);
+	return XDP_DROP;
+}
+
 static int ag71xx_rx_packets(struct ag71xx *ag, int limit)
 {
 	struct net_device *dev = ag->dev;
 	struct ag71xx_ring *ring = &ag->rx_ring;
 	unsigned int pktlen_mask = ag->desc_pktlen_mask;
-	unsigned int offset = ag->rx_buf_offset;
+	unsigned int frame_size = ag71xx_rx_frame_size(ag);
 	int ring_mask = BIT(ring->order) - 1;
 	int ring_size = BIT(ring->order);
+	struct ag71xx_xdp_stats xdp_stats = {};
+	struct bpf_prog *xdp_prog;
 	struct list_head rx_list;
 	struct sk_buff *skb;
 	int done = 0;
@@ -1326,11 +1949,14 @@ static int ag71xx_rx_packets(struct ag71xx *ag, int limit)
 			dev->name, limit, ring->curr, ring->dirty);
 	INIT_LIST_HEAD(&rx_list);
 
+	xdp_prog = READ_ONCE(ag->xdp_prog);
+
 	while (done < limit) {
 		unsigned int i = ring->curr & ring_mask;
 		struct ag71xx_desc *desc = ag71xx_ring_desc(ring, i);
+		unsigned int offset = ag->rx_headroom;
+		void *data = ring->buf[i].rx_buf;
 		int pktlen;
-		int err = 0;
 
 		if (ag71xx_desc_empty(desc))
 			break;
@@ -1345,29 +1971,42 @@ static int ag71xx_rx_packets(struct ag71xx *ag, int limit)
 		pktlen = desc->ctrl & pktlen_mask;
 		pktlen -= ETH_FCS_LEN;
 
-		dma_unmap_single(&ag->pdev->dev, ring->buf[i].dma_addr,
-				 ag->rx_buf_size, DMA_FROM_DEVICE);
+		dma_sync_single_for_cpu(&ag->pdev->dev,
+					ring->buf[i].dma_addr + offset, pktlen,
+					page_pool_get_dma_dir(ag->page_pool));
 
 		dev->stats.rx_packets++;
 		dev->stats.rx_bytes += pktlen;
 
-		skb = napi_build_skb(ring->buf[i].rx_buf, ag71xx_buffer_size(ag));
+		if (xdp_prog) {
+			struct xdp_buff xdp;
+
+			xdp_init_buff(&xdp, frame_size, &ag->xdp_rxq);
+			xdp_prepare_buff(&xdp, data, offset, pktlen, false);
+
+			if (ag71xx_run_xdp(ag, xdp_prog, &xdp, &xdp_stats) !=
+			    XDP_PASS)
+				goto next;
+
+			offset = xdp.data - xdp.data_hard_start;
+			pktlen = xdp.data_end - xdp.data;
+		}
+
+		skb = napi_build_skb(data, frame_size);
 		if (!skb) {
-			skb_free_frag(ring->buf[i].rx_buf);
+			page_pool_recycle_direct(ag->page_pool,
+						 virt_to_head_page(data));
+			dev->stats.rx_dropped++;
 			goto next;
 		}
 
+		skb_mark_for_recycle(skb);
 		skb_reserve(skb, offset);
 		skb_put(skb, pktlen);
 
-		if (err) {
-			dev->stats.rx_dropped++;
-			kfree_skb(skb);
-		} else {
-			skb->dev = dev;
-			skb->ip_summed = CHECKSUM_NONE;
-			list_add_tail(&skb->list, &rx_list);
-		}
+		skb->dev = dev;
+		skb->ip_summed = CHECKSUM_NONE;
+		list_add_tail(&skb->list, &rx_list);
 
 next:
 		ring->buf[i].rx_buf = NULL;
@@ -1376,6 +2015,16 @@ next:
 		ring->curr++;
 	}
 
+	if (xdp_stats.redirect)
+		xdp_do_flush();
+
+	/* enable TX engine for XDP_TX frames */
+	if (xdp_stats.tx)
+		ag71xx_wr(ag, AG71XX_REG_TX_CTRL, TX_CTRL_TXE);
+
+	if (xdp_prog)
+		ag71xx_debugfs_update_xdp_stats(ag, &xdp_stats);
+
 	ag71xx_ring_rx_refill(ag);
 
 	list_for_each_entry(skb, &rx_list, list)
@@ -1490,6 +2139,9 @@ static int ag71xx_change_mtu(struct net_device *dev, int new_mtu)
 {
 	struct ag71xx *ag = netdev_priv(dev);
 
+	if (ag->xdp_prog && !ag71xx_xdp_mtu_ok(ag, new_mtu))
+		return -EINVAL;
+
 	dev->mtu = new_mtu;
 	ag71xx_wr(ag, AG71XX_REG_MAC_MFL,
 		  ag71xx_max_frame_len(dev->mtu));
@@ -1506,6 +2158,9 @@ static const struct net_device_ops ag71xx_netdev_ops = {
 	.ndo_change_mtu		= ag71xx_change_mtu,
 	.ndo_set_mac_address	= eth_mac_addr,
 	.ndo_validate_addr	= eth_validate_addr,
+	.ndo_features_check	= ag71xx_features_check,
+	.ndo_bpf		= ag71xx_bpf,
+	.ndo_xdp_xmit		= ag71xx_xdp_xmit,
 };
 
 static int ag71xx_probe(struct platform_device *pdev)
@@ -1611,6 +2266,13 @@ static int ag71xx_probe(struct platform_device *pdev)
 
 	dev->netdev_ops = &ag71xx_netdev_ops;
 	dev->ethtool_ops = &ag71xx_ethtool_ops;
+	dev->hw_features = NETIF_F_SG | NETIF_F_IP_CSUM | NETIF_F_IPV6_CSUM |
+			   NETIF_F_TSO | NETIF_F_TSO6;
+	dev->features |= dev->hw_features;
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6,3,0)
+	dev->xdp_features = NETDEV_XDP_ACT_BASIC | NETDEV_XDP_ACT_REDIRECT |
+			    NETDEV_XDP_ACT_NDO_XMIT;
+#endif
 
 	INIT_DELAYED_WORK(&ag->restart_work, ag71xx_restart_work_func);
 
@@ -12,18 +12,156 @@
 
 #define pr_fmt(fmt)	"mtdsplit: " fmt
 
+#include <linux/bitmap.h>
 #include <linux/export.h>
 #include <linux/init.h>
 #include <linux/kernel.h>
+#include <linux/ktime.h>
+#include <linux/list.h>
 #include <linux/magic.h>
+#include <linux/mm.h>
 #include <linux/mtd/mtd.h>
 #include <linux/mtd/partitions.h>
+#include <linux/mutex.h>
+#include <linux/slab.h>
 #include <linux/byteorder/generic.h>
 
 #include "mtdsplit.h"
 
 #define UBI_EC_MAGIC			0x55424923	/* UBI# */
 
+#define MTDSPLIT_SCAN_HDR_LEN		64
+#define MTDSPLIT_SCAN_MAX_BLOCKS	4096
+
+/*
+ * The first bytes of every erase block, read in one sequential pass the
+ * first time a parser looks at the device. All the parsers probing the
+ * same device for uImage, FIT, TRX, LZMA or rootfs magics share it.
+ */
+struct mtdsplit_scan {
+	struct list_head list;
+	struct mtd_info *mtd;
+	uint64_t size;
+	u32 erasesize;
+	unsigned int nr_blocks;
+	unsigned long *valid;
+	u8 hdr[][MTDSPLIT_SCAN_HDR_LEN];
+};
+
+static LIST_HEAD(mtdsplit_scans);
+static DEFINE_MUTEX(mtdsplit_scan_lock);
+
+static void mtdsplit_scan_free(struct mtdsplit_scan *scan)
+{
+	list_del(&scan->list);
+	bitmap_free(scan->valid);
+	kvfree(scan);
+}
+
+static struct mtdsplit_scan *mtdsplit_scan_get(struct mtd_info *mtd)
+{
+	struct mtdsplit_scan *scan;
+	unsigned int nr_blocks, i;
+	size_t retlen;
+	ktime_t start;
+	loff_t offset;
+	int ret;
+
+	list_for_each_entry(scan, &mtdsplit_scans, list) {
+		if (scan->mtd != mtd)
+			continue;
+
+		if (scan->size == mtd->size && scan->erasesize == mtd->erasesize)
+			return scan;
+
+		/* same pointer but a different device, rescan */
+		mtdsplit_scan_free(scan);
+		break;
+	}
+
+	if (!mtd->erasesize)
+		return NULL;
+
+	nr_blocks = div_u64(mtd->size, mtd->erasesize);
+	if (!nr_blocks || nr_blocks > MTDSPLIT_SCAN_MAX_BLOCKS)
+		return NULL;
+
+	scan = kvzalloc(struct_size(scan, hdr, nr_blocks), GFP_KERNEL);
+	if (!scan)
+		return NULL;
+
+	scan->valid = bitmap_zalloc(nr_blocks, GFP_KERNEL);
+	if (!scan->valid) {
+		kvfree(scan);
+		return NULL;
+	}
+
+	scan->mtd = mtd;
+	scan->size = mtd->size;
+	scan->erasesize = mtd->erasesize;
+	scan->nr_blocks = nr_blocks;
+
+	start = ktime_get();
+	for (i = 0; i < nr_blocks; i++) {
+		offset = (loff_t) i * mtd->erasesize;
+
+		/* bad or unreadable blocks are left to a direct read */
+		if (mtd_can_have_bb(mtd) && mtd_block_isbad(mtd, offset))
+			continue;
+
+		ret = mtd_read(mtd, offset, MTDSPLIT_SCAN_HDR_LEN, &retlen,
+			       scan->hdr[i]);
+		if (ret || retlen != MTDSPLIT_SCAN_HDR_LEN)
+			continue;
+
+		set_bit(i, scan->valid);
+	}
+
+	pr_info("scanned %u erase blocks of \"%s\" in %lld us\n",
+		nr_blocks, mtd->name, ktime_us_delta(ktime_get(), start));
+
+	list_add(&scan->list, &mtdsplit_scans);
+	return scan;
+}
+
+/*
+ * Read a header from the device. Requests which fit into the scanned
+ * start of an erase block are served from the scan cache, everything
+ * else goes to the flash.
+ */
+int mtdsplit_read_header(struct mtd_info *mtd, size_t offset, size_t len,
+			 void *buf)
+{
+	struct mtdsplit_scan *scan;
+	unsigned int block;
+	size_t retlen;
+	u32 block_ofs;
+	int ret;
+
+	block = div_u64_rem(offset, mtd->erasesize ? : 1, &block_ofs);
+	if (block_ofs + len <= MTDSPLIT_SCAN_HDR_LEN) {
+		mutex_lock(&mtdsplit_scan_lock);
+		scan = mtdsplit_scan_get(mtd);
+		if (scan && block < scan->nr_blocks &&
+		    test_bit(block, scan->valid)) {
+			memcpy(buf, scan->hdr[block] + block_ofs, len);
+			mutex_unlock(&mtdsplit_scan_lock);
+			return 0;
+		}
+		mutex_unlock(&mtdsplit_scan_lock);
+	}
+
+	ret = mtd_read(mtd, offset, len, &retlen, buf);
+	if (ret)
+		return ret;
+
+	if (retlen != len)
+		return -EIO;
+
+	return 0;
+}
+EXPORT_SYMBOL_GPL(mtdsplit_read_header);
+
 struct squashfs_super_block {
 	__le32 s_magic;
 	__le32 pad0[9];
@@ -76,17 +214,12 @@ int mtd_check_rootfs_magic(struct mtd_info *mtd, size_t offset,
 			   enum mtdsplit_part_type *type)
 {
 	u32 magic;
-	size_t retlen;
 	int ret;
 
-	ret = mtd_read(mtd, offset, sizeof(magic), &retlen,
-		       (unsigned char *) &magic);
+	ret = mtdsplit_read_header(mtd, offset, sizeof(magic), &magic);
 	if (ret)
 		return ret;
 
-	if (retlen != sizeof(magic))
-		return -EIO;
-
 	if (le32_to_cpu(magic) == SQUASHFS_MAGIC) {
 		if (type)
 			*type = MTDSPLIT_PART_TYPE_SQUASHFS;
@@ -128,3 +261,44 @@ int mtd_find_rootfs_from(struct mtd_info *mtd,
 }
 EXPORT_SYMBOL_GPL(mtd_find_rootfs_from);
 
+static void mtdsplit_notify_add(struct mtd_info *mtd)
+{
+}
+
+static void mtdsplit_notify_remove(struct mtd_info *mtd)
+{
+	struct mtdsplit_scan *scan, *tmp;
+
+	mutex_lock(&mtdsplit_scan_lock);
+	list_for_each_entry_safe(scan, tmp, &mtdsplit_scans, list)
+		if (scan->mtd == mtd)
+			mtdsplit_scan_free(scan);
+	mutex_unlock(&mtdsplit_scan_lock);
+}
+
+static struct mtd_notifier mtdsplit_notifier = {
+	.add = mtdsplit_notify_add,
+	.remove = mtdsplit_notify_remove,
+};
+
+static int __init mtdsplit_init(void)
+{
+	register_mtd_user(&mtdsplit_notifier);
+
+	return 0;
+}
+subsys_initcall(mtdsplit_init);
+
+/* partitions found during boot have been parsed, drop their headers */
+static int __init mtdsplit_scan_release(void)
+{
+	struct mtdsplit_scan *scan, *tmp;
+
+	mutex_lock(&mtdsplit_scan_lock);
+	list_for_each_entry_safe(scan, tmp, &mtdsplit_scans, list)
+		mtdsplit_scan_free(scan);
+	mutex_unlock(&mtdsplit_scan_lock);
+
+	return 0;
+}
+late_initcall_sync(mtdsplit_scan_release);
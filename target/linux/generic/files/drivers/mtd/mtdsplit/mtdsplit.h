@@ -27,6 +27,9 @@ enum mtdsplit_part_type {
 };
 
 #ifdef CONFIG_MTD_SPLIT
+int mtdsplit_read_header(struct mtd_info *mtd, size_t offset, size_t len,
+			 void *buf);
+
 int mtd_get_squashfs_len(struct mtd_info *master,
 			 size_t offset,
 			 size_t *squashfs_len);
@@ -41,6 +44,19 @@ int mtd_find_rootfs_from(struct mtd_info *mtd,
 			 enum mtdsplit_part_type *type);
 
 #else
+static inline int mtdsplit_read_header(struct mtd_info *mtd, size_t offset,
+				       size_t len, void *buf)
+{
+	size_t retlen;
+	int ret;
+
+	ret = mtd_read(mtd, offset, len, &retlen, buf);
+	if (ret)
+		return ret;
+
+	return retlen == len ? 0 : -EIO;
+}
+
 static inline int mtd_get_squashfs_len(struct mtd_info *master,
 				       size_t offset,
 				       size_t *squashfs_len)
@@ -19,6 +19,8 @@
 #include <linux/module.h>
 #include <linux/init.h>
 #include <linux/list.h>
+#include <linux/hashtable.h>
+#include <linux/jhash.h>
 #include <linux/if_ether.h>
 #include <linux/skbuff.h>
 #include <linux/netdevice.h>
@@ -1407,6 +1409,9 @@ ar8xxx_sw_hw_apply(struct switch_dev *dev)
 	if (chip->reg_arl_ctrl)
 		ar8xxx_set_age_time(priv, chip->reg_arl_ctrl);
 
+	/* port and vlan membership may have changed */
+	priv->arl_valid = false;
+
 	mutex_unlock(&priv->reg_mutex);
 	return 0;
 }
@@ -1436,6 +1441,7 @@ ar8xxx_sw_reset_switch(struct switch_dev *dev)
 
 	chip->init_globals(priv);
 	chip->atu_flush(priv);
+	priv->arl_valid = false;
 
 	mutex_unlock(&priv->reg_mutex);
 
@@ -1766,6 +1772,35 @@ ar8xxx_sw_set_arl_age_time(struct switch_dev *dev, const struct switch_attr *att
 	return 0;
 }
 
+int
+ar8xxx_sw_set_arl_refresh_interval(struct switch_dev *dev,
+				   const struct switch_attr *attr,
+				   struct switch_val *val)
+{
+	struct ar8xxx_priv *priv = swdev_to_ar8xxx(dev);
+
+	if (val->value.i < 0)
+		return -EINVAL;
+
+	mutex_lock(&priv->reg_mutex);
+	priv->arl_refresh_interval = val->value.i;
+	priv->arl_valid = false;
+	mutex_unlock(&priv->reg_mutex);
+
+	return 0;
+}
+
+int
+ar8xxx_sw_get_arl_refresh_interval(struct switch_dev *dev,
+				   const struct switch_attr *attr,
+				   struct switch_val *val)
+{
+	struct ar8xxx_priv *priv = swdev_to_ar8xxx(dev);
+
+	val->value.i = priv->arl_refresh_interval;
+	return 0;
+}
+
 int
 ar8xxx_sw_get_arl_age_time(struct switch_dev *dev, const struct switch_attr *attr,
                    struct switch_val *val)
@@ -1775,63 +1810,101 @@ ar8xxx_sw_get_arl_age_time(struct switch_dev *dev, const struct switch_attr *att
 	return 0;
 }
 
-int
-ar8xxx_sw_get_arl_table(struct switch_dev *dev,
-			const struct switch_attr *attr,
-			struct switch_val *val)
+static u32
+ar8xxx_arl_hash(const u8 *mac)
+{
+	return jhash(mac, ETH_ALEN, 0);
+}
+
+static struct arl_entry *
+ar8xxx_arl_lookup(struct ar8xxx_priv *priv, const u8 *mac)
+{
+	struct arl_entry *a;
+
+	hash_for_each_possible(priv->arl_hash, a, node, ar8xxx_arl_hash(mac))
+		if (!memcmp(a->mac, mac, ETH_ALEN))
+			return a;
+
+	return NULL;
+}
+
+/*
+ * Refresh the ARL snapshot from the hardware, unless it is recent enough.
+ * Entries that aged out of the switch are dropped as the snapshot is
+ * rebuilt, duplicates (same MAC with different status codes) are merged
+ * through the hash. Caller holds reg_mutex.
+ */
+static void
+ar8xxx_arl_refresh(struct ar8xxx_priv *priv)
 {
-	struct ar8xxx_priv *priv = swdev_to_ar8xxx(dev);
-	struct mii_bus *bus = priv->mii_bus;
 	const struct ar8xxx_chip *chip = priv->chip;
-	char *buf = priv->arl_buf;
-	int i, j, k, len = 0;
-	struct arl_entry *a, *a1;
+	struct mii_bus *bus = priv->mii_bus;
+	struct arl_entry *a, *old;
 	u32 status;
+	int n = 0;
 
-	if (!chip->get_arl_entry)
-		return -EOPNOTSUPP;
+	if (priv->arl_valid &&
+	    time_before(jiffies, priv->arl_updated +
+			msecs_to_jiffies(priv->arl_refresh_interval)))
+		return;
+
+	hash_init(priv->arl_hash);
+	priv->arl_truncated = false;
 
-	mutex_lock(&priv->reg_mutex);
 	mutex_lock(&bus->mdio_lock);
 
 	chip->get_arl_entry(priv, NULL, NULL, AR8XXX_ARL_INITIALIZE);
 
-	for(i = 0; i < AR8XXX_NUM_ARL_RECORDS; ++i) {
-		a = &priv->arl_table[i];
-		duplicate:
-		chip->get_arl_entry(priv, a, &status, AR8XXX_ARL_GET_NEXT);
+	while (1) {
+		if (n == AR8XXX_NUM_ARL_RECORDS) {
+			priv->arl_truncated = true;
+			break;
+		}
 
+		a = &priv->arl_table[n];
+		chip->get_arl_entry(priv, a, &status, AR8XXX_ARL_GET_NEXT);
 		if (!status)
 			break;
 
-		/* avoid duplicates
-		 * ARL table can include multiple valid entries
-		 * per MAC, just with differing status codes
-		 */
-		for (j = 0; j < i; ++j) {
-			a1 = &priv->arl_table[j];
-			if (!memcmp(a->mac, a1->mac, sizeof(a->mac))) {
-				/* ignore ports already seen in former entry */
-				a->portmap &= ~a1->portmap;
-				if (!a->portmap)
-					goto duplicate;
-			}
+		old = ar8xxx_arl_lookup(priv, a->mac);
+		if (old) {
+			old->portmap |= a->portmap;
+			continue;
 		}
+
+		hash_add(priv->arl_hash, &a->node, ar8xxx_arl_hash(a->mac));
+		n++;
 	}
 
 	mutex_unlock(&bus->mdio_lock);
 
-	len += snprintf(buf + len, sizeof(priv->arl_buf) - len,
-                        "address resolution table\n");
+	priv->arl_count = n;
+	priv->arl_updated = jiffies;
+	priv->arl_valid = true;
+}
+
+static int
+ar8xxx_arl_format(struct ar8xxx_priv *priv, int port)
+{
+	char *buf = priv->arl_buf;
+	struct arl_entry *a;
+	int i, j, len = 0;
+
+	if (port < 0)
+		len += snprintf(buf + len, sizeof(priv->arl_buf) - len,
+				"address resolution table\n");
 
-	if (i == AR8XXX_NUM_ARL_RECORDS)
+	if (priv->arl_truncated)
 		len += snprintf(buf + len, sizeof(priv->arl_buf) - len,
 				"Too many entries found, displaying the first %d only!\n",
 				AR8XXX_NUM_ARL_RECORDS);
 
 	for (j = 0; j < priv->dev.ports; ++j) {
-		for (k = 0; k < i; ++k) {
-			a = &priv->arl_table[k];
+		if (port >= 0 && j != port)
+			continue;
+
+		for (i = 0; i < priv->arl_count; ++i) {
+			a = &priv->arl_table[i];
 			if (!(a->portmap & BIT(j)))
 				continue;
 			len += snprintf(buf + len, sizeof(priv->arl_buf) - len,
@@ -1842,8 +1915,51 @@ ar8xxx_sw_get_arl_table(struct switch_dev *dev,
 		}
 	}
 
-	val->value.s = buf;
-	val->len = len;
+	return len;
+}
+
+int
+ar8xxx_sw_get_arl_table(struct switch_dev *dev,
+			const struct switch_attr *attr,
+			struct switch_val *val)
+{
+	struct ar8xxx_priv *priv = swdev_to_ar8xxx(dev);
+
+	if (!priv->chip->get_arl_entry)
+		return -EOPNOTSUPP;
+
+	mutex_lock(&priv->reg_mutex);
+
+	ar8xxx_arl_refresh(priv);
+
+	val->value.s = priv->arl_buf;
+	val->len = ar8xxx_arl_format(priv, -1);
+
+	mutex_unlock(&priv->reg_mutex);
+
+	return 0;
+}
+
+int
+ar8xxx_sw_get_port_arl_table(struct switch_dev *dev,
+			     const struct switch_attr *attr,
+			     struct switch_val *val)
+{
+	struct ar8xxx_priv *priv = swdev_to_ar8xxx(dev);
+	int port = val->port_vlan;
+
+	if (!priv->chip->get_arl_entry)
+		return -EOPNOTSUPP;
+
+	if (port >= dev->ports)
+		return -EINVAL;
+
+	mutex_lock(&priv->reg_mutex);
+
+	ar8xxx_arl_refresh(priv);
+
+	val->value.s = priv->arl_buf;
+	val->len = ar8xxx_arl_format(priv, port);
 
 	mutex_unlock(&priv->reg_mutex);
 
@@ -1860,6 +1976,7 @@ ar8xxx_sw_set_flush_arl_table(struct switch_dev *dev,
 
 	mutex_lock(&priv->reg_mutex);
 	ret = priv->chip->atu_flush(priv);
+	priv->arl_valid = false;
 	mutex_unlock(&priv->reg_mutex);
 
 	return ret;
@@ -1879,6 +1996,7 @@ ar8xxx_sw_set_flush_port_arl_table(struct switch_dev *dev,
 
 	mutex_lock(&priv->reg_mutex);
 	ret = priv->chip->atu_flush_port(priv, port);
+	priv->arl_valid = false;
 	mutex_unlock(&priv->reg_mutex);
 
 	return ret;
@@ -1994,6 +2112,13 @@ static const struct switch_attr ar8xxx_sw_attr_globals[] = {
 		.set = NULL,
 		.get = ar8xxx_sw_get_arl_table,
 	},
+	{
+		.type = SWITCH_TYPE_INT,
+		.name = "arl_refresh_interval",
+		.description = "Max age of the ARL table snapshot in msecs (0 to always re-read)",
+		.set = ar8xxx_sw_set_arl_refresh_interval,
+		.get = ar8xxx_sw_get_arl_refresh_interval,
+	},
 	{
 		.type = SWITCH_TYPE_NOVAL,
 		.name = "flush_arl_table",
@@ -2016,6 +2141,13 @@ const struct switch_attr ar8xxx_sw_attr_port[] = {
 		.set = NULL,
 		.get = ar8xxx_sw_get_port_mib,
 	},
+	{
+		.type = SWITCH_TYPE_STRING,
+		.name = "arl_table",
+		.description = "Get port's ARL table entries",
+		.set = NULL,
+		.get = ar8xxx_sw_get_port_arl_table,
+	},
 	{
 		.type = SWITCH_TYPE_NOVAL,
 		.name = "flush_arl_table",
@@ -2360,6 +2492,7 @@ ar8xxx_create(void)
 	mutex_init(&priv->reg_mutex);
 	mutex_init(&priv->mib_lock);
 	INIT_DELAYED_WORK(&priv->mib_work, ar8xxx_mib_work_func);
+	priv->arl_refresh_interval = AR8XXX_DEFAULT_ARL_REFRESH_INTERVAL;
 
 	return priv;
 }
@@ -2489,8 +2622,10 @@ ar8xxx_check_link_states(struct ar8xxx_priv *priv)
 		priv->link_up[i] = link_new;
 		changed = true;
 		/* flush ARL entries for this port if it went down*/
-		if (!link_new)
+		if (!link_new) {
 			priv->chip->atu_flush_port(priv, i);
+			priv->arl_valid = false;
+		}
 		dev_info(&priv->phy->mdio.dev, "Port %d is %s\n",
 			 i, link_new ? "up" : "down");
 	}
@@ -407,6 +407,9 @@ enum {
 };
 
 #define AR8XXX_NUM_ARL_RECORDS	100
+#define AR8XXX_ARL_HASH_BITS	6
+/* default max age (msecs) of the ARL snapshot before the table is walked again */
+#define AR8XXX_DEFAULT_ARL_REFRESH_INTERVAL	1000
 
 enum arl_op {
 	AR8XXX_ARL_INITIALIZE,
@@ -416,6 +419,7 @@ enum arl_op {
 struct arl_entry {
 	u16 portmap;
 	u8 mac[6];
+	struct hlist_node node;
 };
 
 struct ar8xxx_priv;
@@ -491,6 +495,12 @@ struct ar8xxx_priv {
 	bool port4_phy;
 	char buf[2048];
 	struct arl_entry arl_table[AR8XXX_NUM_ARL_RECORDS];
+	DECLARE_HASHTABLE(arl_hash, AR8XXX_ARL_HASH_BITS);
+	int arl_count;
+	bool arl_truncated;
+	bool arl_valid;
+	unsigned long arl_updated;
+	u32 arl_refresh_interval;
 	char arl_buf[AR8XXX_NUM_ARL_RECORDS * 32 + 256];
 	bool link_up[AR8X16_MAX_PORTS];
 
@@ -633,10 +643,22 @@ ar8xxx_sw_set_arl_age_time(struct switch_dev *dev,
 			   const struct switch_attr *attr,
 			   struct switch_val *val);
 int
+ar8xxx_sw_get_arl_refresh_interval(struct switch_dev *dev,
+				   const struct switch_attr *attr,
+				   struct switch_val *val);
+int
+ar8xxx_sw_set_arl_refresh_interval(struct switch_dev *dev,
+				   const struct switch_attr *attr,
+				   struct switch_val *val);
+int
 ar8xxx_sw_get_arl_table(struct switch_dev *dev,
 			const struct switch_attr *attr,
 			struct switch_val *val);
 int
+ar8xxx_sw_get_port_arl_table(struct switch_dev *dev,
+			     const struct switch_attr *attr,
+			     struct switch_val *val);
+int
 ar8xxx_sw_set_flush_arl_table(struct switch_dev *dev,
 			      const struct switch_attr *attr,
 			      struct switch_val *val);
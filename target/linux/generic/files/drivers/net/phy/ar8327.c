@@ -16,6 +16,7 @@
  */
 
 #include <linux/list.h>
+#include <linux/hashtable.h>
 #include <linux/bitops.h>
 #include <linux/switch.h>
 #include <linux/delay.h>
@@ -1381,6 +1382,13 @@ static const struct switch_attr ar8327_sw_attr_globals[] = {
 		.set = NULL,
 		.get = ar8xxx_sw_get_arl_table,
 	},
+	{
+		.type = SWITCH_TYPE_INT,
+		.name = "arl_refresh_interval",
+		.description = "Max age of the ARL table snapshot in msecs (0 to always re-read)",
+		.set = ar8xxx_sw_set_arl_refresh_interval,
+		.get = ar8xxx_sw_get_arl_refresh_interval,
+	},
 	{
 		.type = SWITCH_TYPE_NOVAL,
 		.name = "flush_arl_table",
@@ -1427,6 +1435,13 @@ static const struct switch_attr ar8327_sw_attr_port[] = {
 		.get = ar8327_sw_get_eee,
 		.max = 1,
 	},
+	{
+		.type = SWITCH_TYPE_STRING,
+		.name = "arl_table",
+		.description = "Get port's ARL table entries",
+		.set = NULL,
+		.get = ar8xxx_sw_get_port_arl_table,
+	},
 	{
 		.type = SWITCH_TYPE_NOVAL,
 		.name = "flush_arl_table",
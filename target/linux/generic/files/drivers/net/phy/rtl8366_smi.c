@@ -21,6 +21,9 @@
 #include <linux/rtl8366.h>
 #include <linux/version.h>
 #include <linux/of_mdio.h>
+#include <linux/bitmap.h>
+#include <linux/ktime.h>
+#include <linux/slab.h>
 
 #ifdef CONFIG_RTL8366_SMI_DEBUG_FS
 #include <linux/debugfs.h>
@@ -38,6 +41,51 @@ static inline void rtl8366_smi_clk_delay(struct rtl8366_smi *smi)
 	ndelay(smi->clk_delay);
 }
 
+#ifdef CONFIG_RTL8366_SMI_DEBUG_FS
+static inline u64 rtl8366_smi_stat_start(void)
+{
+	return ktime_get_ns();
+}
+
+/* the statistics are protected by smi->lock */
+static inline void rtl8366_smi_stat_end(struct rtl8366_smi *smi, u64 start,
+					unsigned int xfers)
+{
+	u64 delta;
+
+	smi->stat_xfers += xfers;
+	if (!start)
+		return;
+
+	delta = ktime_get_ns() - start;
+	smi->stat_irqoff_ns += delta;
+	if (delta > smi->stat_irqoff_max_ns)
+		smi->stat_irqoff_max_ns = delta;
+}
+
+static inline void rtl8366_smi_stat_hit(struct rtl8366_smi *smi)
+{
+	smi->stat_cache_hits++;
+}
+
+static void rtl8366_smi_stat_count(struct rtl8366_smi *smi,
+				   unsigned int xfers)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&smi->lock, flags);
+	rtl8366_smi_stat_end(smi, 0, xfers);
+	spin_unlock_irqrestore(&smi->lock, flags);
+}
+#else
+static inline u64 rtl8366_smi_stat_start(void) { return 0; }
+static inline void rtl8366_smi_stat_end(struct rtl8366_smi *smi, u64 start,
+					unsigned int xfers) {}
+static inline void rtl8366_smi_stat_hit(struct rtl8366_smi *smi) {}
+static inline void rtl8366_smi_stat_count(struct rtl8366_smi *smi,
+					  unsigned int xfers) {}
+#endif
+
 static void rtl8366_smi_start(struct rtl8366_smi *smi)
 {
 	unsigned int sda = smi->gpio_sda;
@@ -199,15 +247,13 @@ static int rtl8366_smi_read_byte1(struct rtl8366_smi *smi, u8 *data)
 	return 0;
 }
 
-static int __rtl8366_smi_read_reg(struct rtl8366_smi *smi, u32 addr, u32 *data)
+/* called with smi->lock held */
+static int rtl8366_smi_do_read(struct rtl8366_smi *smi, u32 addr, u32 *data)
 {
-	unsigned long flags;
 	u8 lo = 0;
 	u8 hi = 0;
 	int ret;
 
-	spin_lock_irqsave(&smi->lock, flags);
-
 	rtl8366_smi_start(smi);
 
 	/* send READ command */
@@ -236,10 +282,39 @@ static int __rtl8366_smi_read_reg(struct rtl8366_smi *smi, u32 addr, u32 *data)
 
  out:
 	rtl8366_smi_stop(smi);
+
+	return ret;
+}
+
+/*
+ * A single bus transaction in its own short IRQ-off window, called with
+ * smi->bus_lock held.
+ */
+static int rtl8366_smi_bus_read(struct rtl8366_smi *smi, u32 addr, u32 *data)
+{
+	unsigned long flags;
+	u64 start;
+	int ret;
+
+	spin_lock_irqsave(&smi->lock, flags);
+	start = rtl8366_smi_stat_start();
+	ret = rtl8366_smi_do_read(smi, addr, data);
+	rtl8366_smi_stat_end(smi, start, 1);
 	spin_unlock_irqrestore(&smi->lock, flags);
 
 	return ret;
 }
+
+static int __rtl8366_smi_read_reg(struct rtl8366_smi *smi, u32 addr, u32 *data)
+{
+	int ret;
+
+	mutex_lock(&smi->bus_lock);
+	ret = rtl8366_smi_bus_read(smi, addr, data);
+	mutex_unlock(&smi->bus_lock);
+
+	return ret;
+}
 /* Read/write via mdiobus */
 #define MDC_MDIO_CTRL0_REG		31
 #define MDC_MDIO_START_REG		29
@@ -254,14 +329,12 @@ static int __rtl8366_smi_read_reg(struct rtl8366_smi *smi, u32 addr, u32 *data)
 #define MDC_MDIO_WRITE_OP		0x0003
 #define MDC_REALTEK_PHY_ADDR		0x0
 
-int __rtl8366_mdio_read_reg(struct rtl8366_smi *smi, u32 addr, u32 *data)
+/* called with the mdio bus lock held */
+static int rtl8366_mdio_do_read(struct rtl8366_smi *smi, u32 addr, u32 *data)
 {
 	u32 phy_id = smi->phy_id;
 	struct mii_bus *mbus = smi->ext_mbus;
 
-	BUG_ON(in_interrupt());
-
-	mutex_lock(&mbus->mdio_lock);
 	/* Write Start command to register 29 */
 	mbus->write(mbus, phy_id, MDC_MDIO_START_REG, MDC_MDIO_START_OP);
 
@@ -286,19 +359,29 @@ int __rtl8366_mdio_read_reg(struct rtl8366_smi *smi, u32 addr, u32 *data)
 	/* Read data from register 25 */
 	*data = mbus->read(mbus, phy_id, MDC_MDIO_DATA_READ_REG);
 
-	mutex_unlock(&mbus->mdio_lock);
-
 	return 0;
 }
 
-static int __rtl8366_mdio_write_reg(struct rtl8366_smi *smi, u32 addr, u32 data)
+int __rtl8366_mdio_read_reg(struct rtl8366_smi *smi, u32 addr, u32 *data)
 {
-	u32 phy_id = smi->phy_id;
 	struct mii_bus *mbus = smi->ext_mbus;
+	int ret;
 
 	BUG_ON(in_interrupt());
 
 	mutex_lock(&mbus->mdio_lock);
+	ret = rtl8366_mdio_do_read(smi, addr, data);
+	mutex_unlock(&mbus->mdio_lock);
+	rtl8366_smi_stat_count(smi, 1);
+
+	return ret;
+}
+
+/* called with the mdio bus lock held */
+static int rtl8366_mdio_do_write(struct rtl8366_smi *smi, u32 addr, u32 data)
+{
+	u32 phy_id = smi->phy_id;
+	struct mii_bus *mbus = smi->ext_mbus;
 
 	/* Write Start command to register 29 */
 	mbus->write(mbus, phy_id, MDC_MDIO_START_REG, MDC_MDIO_START_OP);
@@ -324,27 +407,165 @@ static int __rtl8366_mdio_write_reg(struct rtl8366_smi *smi, u32 addr, u32 data)
 	/* Write data control code to register 21 */
 	mbus->write(mbus, phy_id, MDC_MDIO_CTRL1_REG, MDC_MDIO_WRITE_OP);
 
+	return 0;
+}
+
+static int __rtl8366_mdio_write_reg(struct rtl8366_smi *smi, u32 addr, u32 data)
+{
+	struct mii_bus *mbus = smi->ext_mbus;
+	int ret;
+
+	BUG_ON(in_interrupt());
+
+	mutex_lock(&mbus->mdio_lock);
+	ret = rtl8366_mdio_do_write(smi, addr, data);
 	mutex_unlock(&mbus->mdio_lock);
+	rtl8366_smi_stat_count(smi, 1);
+
+	return ret;
+}
+
+/*
+ * The register cache covers the ranges listed in smi->cache_ranges,
+ * packed back to back.  Entries are protected by smi->lock.
+ */
+static int rtl8366_smi_cache_index(struct rtl8366_smi *smi, u32 addr)
+{
+	unsigned int base = 0;
+	unsigned int i;
+
+	if (!smi->cache)
+		return -1;
+
+	for (i = 0; i < smi->num_cache_ranges; i++) {
+		const struct rtl8366_reg_range *r = &smi->cache_ranges[i];
+
+		if (addr >= r->start && addr < r->start + r->len)
+			return base + addr - r->start;
+
+		base += r->len;
+	}
+
+	return -1;
+}
+
+static bool rtl8366_smi_cache_get(struct rtl8366_smi *smi, u32 addr,
+				  u32 *data)
+{
+	unsigned long flags;
+	bool hit = false;
+	int idx;
+
+	idx = rtl8366_smi_cache_index(smi, addr);
+	if (idx < 0)
+		return false;
+
+	spin_lock_irqsave(&smi->lock, flags);
+	if (test_bit(idx, smi->cache_valid)) {
+		*data = smi->cache[idx];
+		rtl8366_smi_stat_hit(smi);
+		hit = true;
+	}
+	spin_unlock_irqrestore(&smi->lock, flags);
+
+	return hit;
+}
+
+static void rtl8366_smi_cache_set(struct rtl8366_smi *smi, u32 addr,
+				  u32 data, bool valid)
+{
+	unsigned long flags;
+	int idx;
+
+	idx = rtl8366_smi_cache_index(smi, addr);
+	if (idx < 0)
+		return;
+
+	spin_lock_irqsave(&smi->lock, flags);
+	if (valid) {
+		smi->cache[idx] = data;
+		set_bit(idx, smi->cache_valid);
+	} else {
+		clear_bit(idx, smi->cache_valid);
+	}
+	spin_unlock_irqrestore(&smi->lock, flags);
+}
+
+static void rtl8366_smi_cache_invalidate(struct rtl8366_smi *smi)
+{
+	unsigned long flags;
+	unsigned int size = 0;
+	unsigned int i;
+
+	if (!smi->cache)
+		return;
+
+	for (i = 0; i < smi->num_cache_ranges; i++)
+		size += smi->cache_ranges[i].len;
+
+	spin_lock_irqsave(&smi->lock, flags);
+	bitmap_zero(smi->cache_valid, size);
+	spin_unlock_irqrestore(&smi->lock, flags);
+}
+
+static int rtl8366_smi_cache_init(struct rtl8366_smi *smi)
+{
+	unsigned int size = 0;
+	unsigned int i;
+
+	for (i = 0; i < smi->num_cache_ranges; i++)
+		size += smi->cache_ranges[i].len;
+
+	if (!size)
+		return 0;
+
+	smi->cache = kcalloc(size, sizeof(*smi->cache), GFP_KERNEL);
+	if (!smi->cache)
+		return -ENOMEM;
+
+	smi->cache_valid = bitmap_zalloc(size, GFP_KERNEL);
+	if (!smi->cache_valid) {
+		kfree(smi->cache);
+		smi->cache = NULL;
+		return -ENOMEM;
+	}
+
 	return 0;
 }
 
+static void rtl8366_smi_cache_cleanup(struct rtl8366_smi *smi)
+{
+	bitmap_free(smi->cache_valid);
+	kfree(smi->cache);
+	smi->cache_valid = NULL;
+	smi->cache = NULL;
+}
+
 int rtl8366_smi_read_reg(struct rtl8366_smi *smi, u32 addr, u32 *data)
 {
+	int err;
+
+	if (rtl8366_smi_cache_get(smi, addr, data))
+		return 0;
+
 	if (smi->ext_mbus)
-		return __rtl8366_mdio_read_reg(smi, addr, data);
+		err = __rtl8366_mdio_read_reg(smi, addr, data);
 	else
-		return __rtl8366_smi_read_reg(smi, addr, data);
+		err = __rtl8366_smi_read_reg(smi, addr, data);
+
+	if (!err)
+		rtl8366_smi_cache_set(smi, addr, *data, true);
+
+	return err;
 }
 EXPORT_SYMBOL_GPL(rtl8366_smi_read_reg);
 
-static int __rtl8366_smi_write_reg(struct rtl8366_smi *smi,
-				   u32 addr, u32 data, bool ack)
+/* called with smi->lock held */
+static int rtl8366_smi_do_write(struct rtl8366_smi *smi,
+				u32 addr, u32 data, bool ack)
 {
-	unsigned long flags;
 	int ret;
 
-	spin_lock_irqsave(&smi->lock, flags);
-
 	rtl8366_smi_start(smi);
 
 	/* send WRITE command */
@@ -379,23 +600,64 @@ static int __rtl8366_smi_write_reg(struct rtl8366_smi *smi,
 
  out:
 	rtl8366_smi_stop(smi);
+
+	return ret;
+}
+
+/* see rtl8366_smi_bus_read() */
+static int rtl8366_smi_bus_write(struct rtl8366_smi *smi,
+				 u32 addr, u32 data, bool ack)
+{
+	unsigned long flags;
+	u64 start;
+	int ret;
+
+	spin_lock_irqsave(&smi->lock, flags);
+	start = rtl8366_smi_stat_start();
+	ret = rtl8366_smi_do_write(smi, addr, data, ack);
+	rtl8366_smi_stat_end(smi, start, 1);
 	spin_unlock_irqrestore(&smi->lock, flags);
 
 	return ret;
 }
 
+static int __rtl8366_smi_write_reg(struct rtl8366_smi *smi,
+				   u32 addr, u32 data, bool ack)
+{
+	int ret;
+
+	mutex_lock(&smi->bus_lock);
+	ret = rtl8366_smi_bus_write(smi, addr, data, ack);
+	mutex_unlock(&smi->bus_lock);
+
+	return ret;
+}
+
 int rtl8366_smi_write_reg(struct rtl8366_smi *smi, u32 addr, u32 data)
 {
+	int err;
+
 	if (smi->ext_mbus)
-		return __rtl8366_mdio_write_reg(smi, addr, data);
+		err = __rtl8366_mdio_write_reg(smi, addr, data);
 	else
-		return __rtl8366_smi_write_reg(smi, addr, data, true);
+		err = __rtl8366_smi_write_reg(smi, addr, data, true);
+
+	/* on error we do not know what the chip latched, drop the entry */
+	rtl8366_smi_cache_set(smi, addr, data, !err);
+
+	return err;
 }
 EXPORT_SYMBOL_GPL(rtl8366_smi_write_reg);
 
+/* only used to issue a chip reset, which clears every cached register */
 int rtl8366_smi_write_reg_noack(struct rtl8366_smi *smi, u32 addr, u32 data)
 {
-	return __rtl8366_smi_write_reg(smi, addr, data, false);
+	int err;
+
+	err = __rtl8366_smi_write_reg(smi, addr, data, false);
+	rtl8366_smi_cache_invalidate(smi);
+
+	return err;
 }
 EXPORT_SYMBOL_GPL(rtl8366_smi_write_reg_noack);
 
@@ -414,8 +676,103 @@ int rtl8366_smi_rmwr(struct rtl8366_smi *smi, u32 addr, u32 mask, u32 data)
 }
 EXPORT_SYMBOL_GPL(rtl8366_smi_rmwr);
 
+static int rtl8366_mdio_xfer(struct rtl8366_smi *smi,
+			     struct rtl8366_smi_xfer *xfer, unsigned int num)
+{
+	struct mii_bus *mbus = smi->ext_mbus;
+	unsigned int xfers = 0;
+	unsigned int i;
+	int err = 0;
+
+	BUG_ON(in_interrupt());
+
+	mutex_lock(&mbus->mdio_lock);
+	for (i = 0; i < num && !err; i++) {
+		switch (xfer[i].op) {
+		case RTL8366_SMI_XFER_READ:
+			if (rtl8366_smi_cache_get(smi, xfer[i].addr,
+						  &xfer[i].data))
+				continue;
+
+			err = rtl8366_mdio_do_read(smi, xfer[i].addr,
+						   &xfer[i].data);
+			if (!err)
+				rtl8366_smi_cache_set(smi, xfer[i].addr,
+						      xfer[i].data, true);
+			break;
+		case RTL8366_SMI_XFER_WRITE:
+			err = rtl8366_mdio_do_write(smi, xfer[i].addr,
+						    xfer[i].data);
+			rtl8366_smi_cache_set(smi, xfer[i].addr,
+					      xfer[i].data, !err);
+			break;
+		default:
+			err = -EINVAL;
+			continue;
+		}
+
+		xfers++;
+	}
+	mutex_unlock(&mbus->mdio_lock);
+	rtl8366_smi_stat_count(smi, xfers);
+
+	return err;
+}
+
+/*
+ * Run a list of register accesses while holding the bus for the whole
+ * list, so that no other access can sneak in between e.g. selecting a
+ * table entry and reading it back.  The bus lock is a mutex; with the
+ * GPIO bus every transaction still gets its own short IRQ-off window,
+ * so interrupts are re-enabled between them however long the list is.
+ * Cached registers are served without touching the bus.  Reads store
+ * their result in xfer->data.  Processing stops at the first failing
+ * access.
+ */
+int rtl8366_smi_xfer(struct rtl8366_smi *smi, struct rtl8366_smi_xfer *xfer,
+		     unsigned int num)
+{
+	unsigned int i;
+	int err = 0;
+
+	if (smi->ext_mbus)
+		return rtl8366_mdio_xfer(smi, xfer, num);
+
+	mutex_lock(&smi->bus_lock);
+	for (i = 0; i < num && !err; i++) {
+		switch (xfer[i].op) {
+		case RTL8366_SMI_XFER_READ:
+			if (rtl8366_smi_cache_get(smi, xfer[i].addr,
+						  &xfer[i].data))
+				break;
+
+			err = rtl8366_smi_bus_read(smi, xfer[i].addr,
+						   &xfer[i].data);
+			if (!err)
+				rtl8366_smi_cache_set(smi, xfer[i].addr,
+						      xfer[i].data, true);
+			break;
+		case RTL8366_SMI_XFER_WRITE:
+			err = rtl8366_smi_bus_write(smi, xfer[i].addr,
+						    xfer[i].data, true);
+			rtl8366_smi_cache_set(smi, xfer[i].addr,
+					      xfer[i].data, !err);
+			break;
+		default:
+			err = -EINVAL;
+			break;
+		}
+	}
+	mutex_unlock(&smi->bus_lock);
+
+	return err;
+}
+EXPORT_SYMBOL_GPL(rtl8366_smi_xfer);
+
 static int rtl8366_reset(struct rtl8366_smi *smi)
 {
+	rtl8366_smi_cache_invalidate(smi);
+
 	if (smi->hw_reset) {
 		smi->hw_reset(smi, true);
 		msleep(RTL8366_SMI_HW_STOP_DELAY);
@@ -895,6 +1252,35 @@ static ssize_t rtl8366_read_debugfs_mibs(struct file *file,
 	return simple_read_from_buffer(user_buf, count, ppos, buf, len);
 }
 
+static ssize_t rtl8366_read_debugfs_stats(struct file *file,
+					  char __user *user_buf,
+					  size_t count, loff_t *ppos)
+{
+	struct rtl8366_smi *smi = file->private_data;
+	char *buf = smi->buf;
+	unsigned long flags;
+	u64 xfers, hits, irqoff_ns, irqoff_max_ns;
+	int len = 0;
+
+	spin_lock_irqsave(&smi->lock, flags);
+	xfers = smi->stat_xfers;
+	hits = smi->stat_cache_hits;
+	irqoff_ns = smi->stat_irqoff_ns;
+	irqoff_max_ns = smi->stat_irqoff_max_ns;
+	spin_unlock_irqrestore(&smi->lock, flags);
+
+	len += snprintf(buf + len, sizeof(smi->buf) - len,
+			"bus transfers:   %llu\n", xfers);
+	len += snprintf(buf + len, sizeof(smi->buf) - len,
+			"cache hits:      %llu\n", hits);
+	len += snprintf(buf + len, sizeof(smi->buf) - len,
+			"irq off time:    %llu ns\n", irqoff_ns);
+	len += snprintf(buf + len, sizeof(smi->buf) - len,
+			"longest irq off: %llu ns\n", irqoff_max_ns);
+
+	return simple_read_from_buffer(user_buf, count, ppos, buf, len);
+}
+
 static const struct file_operations fops_rtl8366_regs = {
 	.read	= rtl8366_read_debugfs_reg,
 	.write	= rtl8366_write_debugfs_reg,
@@ -926,6 +1312,12 @@ static const struct file_operations fops_rtl8366_mibs = {
 	.owner = THIS_MODULE
 };
 
+static const struct file_operations fops_rtl8366_stats = {
+	.read	= rtl8366_read_debugfs_stats,
+	.open	= rtl8366_debugfs_open,
+	.owner	= THIS_MODULE
+};
+
 static void rtl8366_debugfs_init(struct rtl8366_smi *smi)
 {
 	struct dentry *node;
@@ -991,9 +1383,17 @@ static void rtl8366_debugfs_init(struct rtl8366_smi *smi)
 
 	node = debugfs_create_file("mibs", S_IRUSR, smi->debugfs_root, smi,
 				   &fops_rtl8366_mibs);
-	if (!node)
+	if (!node) {
 		dev_err(smi->parent, "Creating debugfs file '%s' failed\n",
 			"mibs");
+		return;
+	}
+
+	node = debugfs_create_file("stats", S_IRUSR, root, smi,
+				   &fops_rtl8366_stats);
+	if (!node)
+		dev_err(smi->parent, "Creating debugfs file '%s' failed\n",
+			"stats");
 }
 
 static void rtl8366_debugfs_remove(struct rtl8366_smi *smi)
@@ -1386,6 +1786,7 @@ static int __rtl8366_smi_init(struct rtl8366_smi *smi, const char *name)
 	}
 
 	spin_lock_init(&smi->lock);
+	mutex_init(&smi->bus_lock);
 
 	/* start the switch */
 	if (smi->hw_reset) {
@@ -1458,10 +1859,14 @@ int rtl8366_smi_init(struct rtl8366_smi *smi)
 	if (!smi->ops)
 		return -EINVAL;
 
-	err = __rtl8366_smi_init(smi, dev_name(smi->parent));
+	err = rtl8366_smi_cache_init(smi);
 	if (err)
 		goto err_out;
 
+	err = __rtl8366_smi_init(smi, dev_name(smi->parent));
+	if (err)
+		goto err_free_cache;
+
 	if (!smi->ext_mbus)
 		dev_info(smi->parent, "using GPIO pins %u (SDA) and %u (SCK)\n",
 			 smi->gpio_sda, smi->gpio_sck);
@@ -1505,6 +1910,8 @@ int rtl8366_smi_init(struct rtl8366_smi *smi)
 
  err_free_sck:
 	__rtl8366_smi_cleanup(smi);
+ err_free_cache:
+	rtl8366_smi_cache_cleanup(smi);
  err_out:
 	return err;
 }
@@ -1515,6 +1922,7 @@ void rtl8366_smi_cleanup(struct rtl8366_smi *smi)
 	rtl8366_debugfs_remove(smi);
 	rtl8366_smi_mii_cleanup(smi);
 	__rtl8366_smi_cleanup(smi);
+	rtl8366_smi_cache_cleanup(smi);
 }
 EXPORT_SYMBOL_GPL(rtl8366_smi_cleanup);
 
@@ -11,6 +11,7 @@
 #ifndef _RTL8366_SMI_H
 #define _RTL8366_SMI_H
 
+#include <linux/mutex.h>
 #include <linux/phy.h>
 #include <linux/switch.h>
 #include <linux/platform_device.h>
@@ -30,6 +31,25 @@ struct rtl8366_mib_counter {
 	const char	*name;
 };
 
+/*
+ * A block of registers which only change when written by the driver
+ * (VLAN tables, port VLAN control, LED setup, ...) and can therefore
+ * be served from the register cache.
+ */
+struct rtl8366_reg_range {
+	u16		start;
+	u16		len;
+};
+
+#define RTL8366_SMI_XFER_READ	0
+#define RTL8366_SMI_XFER_WRITE	1
+
+struct rtl8366_smi_xfer {
+	u32		addr;
+	u32		data;
+	u8		op;
+};
+
 struct rtl8366_smi {
 	struct device		*parent;
 	unsigned int		gpio_sda;
@@ -39,6 +59,7 @@ struct rtl8366_smi {
 	u8			cmd_read;
 	u8			cmd_write;
 	spinlock_t		lock;
+	struct mutex		bus_lock;	/* serializes transfer lists */
 	struct mii_bus		*mii_bus;
 	int			mii_irq[PHY_MAX_ADDR];
 	struct switch_dev	sw_dev;
@@ -56,12 +77,21 @@ struct rtl8366_smi {
 
 	char			buf[4096];
 
+	const struct rtl8366_reg_range *cache_ranges;
+	unsigned int		num_cache_ranges;
+	u16			*cache;
+	unsigned long		*cache_valid;
+
 	struct reset_control	*reset;
 
 #ifdef CONFIG_RTL8366_SMI_DEBUG_FS
 	struct dentry           *debugfs_root;
 	u16			dbg_reg;
 	u8			dbg_vlan_4k_page;
+	u64			stat_xfers;
+	u64			stat_cache_hits;
+	u64			stat_irqoff_ns;
+	u64			stat_irqoff_max_ns;
 #endif
 	u32			phy_id;
 	struct mii_bus		*ext_mbus;
@@ -115,6 +145,8 @@ int rtl8366_smi_write_reg(struct rtl8366_smi *smi, u32 addr, u32 data);
 int rtl8366_smi_write_reg_noack(struct rtl8366_smi *smi, u32 addr, u32 data);
 int rtl8366_smi_read_reg(struct rtl8366_smi *smi, u32 addr, u32 *data);
 int rtl8366_smi_rmwr(struct rtl8366_smi *smi, u32 addr, u32 mask, u32 data);
+int rtl8366_smi_xfer(struct rtl8366_smi *smi, struct rtl8366_smi_xfer *xfer,
+		     unsigned int num);
 
 #ifdef CONFIG_RTL8366_SMI_DEBUG_FS
 int rtl8366_debugfs_open(struct inode *inode, struct file *file);
@@ -244,6 +244,14 @@ static struct rtl8366_mib_counter rtl8366rb_mib_counters[] = {
 	{ 0, 70, 2, "IfOutBroadcastPkts"			},
 };
 
+/* registers which are only ever changed by the driver */
+static const struct rtl8366_reg_range rtl8366rb_cache_ranges[] = {
+	{ RTL8366RB_SGCR,		 2 },	/* SGCR, PECR */
+	{ RTL8366RB_VLAN_MC_BASE(0),	 RTL8366RB_NUM_VLANS * 3 },
+	{ RTL8366RB_PORT_VLAN_CTRL_BASE, 2 },
+	{ RTL8366RB_LED_BLINKRATE_REG,	 4 },
+};
+
 #define REG_WR(_smi, _reg, _val)					\
 	do {								\
 		err = rtl8366_smi_write_reg(_smi, _reg, _val);		\
@@ -450,40 +458,33 @@ static int rtl8366rb_get_mib_counter(struct rtl8366_smi *smi, int counter,
 static int rtl8366rb_get_vlan_4k(struct rtl8366_smi *smi, u32 vid,
 				 struct rtl8366_vlan_4k *vlan4k)
 {
-	u32 data[3];
+	struct rtl8366_smi_xfer xfer[] = {
+		/* write VID */
+		{ RTL8366RB_VLAN_TABLE_WRITE_BASE,
+		  vid & RTL8366RB_VLAN_VID_MASK, RTL8366_SMI_XFER_WRITE },
+		/* write table access control word */
+		{ RTL8366RB_TABLE_ACCESS_CTRL_REG,
+		  RTL8366RB_TABLE_VLAN_READ_CTRL, RTL8366_SMI_XFER_WRITE },
+		{ RTL8366RB_VLAN_TABLE_READ_BASE + 0, 0, RTL8366_SMI_XFER_READ },
+		{ RTL8366RB_VLAN_TABLE_READ_BASE + 1, 0, RTL8366_SMI_XFER_READ },
+		{ RTL8366RB_VLAN_TABLE_READ_BASE + 2, 0, RTL8366_SMI_XFER_READ },
+	};
 	int err;
-	int i;
 
 	memset(vlan4k, '\0', sizeof(struct rtl8366_vlan_4k));
 
 	if (vid >= RTL8366RB_NUM_VIDS)
 		return -EINVAL;
 
-	/* write VID */
-	err = rtl8366_smi_write_reg(smi, RTL8366RB_VLAN_TABLE_WRITE_BASE,
-				    vid & RTL8366RB_VLAN_VID_MASK);
+	err = rtl8366_smi_xfer(smi, xfer, ARRAY_SIZE(xfer));
 	if (err)
 		return err;
 
-	/* write table access control word */
-	err = rtl8366_smi_write_reg(smi, RTL8366RB_TABLE_ACCESS_CTRL_REG,
-				    RTL8366RB_TABLE_VLAN_READ_CTRL);
-	if (err)
-		return err;
-
-	for (i = 0; i < 3; i++) {
-		err = rtl8366_smi_read_reg(smi,
-					   RTL8366RB_VLAN_TABLE_READ_BASE + i,
-					   &data[i]);
-		if (err)
-			return err;
-	}
-
 	vlan4k->vid = vid;
-	vlan4k->untag = (data[1] >> RTL8366RB_VLAN_UNTAG_SHIFT) &
+	vlan4k->untag = (xfer[3].data >> RTL8366RB_VLAN_UNTAG_SHIFT) &
 			RTL8366RB_VLAN_UNTAG_MASK;
-	vlan4k->member = data[1] & RTL8366RB_VLAN_MEMBER_MASK;
-	vlan4k->fid = data[2] & RTL8366RB_VLAN_FID_MASK;
+	vlan4k->member = xfer[3].data & RTL8366RB_VLAN_MEMBER_MASK;
+	vlan4k->fid = xfer[4].data & RTL8366RB_VLAN_FID_MASK;
 
 	return 0;
 }
@@ -491,8 +492,8 @@ static int rtl8366rb_get_vlan_4k(struct rtl8366_smi *smi, u32 vid,
 static int rtl8366rb_set_vlan_4k(struct rtl8366_smi *smi,
 				 const struct rtl8366_vlan_4k *vlan4k)
 {
+	struct rtl8366_smi_xfer xfer[4];
 	u32 data[3];
-	int err;
 	int i;
 
 	if (vlan4k->vid >= RTL8366RB_NUM_VIDS ||
@@ -508,18 +509,17 @@ static int rtl8366rb_set_vlan_4k(struct rtl8366_smi *smi,
 	data[2] = vlan4k->fid & RTL8366RB_VLAN_FID_MASK;
 
 	for (i = 0; i < 3; i++) {
-		err = rtl8366_smi_write_reg(smi,
-					    RTL8366RB_VLAN_TABLE_WRITE_BASE + i,
-					    data[i]);
-		if (err)
-			return err;
+		xfer[i].addr = RTL8366RB_VLAN_TABLE_WRITE_BASE + i;
+		xfer[i].data = data[i];
+		xfer[i].op = RTL8366_SMI_XFER_WRITE;
 	}
 
 	/* write table access control word */
-	err = rtl8366_smi_write_reg(smi, RTL8366RB_TABLE_ACCESS_CTRL_REG,
-				    RTL8366RB_TABLE_VLAN_WRITE_CTRL);
+	xfer[3].addr = RTL8366RB_TABLE_ACCESS_CTRL_REG;
+	xfer[3].data = RTL8366RB_TABLE_VLAN_WRITE_CTRL;
+	xfer[3].op = RTL8366_SMI_XFER_WRITE;
 
-	return err;
+	return rtl8366_smi_xfer(smi, xfer, ARRAY_SIZE(xfer));
 }
 
 static int rtl8366rb_get_vlan_mc(struct rtl8366_smi *smi, u32 index,
@@ -1457,6 +1457,8 @@ static int rtl8366rb_probe(struct platform_device *pdev)
 	smi->num_vlan_mc = RTL8366RB_NUM_VLANS;
 	smi->mib_counters = rtl8366rb_mib_counters;
 	smi->num_mib_counters = ARRAY_SIZE(rtl8366rb_mib_counters);
+	smi->cache_ranges = rtl8366rb_cache_ranges;
+	smi->num_cache_ranges = ARRAY_SIZE(rtl8366rb_cache_ranges);
 
 	err = rtl8366_smi_init(smi);
 	if (err)
@@ -225,6 +225,14 @@ static struct rtl8366_mib_counter rtl8366s_mib_counters[] = {
 	{ 1,  6, 2, "IfOutBroadcastPkts"			},
 };
 
+/* registers which are only ever changed by the driver */
+static const struct rtl8366_reg_range rtl8366s_cache_ranges[] = {
+	{ RTL8366S_SGCR,		 2 },	/* SGCR, PECR */
+	{ RTL8366S_VLAN_MC_BASE(0),	 RTL8366S_NUM_VLANS * 2 },
+	{ RTL8366S_PORT_VLAN_CTRL_BASE, 2 },
+	{ RTL8366S_LED_BLINKRATE_REG,	 4 },
+};
+
 #define REG_WR(_smi, _reg, _val)					\
 	do {								\
 		err = rtl8366_smi_write_reg(_smi, _reg, _val);		\
@@ -1245,6 +1253,8 @@ static int rtl8366s_probe(struct platform_device *pdev)
 	smi->num_vlan_mc = RTL8366S_NUM_VLANS;
 	smi->mib_counters = rtl8366s_mib_counters;
 	smi->num_mib_counters = ARRAY_SIZE(rtl8366s_mib_counters);
+	smi->cache_ranges = rtl8366s_cache_ranges;
+	smi->num_cache_ranges = ARRAY_SIZE(rtl8366s_cache_ranges);
 
 	err = rtl8366_smi_init(smi);
 	if (err)
@@ -279,7 +279,11 @@ static const struct nla_policy switch_policy[SWITCH_ATTR_MAX+1] = {
 	[SWITCH_ATTR_OP_VALUE_INT] = { .type = NLA_U32 },
 	[SWITCH_ATTR_OP_VALUE_STR] = { .type = NLA_NUL_STRING },
 	[SWITCH_ATTR_OP_VALUE_PORTS] = { .type = NLA_NESTED },
+	[SWITCH_ATTR_OP_VALUE_LINK] = { .type = NLA_NESTED },
 	[SWITCH_ATTR_TYPE] = { .type = NLA_U32 },
+	[SWITCH_ATTR_OP] = { .type = NLA_NESTED },
+	[SWITCH_ATTR_OP_CMD] = { .type = NLA_U32 },
+	[SWITCH_ATTR_OP_INDEX] = { .type = NLA_U32 },
 };
 
 static const struct nla_policy port_policy[SWITCH_PORT_ATTR_MAX+1] = {
@@ -411,6 +415,7 @@ swconfig_send_multipart(struct swconfig_callback *cb, void *arg)
 error:
 	if (cb->msg)
 		nlmsg_free(cb->msg);
+	cb->msg = NULL;
 	return -1;
 }
 
@@ -494,10 +499,9 @@ out:
 }
 
 static const struct switch_attr *
-swconfig_lookup_attr(struct switch_dev *dev, struct genl_info *info,
+swconfig_lookup_attr(struct switch_dev *dev, int cmd, struct nlattr **attrs,
 		struct switch_val *val)
 {
-	struct genlmsghdr *hdr = nlmsg_data(info->nlhdr);
 	const struct switch_attrlist *alist;
 	const struct switch_attr *attr = NULL;
 	unsigned int attr_id;
@@ -507,10 +511,10 @@ swconfig_lookup_attr(struct switch_dev *dev, struct genl_info *info,
 	unsigned long *def_active;
 	int n_def;
 
-	if (!info->attrs[SWITCH_ATTR_OP_ID])
+	if (!attrs[SWITCH_ATTR_OP_ID])
 		goto done;
 
-	switch (hdr->cmd) {
+	switch (cmd) {
 	case SWITCH_CMD_SET_GLOBAL:
 	case SWITCH_CMD_GET_GLOBAL:
 		alist = &dev->ops->attr_global;
@@ -524,9 +528,9 @@ swconfig_lookup_attr(struct switch_dev *dev, struct genl_info *info,
 		def_list = default_vlan;
 		def_active = &dev->def_vlan;
 		n_def = ARRAY_SIZE(default_vlan);
-		if (!info->attrs[SWITCH_ATTR_OP_VLAN])
+		if (!attrs[SWITCH_ATTR_OP_VLAN])
 			goto done;
-		val->port_vlan = nla_get_u32(info->attrs[SWITCH_ATTR_OP_VLAN]);
+		val->port_vlan = nla_get_u32(attrs[SWITCH_ATTR_OP_VLAN]);
 		if (val->port_vlan >= dev->vlans)
 			goto done;
 		break;
@@ -536,9 +540,9 @@ swconfig_lookup_attr(struct switch_dev *dev, struct genl_info *info,
 		def_list = default_port;
 		def_active = &dev->def_port;
 		n_def = ARRAY_SIZE(default_port);
-		if (!info->attrs[SWITCH_ATTR_OP_PORT])
+		if (!attrs[SWITCH_ATTR_OP_PORT])
 			goto done;
-		val->port_vlan = nla_get_u32(info->attrs[SWITCH_ATTR_OP_PORT]);
+		val->port_vlan = nla_get_u32(attrs[SWITCH_ATTR_OP_PORT]);
 		if (val->port_vlan >= dev->ports)
 			goto done;
 		break;
@@ -550,7 +554,7 @@ swconfig_lookup_attr(struct switch_dev *dev, struct genl_info *info,
 	if (!alist)
 		goto done;
 
-	attr_id = nla_get_u32(info->attrs[SWITCH_ATTR_OP_ID]);
+	attr_id = nla_get_u32(attrs[SWITCH_ATTR_OP_ID]);
 	if (attr_id >= SWITCH_ATTR_DEFAULTS_OFFSET) {
 		attr_id -= SWITCH_ATTR_DEFAULTS_OFFSET;
 		if (attr_id >= n_def)
@@ -624,22 +628,18 @@ swconfig_parse_link(struct sk_buff *msg, struct nlattr *nla,
 }
 
 static int
-swconfig_set_attr(struct sk_buff *skb, struct genl_info *info)
+swconfig_do_set_attr(struct switch_dev *dev, int cmd, struct nlattr **attrs,
+		struct sk_buff *skb)
 {
 	const struct switch_attr *attr;
-	struct switch_dev *dev;
 	struct switch_val val;
 	int err = -EINVAL;
 
 	if (!capable(CAP_NET_ADMIN))
 		return -EPERM;
 
-	dev = swconfig_get_dev(info);
-	if (!dev)
-		return -EINVAL;
-
 	memset(&val, 0, sizeof(val));
-	attr = swconfig_lookup_attr(dev, info, &val);
+	attr = swconfig_lookup_attr(dev, cmd, attrs, &val);
 	if (!attr || !attr->set)
 		goto error;
 
@@ -648,16 +648,16 @@ swconfig_set_attr(struct sk_buff *skb, struct genl_info *info)
 	case SWITCH_TYPE_NOVAL:
 		break;
 	case SWITCH_TYPE_INT:
-		if (!info->attrs[SWITCH_ATTR_OP_VALUE_INT])
+		if (!attrs[SWITCH_ATTR_OP_VALUE_INT])
 			goto error;
 		val.value.i =
-			nla_get_u32(info->attrs[SWITCH_ATTR_OP_VALUE_INT]);
+			nla_get_u32(attrs[SWITCH_ATTR_OP_VALUE_INT]);
 		break;
 	case SWITCH_TYPE_STRING:
-		if (!info->attrs[SWITCH_ATTR_OP_VALUE_STR])
+		if (!attrs[SWITCH_ATTR_OP_VALUE_STR])
 			goto error;
 		val.value.s =
-			nla_data(info->attrs[SWITCH_ATTR_OP_VALUE_STR]);
+			nla_data(attrs[SWITCH_ATTR_OP_VALUE_STR]);
 		break;
 	case SWITCH_TYPE_PORTS:
 		val.value.ports = dev->portbuf;
@@ -665,9 +665,9 @@ swconfig_set_attr(struct sk_buff *skb, struct genl_info *info)
 			sizeof(struct switch_port) * dev->ports);
 
 		/* TODO: implement multipart? */
-		if (info->attrs[SWITCH_ATTR_OP_VALUE_PORTS]) {
+		if (attrs[SWITCH_ATTR_OP_VALUE_PORTS]) {
 			err = swconfig_parse_ports(skb,
-				info->attrs[SWITCH_ATTR_OP_VALUE_PORTS],
+				attrs[SWITCH_ATTR_OP_VALUE_PORTS],
 				&val, dev->ports);
 			if (err < 0)
 				goto error;
@@ -680,9 +680,9 @@ swconfig_set_attr(struct sk_buff *skb, struct genl_info *info)
 		val.value.link = &dev->linkbuf;
 		memset(&dev->linkbuf, 0, sizeof(struct switch_port_link));
 
-		if (info->attrs[SWITCH_ATTR_OP_VALUE_LINK]) {
+		if (attrs[SWITCH_ATTR_OP_VALUE_LINK]) {
 			err = swconfig_parse_link(skb,
-						  info->attrs[SWITCH_ATTR_OP_VALUE_LINK],
+						  attrs[SWITCH_ATTR_OP_VALUE_LINK],
 						  val.value.link);
 			if (err < 0)
 				goto error;
@@ -697,6 +697,21 @@ swconfig_set_attr(struct sk_buff *skb, struct genl_info *info)
 
 	err = attr->set(dev, attr, &val);
 error:
+	return err;
+}
+
+static int
+swconfig_set_attr(struct sk_buff *skb, struct genl_info *info)
+{
+	struct genlmsghdr *hdr = nlmsg_data(info->nlhdr);
+	struct switch_dev *dev;
+	int err;
+
+	dev = swconfig_get_dev(info);
+	if (!dev)
+		return -EINVAL;
+
+	err = swconfig_do_set_attr(dev, hdr->cmd, info->attrs, skb);
 	swconfig_put_dev(dev);
 	return err;
 }
@@ -821,6 +836,30 @@ nla_put_failure:
 	return -1;
 }
 
+/* port lists and link info are returned in the per device buffers */
+static int
+swconfig_do_get_attr(struct switch_dev *dev, int cmd, struct nlattr **attrs,
+		struct switch_val *val)
+{
+	const struct switch_attr *attr;
+
+	memset(val, 0, sizeof(*val));
+	attr = swconfig_lookup_attr(dev, cmd, attrs, val);
+	if (!attr || !attr->get)
+		return -EINVAL;
+
+	if (attr->type == SWITCH_TYPE_PORTS) {
+		val->value.ports = dev->portbuf;
+		memset(dev->portbuf, 0,
+			sizeof(struct switch_port) * dev->ports);
+	} else if (attr->type == SWITCH_TYPE_LINK) {
+		val->value.link = &dev->linkbuf;
+		memset(&dev->linkbuf, 0, sizeof(struct switch_port_link));
+	}
+
+	return attr->get(dev, attr, val);
+}
+
 static int
 swconfig_get_attr(struct sk_buff *skb, struct genl_info *info)
 {
@@ -836,24 +875,12 @@ swconfig_get_attr(struct sk_buff *skb, struct genl_info *info)
 	if (!dev)
 		return -EINVAL;
 
-	memset(&val, 0, sizeof(val));
-	attr = swconfig_lookup_attr(dev, info, &val);
-	if (!attr || !attr->get)
-		goto error;
-
-	if (attr->type == SWITCH_TYPE_PORTS) {
-		val.value.ports = dev->portbuf;
-		memset(dev->portbuf, 0,
-			sizeof(struct switch_port) * dev->ports);
-	} else if (attr->type == SWITCH_TYPE_LINK) {
-		val.value.link = &dev->linkbuf;
-		memset(&dev->linkbuf, 0, sizeof(struct switch_port_link));
-	}
-
-	err = attr->get(dev, attr, &val);
+	err = swconfig_do_get_attr(dev, cmd, info->attrs, &val);
 	if (err)
 		goto error;
 
+	attr = val.attr;
+
 	msg = nlmsg_new(NLMSG_GOODSIZE, GFP_KERNEL);
 	if (!msg)
 		goto error;
@@ -907,6 +934,181 @@ error:
 	return err;
 }
 
+static int
+swconfig_put_bulk_val(struct sk_buff *msg, const struct switch_attr *attr,
+		const struct switch_val *val)
+{
+	struct nlattr *n, *p;
+	int i;
+
+	switch (attr->type) {
+	case SWITCH_TYPE_INT:
+		return nla_put_u32(msg, SWITCH_ATTR_OP_VALUE_INT, val->value.i);
+	case SWITCH_TYPE_STRING:
+		return nla_put_string(msg, SWITCH_ATTR_OP_VALUE_STR, val->value.s);
+	case SWITCH_TYPE_PORTS:
+		n = nla_nest_start(msg, SWITCH_ATTR_OP_VALUE_PORTS);
+		if (!n)
+			return -EMSGSIZE;
+
+		for (i = 0; i < val->len; i++) {
+			const struct switch_port *port = &val->value.ports[i];
+
+			p = nla_nest_start(msg, SWITCH_ATTR_PORT);
+			if (!p)
+				return -EMSGSIZE;
+			if (nla_put_u32(msg, SWITCH_PORT_ID, port->id))
+				return -EMSGSIZE;
+			if ((port->flags & (1 << SWITCH_PORT_FLAG_TAGGED)) &&
+			    nla_put_flag(msg, SWITCH_PORT_FLAG_TAGGED))
+				return -EMSGSIZE;
+			nla_nest_end(msg, p);
+		}
+		nla_nest_end(msg, n);
+		return 0;
+	case SWITCH_TYPE_LINK:
+		return swconfig_send_link(msg, NULL, SWITCH_ATTR_OP_VALUE_LINK,
+					  val->value.link);
+	default:
+		return 0;
+	}
+}
+
+struct swconfig_bulk_result {
+	const struct switch_val *val;
+	u32 index;
+	int err;
+};
+
+static int
+swconfig_bulk_fill(struct swconfig_callback *cb, void *arg)
+{
+	const struct swconfig_bulk_result *res = arg;
+	struct genl_info *info = cb->info;
+	struct nlattr *op;
+
+	if (!cb->hdr) {
+		cb->hdr = genlmsg_put(cb->msg, info->snd_portid, info->snd_seq,
+				&switch_fam, NLM_F_MULTI, SWITCH_CMD_BULK);
+		if (!cb->hdr)
+			return -1;
+	}
+
+	op = nla_nest_start(cb->msg, SWITCH_ATTR_OP);
+	if (!op)
+		return -1;
+
+	if (nla_put_u32(cb->msg, SWITCH_ATTR_OP_INDEX, res->index))
+		goto nla_put_failure;
+	if (nla_put_u32(cb->msg, SWITCH_ATTR_OP_ERR, -res->err))
+		goto nla_put_failure;
+	if (!res->err && res->val &&
+	    swconfig_put_bulk_val(cb->msg, res->val->attr, res->val) < 0)
+		goto nla_put_failure;
+
+	nla_nest_end(cb->msg, op);
+	return 0;
+
+nla_put_failure:
+	nla_nest_cancel(cb->msg, op);
+	return -1;
+}
+
+static int
+swconfig_bulk_close(struct swconfig_callback *cb, void *arg)
+{
+	if (cb->hdr)
+		genlmsg_end(cb->msg, cb->hdr);
+	cb->hdr = NULL;
+	return 0;
+}
+
+/*
+ * Run a list of get/set operations with a single device lookup. Each
+ * SWITCH_ATTR_OP nest carries the attributes of the corresponding single
+ * command plus SWITCH_ATTR_OP_CMD and SWITCH_ATTR_OP_INDEX. Results are
+ * returned as SWITCH_ATTR_OP nests with the index, the error code and
+ * the value for successful get operations, spread across as many
+ * multipart messages as needed.
+ */
+static int
+swconfig_bulk(struct sk_buff *skb, struct genl_info *info)
+{
+	struct nlattr *tb[SWITCH_ATTR_MAX + 1];
+	struct swconfig_bulk_result res;
+	struct swconfig_callback cb;
+	struct switch_dev *dev;
+	struct switch_val val;
+	struct nlattr *nla;
+	int err = 0;
+	int rem;
+
+	dev = swconfig_get_dev(info);
+	if (!dev)
+		return -EINVAL;
+
+	memset(&cb, 0, sizeof(cb));
+	cb.info = info;
+	cb.fill = swconfig_bulk_fill;
+	cb.close = swconfig_bulk_close;
+
+	nla_for_each_attr(nla, genlmsg_data(info->genlhdr),
+			  genlmsg_len(info->genlhdr), rem) {
+		int cmd;
+
+		if (nla_type(nla) != SWITCH_ATTR_OP)
+			continue;
+
+		if (nla_parse_nested_deprecated(tb, SWITCH_ATTR_MAX, nla,
+				switch_policy, NULL) ||
+		    !tb[SWITCH_ATTR_OP_CMD] || !tb[SWITCH_ATTR_OP_INDEX]) {
+			err = -EINVAL;
+			goto error;
+		}
+
+		memset(&res, 0, sizeof(res));
+		res.index = nla_get_u32(tb[SWITCH_ATTR_OP_INDEX]);
+		cmd = nla_get_u32(tb[SWITCH_ATTR_OP_CMD]);
+
+		switch (cmd) {
+		case SWITCH_CMD_GET_GLOBAL:
+		case SWITCH_CMD_GET_PORT:
+		case SWITCH_CMD_GET_VLAN:
+			res.err = swconfig_do_get_attr(dev, cmd, tb, &val);
+			res.val = &val;
+			break;
+		case SWITCH_CMD_SET_GLOBAL:
+		case SWITCH_CMD_SET_PORT:
+		case SWITCH_CMD_SET_VLAN:
+			res.err = swconfig_do_set_attr(dev, cmd, tb, skb);
+			break;
+		default:
+			res.err = -EOPNOTSUPP;
+			break;
+		}
+
+		err = swconfig_send_multipart(&cb, &res);
+		if (err < 0) {
+			err = -ENOMEM;
+			goto error;
+		}
+	}
+
+	swconfig_put_dev(dev);
+
+	if (!cb.msg)
+		return 0;
+
+	swconfig_bulk_close(&cb, NULL);
+	return genlmsg_reply(cb.msg, info);
+
+error:
+	if (cb.msg)
+		nlmsg_free(cb.msg);
+	swconfig_put_dev(dev);
+	return err;
+}
+
 static int
 swconfig_send_switch(struct sk_buff *msg, u32 pid, u32 seq, int flags,
 		const struct switch_dev *dev)
@@ -1042,6 +1244,13 @@ static struct genl_ops swconfig_ops[] = {
 		.validate = GENL_DONT_VALIDATE_STRICT | GENL_DONT_VALIDATE_DUMP,
 		.dumpit = swconfig_dump_switches,
 		.done = swconfig_done,
+	},
+	{
+		.cmd = SWITCH_CMD_BULK,
+#if LINUX_VERSION_CODE <= KERNEL_VERSION(6,0,0)
+		.validate = GENL_DONT_VALIDATE_STRICT | GENL_DONT_VALIDATE_DUMP,
+#endif
+		.doit = swconfig_bulk,
 	}
 };
 
@@ -54,6 +54,11 @@ enum {
 	SWITCH_ATTR_OP_DESCRIPTION,
 	/* port lists */
 	SWITCH_ATTR_PORT,
+	/* bulk operations */
+	SWITCH_ATTR_OP,
+	SWITCH_ATTR_OP_CMD,
+	SWITCH_ATTR_OP_INDEX,
+	SWITCH_ATTR_OP_ERR,
 	SWITCH_ATTR_MAX
 };
 
@@ -78,7 +83,8 @@ enum {
 	SWITCH_CMD_SET_PORT,
 	SWITCH_CMD_LIST_VLAN,
 	SWITCH_CMD_GET_VLAN,
-	SWITCH_CMD_SET_VLAN
+	SWITCH_CMD_SET_VLAN,
+	SWITCH_CMD_BULK
 };
 
 /* data types */
@@ -15,6 +15,9 @@
 #include <linux/iopoll.h>
 #include <linux/kernel.h>
 #include <linux/module.h>
+#include <linux/interrupt.h>
+#include <linux/completion.h>
+#include <linux/dma-mapping.h>
 #include <linux/mtd/mtd.h>
 #include <linux/mtd/rawnand.h>
 #include <linux/mtd/partitions.h>
@@ -30,7 +33,9 @@
 #define   CNFG_AUTO_FMT_EN		BIT(9)
 #define   CNFG_HW_ECC_EN		BIT(8)
 #define   CNFG_BYTE_RW			BIT(6)
+#define   CNFG_DMA_BURST_EN		BIT(2)
 #define   CNFG_READ_MODE		BIT(1)
+#define   CNFG_AHB			BIT(0)
 
 #define NFI_PAGEFMT			0x004
 #define   PAGEFMT_FDM_ECC_S		12
@@ -75,6 +80,10 @@
 #define   ACCCON_RLT_DEF		15
 #define   ACCCON_RLT_MIN		3
 
+#define NFI_INTR_EN			0x010
+#define NFI_INTR_STA			0x014
+#define   INTR_AHB_DONE			BIT(6)
+
 #define NFI_CMD				0x020
 
 #define NFI_ADDRNOB			0x030
@@ -114,6 +123,8 @@
 #define   SEC_ADDR_S			0
 #define   SEC_ADDR_M			GENMASK(9, 0)
 
+#define NFI_STRADDR			0x080
+
 #define NFI_CSEL			0x090
 #define   CSEL_S			0
 #define   CSEL_M			GENMASK(1, 0)
@@ -220,6 +231,10 @@ struct mt7621_nfc {
 	void __iomem *ecc_regs;
 
 	u32 spare_per_sector;
+
+	int irq;
+	struct completion done;
+	u8 *dma_buf;
 };
 
 static const u16 mt7621_nfi_page_size[] = { SZ_512, SZ_2K, SZ_4K };
@@ -328,6 +343,19 @@ static void mt7621_ecc_decoder_op(struct mt7621_nfc *nfc, bool enable)
 	ecc_write16(nfc, ECC_DECCON, enable ? DEC_EN : 0);
 }
 
+static int mt7621_ecc_sector_errors(struct mt7621_nfc *nfc, u32 sect)
+{
+	u32 decnum, num_error_bits;
+
+	decnum = ecc_read32(nfc, ECC_DECENUM);
+	num_error_bits = (decnum >> (sect << ERRNUM_S)) & ERRNUM_M;
+
+	if (num_error_bits == ERRNUM_M)
+		return -1;
+
+	return num_error_bits;
+}
+
 static int mt7621_ecc_correct_check(struct mt7621_nfc *nfc, u8 *sector_buf,
 				   u8 *fdm_buf, u32 sect)
 {
@@ -392,6 +420,70 @@ static int mt7621_nfc_wait_write_completion(struct mt7621_nfc *nfc,
 	return ret;
 }
 
+static irqreturn_t mt7621_nfc_irq(int irq, void *id)
+{
+	struct mt7621_nfc *nfc = id;
+	u16 sta, ien;
+
+	sta = nfi_read16(nfc, NFI_INTR_STA);
+	ien = nfi_read16(nfc, NFI_INTR_EN);
+
+	if (!(sta & ien))
+		return IRQ_NONE;
+
+	nfi_write16(nfc, NFI_INTR_EN, ~sta & ien);
+	complete(&nfc->done);
+
+	return IRQ_HANDLED;
+}
+
+static inline bool mt7621_nfc_dma_capable(const void *buf)
+{
+	return virt_addr_valid(buf) &&
+	       IS_ALIGNED((uintptr_t)buf, dma_get_cache_alignment());
+}
+
+static void mt7621_nfc_dma_start(struct mt7621_nfc *nfc, dma_addr_t addr,
+				 u16 con)
+{
+	struct nand_chip *nand = &nfc->nand;
+
+	/* the interrupt status register is cleared on read */
+	nfi_read16(nfc, NFI_INTR_STA);
+	reinit_completion(&nfc->done);
+
+	nfi_write32(nfc, NFI_STRADDR, lower_32_bits(addr));
+	nfi_write16(nfc, NFI_INTR_EN, INTR_AHB_DONE);
+	nfi_write16(nfc, NFI_CON, con | (nand->ecc.steps << CON_NFI_SEC_S));
+	nfi_write16(nfc, NFI_STRDATA, STR_DATA);
+}
+
+static int mt7621_nfc_dma_wait(struct mt7621_nfc *nfc)
+{
+	struct device *dev = nfc->dev;
+	int ret = 0;
+	u16 val;
+
+	if (nfc->irq > 0) {
+		if (!wait_for_completion_timeout(&nfc->done,
+				usecs_to_jiffies(NFI_CORE_TIMEOUT)))
+			ret = -ETIMEDOUT;
+	} else {
+		ret = readw_poll_timeout(nfc->nfi_regs + NFI_INTR_STA, val,
+					 val & INTR_AHB_DONE, 10,
+					 NFI_CORE_TIMEOUT);
+	}
+
+	nfi_write16(nfc, NFI_INTR_EN, 0);
+
+	if (ret) {
+		dev_warn(dev, "NFI core DMA transfer timed out\n");
+		return -ETIMEDOUT;
+	}
+
+	return 0;
+}
+
 static void mt7621_nfc_hw_reset(struct mt7621_nfc *nfc)
 {
 	u32 val;
@@ -918,7 +1010,17 @@ static int mt7621_nfc_attach_chip(struct nand_chip *nand)
 	if (ret)
 		return ret;
 
-	return mt7621_nfc_set_page_format(nfc);
+	ret = mt7621_nfc_set_page_format(nfc);
+	if (ret)
+		return ret;
+
+	/* bounce buffer for page transfers the NFI cannot DMA into directly */
+	nfc->dma_buf = devm_kmalloc(nfc->dev, nand_to_mtd(nand)->writesize,
+				    GFP_KERNEL);
+	if (!nfc->dma_buf)
+		return -ENOMEM;
+
+	return 0;
 }
 
 static const struct nand_controller_ops mt7621_nfc_controller_ops = {
@@ -1001,8 +1103,12 @@ static void mt7621_nfc_read_sector_fdm(struct mt7621_nfc *nfc, u32 sect)
 		oobptr[i + 4] = (valm >> (i * 8)) & 0xff;
 }
 
-static int mt7621_nfc_read_page_hwecc(struct nand_chip *nand, uint8_t *buf,
-				      int oob_required, int page)
+/*
+ * The decoder only reports the error locations of the sector it decoded
+ * last, so pages with bitflips are read and corrected sector by sector.
+ */
+static int mt7621_nfc_read_page_hwecc_pio(struct nand_chip *nand, u8 *buf,
+					  int page)
 {
 	struct mt7621_nfc *nfc = nand_get_controller_data(nand);
 	struct mtd_info *mtd = nand_to_mtd(nand);
@@ -1062,6 +1168,83 @@ static int mt7621_nfc_read_page_hwecc(struct nand_chip *nand, uint8_t *buf,
 	return bitflips;
 }
 
+static int mt7621_nfc_read_page_hwecc(struct nand_chip *nand, uint8_t *buf,
+				      int oob_required, int page)
+{
+	struct mt7621_nfc *nfc = nand_get_controller_data(nand);
+	struct mtd_info *mtd = nand_to_mtd(nand);
+	bool bitflips = false;
+	dma_addr_t dma_addr;
+	int ret = 0;
+	u8 *dma_buf;
+	int rc, i;
+
+	/* fall back to the bounce buffer for unaligned or OOB-only reads */
+	if (buf && mt7621_nfc_dma_capable(buf))
+		dma_buf = buf;
+	else
+		dma_buf = nfc->dma_buf;
+
+	dma_addr = dma_map_single(nfc->dev, dma_buf, mtd->writesize,
+				  DMA_FROM_DEVICE);
+	if (dma_mapping_error(nfc->dev, dma_addr)) {
+		dev_err(nfc->dev, "Failed to map DMA buffer\n");
+		return -ENOMEM;
+	}
+
+	nand_read_page_op(nand, page, 0, NULL, 0);
+
+	nfi_write16(nfc, NFI_CNFG, (CNFG_OP_CUSTOM << CNFG_OP_MODE_S) |
+		    CNFG_READ_MODE | CNFG_AUTO_FMT_EN | CNFG_HW_ECC_EN |
+		    CNFG_DMA_BURST_EN | CNFG_AHB);
+
+	mt7621_ecc_decoder_op(nfc, true);
+
+	mt7621_nfc_dma_start(nfc, dma_addr, CON_NFI_BRD);
+
+	rc = mt7621_nfc_dma_wait(nfc);
+
+	dma_unmap_single(nfc->dev, dma_addr, mtd->writesize, DMA_FROM_DEVICE);
+
+	if (rc < 0) {
+		ret = rc;
+		goto out;
+	}
+
+	for (i = 0; i < nand->ecc.steps; i++) {
+		rc = mt7621_ecc_decoder_wait_done(nfc, i);
+
+		mt7621_nfc_read_sector_fdm(nfc, i);
+
+		if (rc < 0) {
+			ret = -EIO;
+			continue;
+		}
+
+		/* the DMA buffer holds the data as read from the flash */
+		if (mt7621_ecc_sector_errors(nfc, i))
+			bitflips = true;
+	}
+
+	if (!bitflips && buf && dma_buf != buf)
+		memcpy(buf, dma_buf, mtd->writesize);
+
+out:
+	mt7621_ecc_decoder_op(nfc, false);
+
+	nfi_write16(nfc, NFI_CON, 0);
+
+	if (ret < 0)
+		return ret;
+
+	if (bitflips) {
+		dev_dbg(nfc->dev, "ECC errors at page %d, re-reading\n", page);
+		return mt7621_nfc_read_page_hwecc_pio(nand, buf, page);
+	}
+
+	return 0;
+}
+
 static int mt7621_nfc_read_page_raw(struct nand_chip *nand, uint8_t *buf,
 				    int oob_required, int page)
 {
@@ -1135,6 +1318,9 @@ static int mt7621_nfc_write_page_hwecc(struct nand_chip *nand,
 {
 	struct mt7621_nfc *nfc = nand_get_controller_data(nand);
 	struct mtd_info *mtd = nand_to_mtd(nand);
+	dma_addr_t dma_addr;
+	u8 *dma_buf;
+	int ret;
 
 	if (mt7621_nfc_check_empty_page(nand, buf)) {
 		/*
@@ -1149,29 +1335,48 @@ static int mt7621_nfc_write_page_hwecc(struct nand_chip *nand,
 		return 0;
 	}
 
+	if (buf && mt7621_nfc_dma_capable(buf)) {
+		dma_buf = (u8 *)buf;
+	} else {
+		dma_buf = nfc->dma_buf;
+		if (buf)
+			memcpy(dma_buf, buf, mtd->writesize);
+		else
+			memset(dma_buf, 0xff, mtd->writesize);
+	}
+
+	dma_addr = dma_map_single(nfc->dev, dma_buf, mtd->writesize,
+				  DMA_TO_DEVICE);
+	if (dma_mapping_error(nfc->dev, dma_addr)) {
+		dev_err(nfc->dev, "Failed to map DMA buffer\n");
+		return -ENOMEM;
+	}
+
 	nand_prog_page_begin_op(nand, page, 0, NULL, 0);
 
 	nfi_write16(nfc, NFI_CNFG, (CNFG_OP_CUSTOM << CNFG_OP_MODE_S) |
-		   CNFG_AUTO_FMT_EN | CNFG_HW_ECC_EN);
+		   CNFG_AUTO_FMT_EN | CNFG_HW_ECC_EN | CNFG_DMA_BURST_EN |
+		   CNFG_AHB);
 
 	mt7621_ecc_encoder_op(nfc, true);
 
 	mt7621_nfc_write_fdm(nfc);
 
-	nfi_write16(nfc, NFI_CON,
-		    CON_NFI_BWR | (nand->ecc.steps << CON_NFI_SEC_S));
-
-	if (buf)
-		mt7621_nfc_write_data(nfc, buf, mtd->writesize);
-	else
-		mt7621_nfc_write_data_empty(nfc, mtd->writesize);
+	mt7621_nfc_dma_start(nfc, dma_addr, CON_NFI_BWR);
 
-	mt7621_nfc_wait_write_completion(nfc, nand);
+	ret = mt7621_nfc_dma_wait(nfc);
+	if (!ret)
+		ret = mt7621_nfc_wait_write_completion(nfc, nand);
 
 	mt7621_ecc_encoder_op(nfc, false);
 
 	nfi_write16(nfc, NFI_CON, 0);
 
+	dma_unmap_single(nfc->dev, dma_addr, mtd->writesize, DMA_TO_DEVICE);
+
+	if (ret)
+		return ret;
+
 	return nand_prog_page_end_op(nand);
 }
 
@@ -1286,6 +1491,13 @@ static int mt7621_nfc_probe(struct platform_device *pdev)
 	nand_controller_init(&nfc->controller);
 	nfc->controller.ops = &mt7621_nfc_controller_ops;
 	nfc->dev = dev;
+	init_completion(&nfc->done);
+
+	ret = dma_set_mask_and_coherent(dev, DMA_BIT_MASK(32));
+	if (ret) {
+		dev_err(dev, "Failed to set DMA mask\n");
+		return ret;
+	}
 
 	res = platform_get_resource_byname(pdev, IORESOURCE_MEM, "nfi");
 	nfc->nfi_base = res->start;
@@ -1314,6 +1526,25 @@ static int mt7621_nfc_probe(struct platform_device *pdev)
 		}
 	}
 
+	/*
+	 * None of the mt7621 device trees describe the NFI interrupt, so the
+	 * DMA completion is polled unless a board adds one to its nand node
+	 */
+	nfc->irq = platform_get_irq_optional(pdev, 0);
+	if (nfc->irq == -EPROBE_DEFER) {
+		ret = nfc->irq;
+		goto clk_disable;
+	}
+
+	if (nfc->irq > 0) {
+		ret = devm_request_irq(dev, nfc->irq, mt7621_nfc_irq, 0,
+				       MT7621_NFC_NAME, nfc);
+		if (ret) {
+			dev_err(dev, "Failed to request irq %d\n", nfc->irq);
+			goto clk_disable;
+		}
+	}
+
 	platform_set_drvdata(pdev, nfc);
 
 	ret = mt7621_nfc_init_chip(nfc);
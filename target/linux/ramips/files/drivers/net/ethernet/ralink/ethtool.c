@@ -20,6 +20,12 @@ FE_STAT_REG_DECLARE
 #undef _FE
 };
 
+static const char fe_irq_str[][ETH_GSTRING_LEN] = {
+#define _FE(x...)	# x,
+FE_IRQ_STAT_DECLARE
+#undef _FE
+};
+
 static int fe_get_link_ksettings(struct net_device *ndev,
 			   struct ethtool_link_ksettings *cmd)
 {
@@ -161,27 +167,92 @@ static void fe_get_ringparam(struct net_device *dev,
 	ring->tx_pending = priv->tx_ring.tx_ring_size;
 }
 
+static int fe_get_coalesce(struct net_device *dev,
+			   struct ethtool_coalesce *ec,
+			   struct kernel_ethtool_coalesce *kernel_coal,
+			   struct netlink_ext_ack *extack)
+{
+	struct fe_priv *priv = netdev_priv(dev);
+
+	if (!priv->soc->rx_dly_int || !priv->soc->tx_dly_int)
+		return -EOPNOTSUPP;
+
+	ec->rx_coalesce_usecs = priv->rx_coal_usecs;
+	ec->rx_max_coalesced_frames = priv->rx_coal_frames;
+	ec->tx_coalesce_usecs = priv->tx_coal_usecs;
+	ec->tx_max_coalesced_frames = priv->tx_coal_frames;
+	ec->use_adaptive_rx_coalesce = priv->rx_dim_enabled;
+
+	return 0;
+}
+
+static int fe_set_coalesce(struct net_device *dev,
+			   struct ethtool_coalesce *ec,
+			   struct kernel_ethtool_coalesce *kernel_coal,
+			   struct netlink_ext_ack *extack)
+{
+	struct fe_priv *priv = netdev_priv(dev);
+	u32 max_usecs = FE_DELAY_MAX_PTIME * FE_DELAY_TIME;
+	struct dim_cq_moder moder;
+
+	if (!priv->soc->rx_dly_int || !priv->soc->tx_dly_int)
+		return -EOPNOTSUPP;
+
+	if ((ec->rx_coalesce_usecs > max_usecs) ||
+	    (ec->tx_coalesce_usecs > max_usecs) ||
+	    (ec->rx_max_coalesced_frames > FE_DELAY_MAX_PINT) ||
+	    (ec->tx_max_coalesced_frames > FE_DELAY_MAX_PINT))
+		return -EINVAL;
+
+	if (ec->use_adaptive_rx_coalesce && !priv->rx_dim_enabled) {
+		/* start from the default profile, net_dim takes over */
+		moder = net_dim_get_def_rx_moderation(priv->rx_dim.mode);
+		priv->rx_coal_usecs = moder.usec;
+		priv->rx_coal_frames = moder.pkts;
+	} else if (!ec->use_adaptive_rx_coalesce) {
+		priv->rx_coal_usecs = ec->rx_coalesce_usecs;
+		priv->rx_coal_frames = ec->rx_max_coalesced_frames;
+	}
+	priv->rx_dim_enabled = ec->use_adaptive_rx_coalesce;
+	priv->tx_coal_usecs = ec->tx_coalesce_usecs;
+	priv->tx_coal_frames = ec->tx_max_coalesced_frames;
+
+	fe_update_coalesce(priv);
+
+	return 0;
+}
+
 static void fe_get_strings(struct net_device *dev, u32 stringset, u8 *data)
 {
+	struct fe_priv *priv = netdev_priv(dev);
+	int i;
+
 	switch (stringset) {
 	case ETH_SS_STATS:
-		ethtool_puts(&data, *fe_gdma_str);
+		if (priv->hw_stats)
+			for (i = 0; i < ARRAY_SIZE(fe_gdma_str); i++)
+				ethtool_puts(&data, fe_gdma_str[i]);
+		for (i = 0; i < ARRAY_SIZE(fe_irq_str); i++)
+			ethtool_puts(&data, fe_irq_str[i]);
 		break;
 	}
 }
 
 static int fe_get_sset_count(struct net_device *dev, int sset)
 {
+	struct fe_priv *priv = netdev_priv(dev);
+
 	switch (sset) {
 	case ETH_SS_STATS:
-		return ARRAY_SIZE(fe_gdma_str);
+		if (priv->hw_stats)
+			return ARRAY_SIZE(fe_gdma_str) + ARRAY_SIZE(fe_irq_str);
+		return ARRAY_SIZE(fe_irq_str);
 	default:
 		return -EOPNOTSUPP;
 	}
 }
 
-static void fe_get_ethtool_stats(struct net_device *dev,
-				 struct ethtool_stats *stats, u64 *data)
+static void fe_get_hw_stats(struct net_device *dev, u64 *data)
 {
 	struct fe_priv *priv = netdev_priv(dev);
 	struct fe_hw_stats *hwstats = priv->hw_stats;
@@ -207,7 +278,26 @@ static void fe_get_ethtool_stats(struct net_device *dev,
 	} while (u64_stats_fetch_retry(&hwstats->syncp, start));
 }
 
-static struct ethtool_ops fe_ethtool_ops = {
+static void fe_get_ethtool_stats(struct net_device *dev,
+				 struct ethtool_stats *stats, u64 *data)
+{
+	struct fe_priv *priv = netdev_priv(dev);
+	unsigned long *irq_src = (unsigned long *)&priv->irq_stats;
+	int i;
+
+	if (priv->hw_stats) {
+		fe_get_hw_stats(dev, data);
+		data += ARRAY_SIZE(fe_gdma_str);
+	}
+
+	for (i = 0; i < ARRAY_SIZE(fe_irq_str); i++)
+		*data++ = READ_ONCE(irq_src[i]);
+}
+
+static const struct ethtool_ops fe_ethtool_ops = {
+	.supported_coalesce_params = ETHTOOL_COALESCE_USECS |
+				     ETHTOOL_COALESCE_MAX_FRAMES |
+				     ETHTOOL_COALESCE_USE_ADAPTIVE_RX,
 	.get_link_ksettings	= fe_get_link_ksettings,
 	.set_link_ksettings	= fe_set_link_ksettings,
 	.get_drvinfo		= fe_get_drvinfo,
@@ -217,18 +307,14 @@ static struct ethtool_ops fe_ethtool_ops = {
 	.get_link		= fe_get_link,
 	.set_ringparam		= fe_set_ringparam,
 	.get_ringparam		= fe_get_ringparam,
+	.get_coalesce		= fe_get_coalesce,
+	.set_coalesce		= fe_set_coalesce,
+	.get_strings		= fe_get_strings,
+	.get_sset_count		= fe_get_sset_count,
+	.get_ethtool_stats	= fe_get_ethtool_stats,
 };
 
 void fe_set_ethtool_ops(struct net_device *netdev)
 {
-	struct fe_priv *priv = netdev_priv(netdev);
-	struct fe_soc_data *soc = priv->soc;
-
-	if (soc->reg_table[FE_REG_FE_COUNTER_BASE]) {
-		fe_ethtool_ops.get_strings = fe_get_strings;
-		fe_ethtool_ops.get_sset_count = fe_get_sset_count;
-		fe_ethtool_ops.get_ethtool_stats = fe_get_ethtool_stats;
-	}
-
 	netdev->ethtool_ops = &fe_ethtool_ops;
 }
@@ -0,0 +1,157 @@
+/*   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; version 2 of the License
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ */
+
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/in6.h>
+#include <asm/unaligned.h>
+
+#include "mtk_eth_soc.h"
+
+static const char *fe_foe_entry_state_str(int state)
+{
+	static const char * const state_str[] = {
+		[MTK_FOE_STATE_INVALID] = "INV",
+		[MTK_FOE_STATE_UNBIND] = "UNB",
+		[MTK_FOE_STATE_BIND] = "BND",
+		[MTK_FOE_STATE_FIN] = "FIN",
+	};
+
+	if (state >= ARRAY_SIZE(state_str) || !state_str[state])
+		return "UNK";
+
+	return state_str[state];
+}
+
+static const char *fe_foe_pkt_type_str(int type)
+{
+	static const char * const type_str[] = {
+		[MTK_PPE_PKT_TYPE_IPV4_HNAPT] = "IPv4 5T",
+		[MTK_PPE_PKT_TYPE_IPV4_ROUTE] = "IPv4 3T",
+		[MTK_PPE_PKT_TYPE_IPV4_DSLITE] = "DS-LITE",
+		[MTK_PPE_PKT_TYPE_IPV6_ROUTE_3T] = "IPv6 3T",
+		[MTK_PPE_PKT_TYPE_IPV6_ROUTE_5T] = "IPv6 5T",
+		[MTK_PPE_PKT_TYPE_IPV6_6RD] = "6RD",
+	};
+
+	if (type >= ARRAY_SIZE(type_str) || !type_str[type])
+		return "UNKNOWN";
+
+	return type_str[type];
+}
+
+static void fe_print_ipv4(struct seq_file *m, const char *prefix,
+			  struct mtk_foe_ipv4_tuple *t)
+{
+	seq_printf(m, " %s=%pI4h:%d->%pI4h:%d", prefix, &t->src_ip,
+		   t->src_port, &t->dest_ip, t->dest_port);
+}
+
+static void fe_print_ipv6(struct seq_file *m, struct mtk_foe_ipv6 *e)
+{
+	__be32 src[4], dest[4];
+	int i;
+
+	for (i = 0; i < 4; i++) {
+		src[i] = cpu_to_be32(e->src_ip[i]);
+		dest[i] = cpu_to_be32(e->dest_ip[i]);
+	}
+
+	seq_printf(m, " orig=[%pI6c]:%d->[%pI6c]:%d", src, e->src_port,
+		   dest, e->dest_port);
+}
+
+static int fe_ppe_debugfs_foe_show(struct seq_file *m, bool bind)
+{
+	struct fe_priv *priv = m->private;
+	int i;
+
+	for (i = 0; i < FE_PPE_ENTRIES; i++) {
+		struct mtk_foe_entry *entry = &priv->foe_table[i];
+		struct mtk_foe_mac_info *l2;
+		u8 h_source[ETH_ALEN], h_dest[ETH_ALEN];
+		int type, state;
+		u32 ib2;
+
+		state = FIELD_GET(MTK_FOE_IB1_STATE, entry->ib1);
+		if (!state)
+			continue;
+
+		if (bind && state != MTK_FOE_STATE_BIND)
+			continue;
+
+		type = mtk_foe_entry_type(entry);
+		seq_printf(m, "%05x %s %7s", i, fe_foe_entry_state_str(state),
+			   fe_foe_pkt_type_str(type));
+
+		switch (type) {
+		case MTK_PPE_PKT_TYPE_IPV4_HNAPT:
+			fe_print_ipv4(m, "orig", &entry->ipv4.orig);
+			fe_print_ipv4(m, "new", &entry->ipv4.new);
+			break;
+		case MTK_PPE_PKT_TYPE_IPV4_ROUTE:
+			fe_print_ipv4(m, "orig", &entry->ipv4.orig);
+			break;
+		case MTK_PPE_PKT_TYPE_IPV6_ROUTE_3T:
+		case MTK_PPE_PKT_TYPE_IPV6_ROUTE_5T:
+			fe_print_ipv6(m, &entry->ipv6);
+			break;
+		}
+
+		l2 = mtk_foe_entry_l2(entry);
+		ib2 = *mtk_foe_entry_ib2(entry);
+		put_unaligned_be32(l2->src_mac_hi, h_source);
+		put_unaligned_be16(l2->src_mac_lo, h_source + 4);
+		put_unaligned_be32(l2->dest_mac_hi, h_dest);
+		put_unaligned_be16(l2->dest_mac_lo, h_dest + 4);
+
+		seq_printf(m, " eth=%pM->%pM etype=%04x vlan=%d,%d pppoe=%04x"
+			   " ib1=%08x ib2=%08x port=%lu ac=%lu\n",
+			   h_source, h_dest, l2->etype, l2->vlan1, l2->vlan2,
+			   l2->pppoe_id, entry->ib1, ib2,
+			   FIELD_GET(MTK_FOE_IB2_DEST_PORT, ib2),
+			   FIELD_GET(MTK_FOE_IB2_PORT_AG, ib2));
+	}
+
+	return 0;
+}
+
+static int fe_ppe_debugfs_foe_all_show(struct seq_file *m, void *private)
+{
+	return fe_ppe_debugfs_foe_show(m, false);
+}
+DEFINE_SHOW_ATTRIBUTE(fe_ppe_debugfs_foe_all);
+
+static int fe_ppe_debugfs_foe_bind_show(struct seq_file *m, void *private)
+{
+	return fe_ppe_debugfs_foe_show(m, true);
+}
+DEFINE_SHOW_ATTRIBUTE(fe_ppe_debugfs_foe_bind);
+
+static int fe_ppe_debugfs_used_show(struct seq_file *m, void *private)
+{
+	seq_printf(m, "%lu/%d\n",
+		   FIELD_GET(FE_PPE_TB_USED_NUM, fe_r32(FE_PPE_TB_USED)),
+		   FE_PPE_ENTRIES);
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(fe_ppe_debugfs_used);
+
+void fe_ppe_debugfs_init(struct fe_priv *priv)
+{
+	priv->debugfs_dir = debugfs_create_dir("ralink_ppe", NULL);
+	debugfs_create_file("entries", 0400, priv->debugfs_dir, priv,
+			    &fe_ppe_debugfs_foe_all_fops);
+	debugfs_create_file("bind", 0400, priv->debugfs_dir, priv,
+			    &fe_ppe_debugfs_foe_bind_fops);
+	debugfs_create_file("used", 0400, priv->debugfs_dir, priv,
+			    &fe_ppe_debugfs_used_fops);
+}
@@ -136,20 +136,108 @@ static void fe_reset_fe(struct fe_priv *priv)
 	usleep_range(1000, 1200);
 }
 
-static inline void fe_int_disable(u32 mask)
+static inline void fe_int_disable(struct fe_priv *priv, u32 mask)
 {
+	unsigned long flags;
+
+	spin_lock_irqsave(&priv->irq_lock, flags);
 	fe_reg_w32(fe_reg_r32(FE_REG_FE_INT_ENABLE) & ~mask,
 		   FE_REG_FE_INT_ENABLE);
 	/* flush write */
 	fe_reg_r32(FE_REG_FE_INT_ENABLE);
+	spin_unlock_irqrestore(&priv->irq_lock, flags);
 }
 
-static inline void fe_int_enable(u32 mask)
+static inline void fe_int_enable(struct fe_priv *priv, u32 mask)
 {
+	unsigned long flags;
+
+	spin_lock_irqsave(&priv->irq_lock, flags);
 	fe_reg_w32(fe_reg_r32(FE_REG_FE_INT_ENABLE) | mask,
 		   FE_REG_FE_INT_ENABLE);
 	/* flush write */
 	fe_reg_r32(FE_REG_FE_INT_ENABLE);
+	spin_unlock_irqrestore(&priv->irq_lock, flags);
+}
+
+static inline u32 fe_rx_int_all(struct fe_priv *priv)
+{
+	return priv->soc->rx_int | priv->soc->rx_dly_int;
+}
+
+static inline u32 fe_tx_int_all(struct fe_priv *priv)
+{
+	return priv->soc->tx_int | priv->soc->tx_dly_int;
+}
+
+static u32 fe_dly_int_chan(u32 usecs, u32 frames)
+{
+	u32 ptime, pint;
+
+	ptime = clamp_t(u32, DIV_ROUND_UP(usecs, FE_DELAY_TIME), 1,
+			FE_DELAY_MAX_PTIME);
+	if (frames)
+		pint = min_t(u32, frames, FE_DELAY_MAX_PINT);
+	else
+		pint = FE_DELAY_MAX_PINT;
+
+	return ((FE_DELAY_EN_INT | pint) << 8) | ptime;
+}
+
+/* program the delay interrupt and select which of the done/delay status
+ * bits raise the rx and tx interrupts. a direction that is currently masked
+ * (napi is running) is left masked, napi unmasks the new bit on completion.
+ */
+void fe_update_coalesce(struct fe_priv *priv)
+{
+	struct fe_soc_data *soc = priv->soc;
+	unsigned long flags;
+	u32 dly = 0, enable, rx_mask, tx_mask;
+
+	rx_mask = soc->rx_int;
+	if (soc->rx_dly_int && (priv->rx_dim_enabled || priv->rx_coal_usecs ||
+				priv->rx_coal_frames > 1)) {
+		rx_mask = soc->rx_dly_int;
+		dly |= fe_dly_int_chan(priv->rx_coal_usecs,
+				       priv->rx_coal_frames);
+	}
+
+	tx_mask = soc->tx_int;
+	if (soc->tx_dly_int && (priv->tx_coal_usecs ||
+				priv->tx_coal_frames > 1)) {
+		tx_mask = soc->tx_dly_int;
+		dly |= fe_dly_int_chan(priv->tx_coal_usecs,
+				       priv->tx_coal_frames) << 16;
+	}
+
+	spin_lock_irqsave(&priv->irq_lock, flags);
+	fe_reg_w32(dly, FE_REG_DLY_INT_CFG);
+
+	enable = fe_reg_r32(FE_REG_FE_INT_ENABLE);
+	if (enable & priv->rx_int_mask)
+		enable = (enable & ~fe_rx_int_all(priv)) | rx_mask;
+	if (enable & priv->tx_int_mask)
+		enable = (enable & ~fe_tx_int_all(priv)) | tx_mask;
+	priv->rx_int_mask = rx_mask;
+	priv->tx_int_mask = tx_mask;
+	fe_reg_w32(enable, FE_REG_FE_INT_ENABLE);
+	/* flush write */
+	fe_reg_r32(FE_REG_FE_INT_ENABLE);
+	spin_unlock_irqrestore(&priv->irq_lock, flags);
+}
+
+static void fe_rx_dim_work(struct work_struct *work)
+{
+	struct dim *dim = container_of(work, struct dim, work);
+	struct fe_priv *priv = container_of(dim, struct fe_priv, rx_dim);
+	struct dim_cq_moder moder;
+
+	moder = net_dim_get_rx_moderation(dim->mode, dim->profile_ix);
+	priv->rx_coal_usecs = moder.usec;
+	priv->rx_coal_frames = moder.pkts;
+	fe_update_coalesce(priv);
+
+	dim->state = DIM_START_MEASURE;
 }
 
 static inline void fe_hw_set_macaddr(struct fe_priv *priv, const unsigned char *mac)
@@ -1017,35 +1105,27 @@ static int fe_poll_tx(struct fe_priv *priv, int budget, u32 tx_intr,
 	return done;
 }
 
-static int fe_poll(struct napi_struct *napi, int budget)
+static int fe_rx_poll(struct napi_struct *napi, int budget)
 {
 	struct fe_priv *priv = container_of(napi, struct fe_priv, rx_napi);
 	struct fe_hw_stats *hwstat = priv->hw_stats;
-	int tx_done, rx_done, tx_again;
-	u32 status, fe_status, status_reg, mask;
-	u32 tx_intr, rx_intr, status_intr;
+	struct net_device_stats *stats = &priv->netdev->stats;
+	u32 fe_status, status_reg, rx_intr, status_intr;
+	struct dim_sample dim_sample = {};
+	int rx_done;
 
-	status = fe_reg_r32(FE_REG_FE_INT_STATUS);
-	fe_status = status;
-	tx_intr = priv->soc->tx_int;
-	rx_intr = priv->soc->rx_int;
+	rx_intr = fe_rx_int_all(priv);
 	status_intr = priv->soc->status_int;
-	tx_done = 0;
-	rx_done = 0;
-	tx_again = 0;
 
 	if (fe_reg_table[FE_REG_FE_INT_STATUS2]) {
 		fe_status = fe_reg_r32(FE_REG_FE_INT_STATUS2);
 		status_reg = FE_REG_FE_INT_STATUS2;
 	} else {
+		fe_status = fe_reg_r32(FE_REG_FE_INT_STATUS);
 		status_reg = FE_REG_FE_INT_STATUS;
 	}
 
-	if (status & tx_intr)
-		tx_done = fe_poll_tx(priv, budget, tx_intr, &tx_again);
-
-	if (status & rx_intr)
-		rx_done = fe_poll_rx(napi, budget, priv, rx_intr);
+	rx_done = fe_poll_rx(napi, budget, priv, rx_intr);
 
 	if (unlikely(fe_status & status_intr)) {
 		if (hwstat && spin_trylock(&hwstat->stats_lock)) {
@@ -1055,31 +1135,58 @@ static int fe_poll(struct napi_struct *napi, int budget)
 		fe_reg_w32(status_intr, status_reg);
 	}
 
-	if (unlikely(netif_msg_intr(priv))) {
-		mask = fe_reg_r32(FE_REG_FE_INT_ENABLE);
-		netdev_info(priv->netdev,
-			    "done tx %d, rx %d, intr 0x%08x/0x%x\n",
-			    tx_done, rx_done, status, mask);
+	if (unlikely(netif_msg_intr(priv)))
+		netdev_info(priv->netdev, "done rx %d, intr 0x%08x/0x%x\n",
+			    rx_done, fe_reg_r32(FE_REG_FE_INT_STATUS),
+			    fe_reg_r32(FE_REG_FE_INT_ENABLE));
+
+	priv->irq_stats.rx_polls++;
+	if (rx_done == budget) {
+		priv->irq_stats.rx_polls_full++;
+		return budget;
 	}
 
-	if (!tx_again && (rx_done < budget)) {
-		status = fe_reg_r32(FE_REG_FE_INT_STATUS);
-		if (status & (tx_intr | rx_intr)) {
-			/* let napi poll again */
-			rx_done = budget;
-			goto poll_again;
-		}
+	/* let napi poll again */
+	if (fe_reg_r32(FE_REG_FE_INT_STATUS) & rx_intr)
+		return budget;
 
-		napi_complete_done(napi, rx_done);
-		fe_int_enable(tx_intr | rx_intr);
-	} else {
-		rx_done = budget;
+	if (napi_complete_done(napi, rx_done)) {
+		if (priv->rx_dim_enabled) {
+			dim_update_sample(priv->irq_stats.rx_irqs,
+					  stats->rx_packets, stats->rx_bytes,
+					  &dim_sample);
+			net_dim(&priv->rx_dim, dim_sample);
+		}
+		fe_int_enable(priv, priv->rx_int_mask);
 	}
 
-poll_again:
 	return rx_done;
 }
 
+static int fe_tx_poll(struct napi_struct *napi, int budget)
+{
+	struct fe_priv *priv = container_of(napi, struct fe_priv, tx_napi);
+	int tx_done, tx_again = 0;
+
+	tx_done = fe_poll_tx(priv, budget, fe_tx_int_all(priv), &tx_again);
+
+	if (unlikely(netif_msg_intr(priv)))
+		netdev_info(priv->netdev, "done tx %d, intr 0x%08x/0x%x\n",
+			    tx_done, fe_reg_r32(FE_REG_FE_INT_STATUS),
+			    fe_reg_r32(FE_REG_FE_INT_ENABLE));
+
+	priv->irq_stats.tx_polls++;
+	if (tx_again || tx_done == budget) {
+		priv->irq_stats.tx_polls_full++;
+		return budget;
+	}
+
+	if (napi_complete_done(napi, tx_done))
+		fe_int_enable(priv, priv->tx_int_mask);
+
+	return tx_done;
+}
+
 static void fe_tx_timeout(struct net_device *dev, unsigned int txqueue)
 {
 	struct fe_priv *priv = netdev_priv(dev);
@@ -1112,23 +1219,38 @@ static void fe_tx_timeout(struct net_device *dev, unsigned int txqueue)
 static irqreturn_t fe_handle_irq(int irq, void *dev)
 {
 	struct fe_priv *priv = netdev_priv(dev);
-	u32 status, int_mask;
+	u32 status, pending, int_mask;
 
 	status = fe_reg_r32(FE_REG_FE_INT_STATUS);
 
 	if (unlikely(!status))
 		return IRQ_NONE;
 
-	int_mask = (priv->soc->rx_int | priv->soc->tx_int);
-	if (likely(status & int_mask)) {
+	/* done bits latch even while only their delayed variant is enabled */
+	pending = status & (priv->rx_int_mask | priv->tx_int_mask);
+
+	if (pending & priv->rx_int_mask) {
+		priv->irq_stats.rx_irqs++;
 		if (likely(napi_schedule_prep(&priv->rx_napi))) {
-			fe_int_disable(int_mask);
+			fe_int_disable(priv, fe_rx_int_all(priv));
 			__napi_schedule(&priv->rx_napi);
 		}
-	} else {
-		fe_reg_w32(status, FE_REG_FE_INT_STATUS);
 	}
 
+	if (pending & priv->tx_int_mask) {
+		priv->irq_stats.tx_irqs++;
+		if (likely(napi_schedule_prep(&priv->tx_napi))) {
+			fe_int_disable(priv, fe_tx_int_all(priv));
+			__napi_schedule(&priv->tx_napi);
+		}
+	}
+
+	/* the counter status is left for fe_rx_poll() to pick up */
+	int_mask = fe_rx_int_all(priv) | fe_tx_int_all(priv) |
+		   priv->soc->status_int;
+	if (unlikely(status & ~int_mask))
+		fe_reg_w32(status & ~int_mask, FE_REG_FE_INT_STATUS);
+
 	return IRQ_HANDLED;
 }
 
@@ -1136,11 +1258,11 @@ static irqreturn_t fe_handle_irq(int irq, void *dev)
 static void fe_poll_controller(struct net_device *dev)
 {
 	struct fe_priv *priv = netdev_priv(dev);
-	u32 int_mask = priv->soc->tx_int | priv->soc->rx_int;
+	u32 int_mask = priv->rx_int_mask | priv->tx_int_mask;
 
-	fe_int_disable(int_mask);
+	fe_int_disable(priv, int_mask);
 	fe_handle_irq(dev->irq, dev);
-	fe_int_enable(int_mask);
+	fe_int_enable(priv, int_mask);
 }
 #endif
 
@@ -1221,10 +1343,10 @@ static int fe_hw_init(struct net_device *dev)
 	else
 		fe_hw_set_macaddr(priv, dev->dev_addr);
 
-	/* disable delay interrupt */
-	fe_reg_w32(0, FE_REG_DLY_INT_CFG);
+	fe_int_disable(priv, fe_rx_int_all(priv) | fe_tx_int_all(priv));
 
-	fe_int_disable(priv->soc->tx_int | priv->soc->rx_int);
+	/* program the delay interrupt, disabled unless coalescing is set */
+	fe_update_coalesce(priv);
 
 	/* frame engine will push VLAN tag regarding to VIDX feild in Tx desc */
 	if (fe_reg_table[FE_REG_FE_DMA_VID_BASE])
@@ -1273,8 +1395,11 @@ static int fe_open(struct net_device *dev)
 	if (priv->soc->has_carrier && priv->soc->has_carrier(priv))
 		netif_carrier_on(dev);
 
+	fe_ppe_start(priv);
+
 	napi_enable(&priv->rx_napi);
-	fe_int_enable(priv->soc->tx_int | priv->soc->rx_int);
+	napi_enable(&priv->tx_napi);
+	fe_int_enable(priv, priv->rx_int_mask | priv->tx_int_mask);
 	netif_start_queue(dev);
 
 	return 0;
@@ -1287,12 +1412,16 @@ static int fe_stop(struct net_device *dev)
 	int i;
 
 	netif_tx_disable(dev);
-	fe_int_disable(priv->soc->tx_int | priv->soc->rx_int);
+	fe_int_disable(priv, fe_rx_int_all(priv) | fe_tx_int_all(priv));
+	napi_disable(&priv->tx_napi);
 	napi_disable(&priv->rx_napi);
+	cancel_work_sync(&priv->rx_dim.work);
 
 	if (priv->phy)
 		priv->phy->stop(priv);
 
+	fe_ppe_stop(priv);
+
 	spin_lock_irqsave(&priv->page_lock, flags);
 
 	fe_reg_w32(fe_reg_r32(FE_REG_PDMA_GLO_CFG) &
@@ -1486,6 +1615,7 @@ static const struct net_device_ops fe_netdev_ops = {
 	.ndo_get_stats64        = fe_get_stats64,
 	.ndo_vlan_rx_add_vid	= fe_vlan_rx_add_vid,
 	.ndo_vlan_rx_kill_vid	= fe_vlan_rx_kill_vid,
+	.ndo_setup_tc		= fe_setup_tc,
 #ifdef CONFIG_NET_POLL_CONTROLLER
 	.ndo_poll_controller	= fe_poll_controller,
 #endif
@@ -1629,6 +1759,11 @@ static int fe_probe(struct platform_device *pdev)
 	priv->tx_ring.tx_ring_size = NUM_DMA_DESC;
 	priv->rx_ring.rx_ring_size = NUM_DMA_DESC;
 	INIT_WORK(&priv->pending_work, fe_pending_work);
+	spin_lock_init(&priv->irq_lock);
+	priv->rx_int_mask = soc->rx_int;
+	priv->tx_int_mask = soc->tx_int;
+	INIT_WORK(&priv->rx_dim.work, fe_rx_dim_work);
+	priv->rx_dim.mode = DIM_CQ_PERIOD_MODE_START_FROM_EQE;
 
 	napi_weight = 16;
 	if (priv->flags & FE_FLAG_NAPI_WEIGHT) {
@@ -1636,12 +1771,25 @@ static int fe_probe(struct platform_device *pdev)
 		priv->tx_ring.tx_ring_size *= 4;
 		priv->rx_ring.rx_ring_size *= 4;
 	}
-	netif_napi_add_weight(netdev, &priv->rx_napi, fe_poll, napi_weight);
+	netif_napi_add_weight(netdev, &priv->rx_napi, fe_rx_poll, napi_weight);
+	netif_napi_add_tx(netdev, &priv->tx_napi, fe_tx_poll);
 	fe_set_ethtool_ops(netdev);
 
+	if (priv->flags & FE_FLAG_HAS_PPE) {
+		err = fe_ppe_init(priv);
+		if (err) {
+			dev_warn(&pdev->dev, "flow offload unavailable: %d\n",
+				 err);
+		} else {
+			netdev->hw_features |= NETIF_F_HW_TC;
+			netdev->features |= NETIF_F_HW_TC;
+		}
+	}
+
 	err = register_netdev(netdev);
 	if (err) {
 		dev_err(&pdev->dev, "error bringing up device\n");
+		fe_ppe_deinit(priv);
 		goto err_free_dev;
 	}
 
@@ -1666,11 +1814,13 @@ static int fe_remove(struct platform_device *pdev)
 	struct fe_priv *priv = netdev_priv(dev);
 
 	netif_napi_del(&priv->rx_napi);
+	netif_napi_del(&priv->tx_napi);
 	kfree(priv->hw_stats);
 
 	cancel_work_sync(&priv->pending_work);
 
 	unregister_netdev(dev);
+	fe_ppe_deinit(priv);
 	free_netdev(dev);
 	platform_set_drvdata(pdev, NULL);
 
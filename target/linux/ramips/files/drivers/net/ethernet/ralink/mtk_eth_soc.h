@@ -21,6 +21,10 @@
 #include <linux/dma-mapping.h>
 #include <linux/phy.h>
 #include <linux/ethtool.h>
+#include <linux/dim.h>
+#include <linux/rhashtable-types.h>
+
+#include "mtk_offload.h"
 
 enum fe_reg {
 	FE_REG_PDMA_GLO_CFG = 0,
@@ -61,6 +65,8 @@ enum fe_work_flag {
 #define FE_DELAY_CHAN		(((FE_DELAY_EN_INT | FE_DELAY_MAX_INT) << 8) | \
 				 FE_DELAY_MAX_TOUT)
 #define FE_DELAY_INIT		((FE_DELAY_CHAN << 16) | FE_DELAY_CHAN)
+#define FE_DELAY_MAX_PINT	0x7f
+#define FE_DELAY_MAX_PTIME	0xff
 #define FE_PSE_FQFC_CFG_INIT	0x80504000
 #define FE_PSE_FQFC_CFG_256Q	0xff908000
 
@@ -395,6 +401,8 @@ struct fe_soc_data {
 	u32 pdma_glo_cfg;
 	u32 rx_int;
 	u32 tx_int;
+	u32 rx_dly_int;
+	u32 tx_dly_int;
 	u32 status_int;
 	u32 checksum_bit;
 };
@@ -407,6 +415,7 @@ struct fe_soc_data {
 #define FE_FLAG_NAPI_WEIGHT		BIT(6)
 #define FE_FLAG_CALIBRATE_CLK		BIT(7)
 #define FE_FLAG_HAS_SWITCH		BIT(8)
+#define FE_FLAG_HAS_PPE			BIT(9)
 
 #define FE_STAT_REG_DECLARE		\
 	_FE(tx_bytes)			\
@@ -432,6 +441,20 @@ struct fe_hw_stats {
 #undef _FE
 };
 
+#define FE_IRQ_STAT_DECLARE		\
+	_FE(rx_irqs)			\
+	_FE(tx_irqs)			\
+	_FE(rx_polls)			\
+	_FE(tx_polls)			\
+	_FE(rx_polls_full)		\
+	_FE(tx_polls_full)
+
+struct fe_irq_stats {
+#define _FE(x) unsigned long x;
+	FE_IRQ_STAT_DECLARE
+#undef _FE
+};
+
 struct fe_tx_buf {
 	struct sk_buff *skb;
 	DEFINE_DMA_UNMAP_ADDR(dma_addr0);
@@ -478,6 +501,19 @@ struct fe_priv {
 	struct napi_struct		rx_napi;
 
 	struct fe_tx_ring               tx_ring;
+	struct napi_struct		tx_napi;
+
+	/* make sure that interrupt mask updates are atomic */
+	spinlock_t			irq_lock;
+	u32				rx_int_mask;
+	u32				tx_int_mask;
+	u32				rx_coal_usecs;
+	u32				rx_coal_frames;
+	u32				tx_coal_usecs;
+	u32				tx_coal_frames;
+	bool				rx_dim_enabled;
+	struct dim			rx_dim;
+	struct fe_irq_stats		irq_stats;
 
 	struct fe_phy			*phy;
 	struct mii_bus			*mii_bus;
@@ -494,7 +530,10 @@ struct fe_priv {
 	struct reset_control		*resets;
 	struct mtk_foe_entry		*foe_table;
 	dma_addr_t			foe_table_phys;
-	struct flow_offload __rcu	**foe_flow_table;
+	struct fe_flow_entry		**foe_flow;
+	struct rhashtable		foe_flows;
+	DECLARE_BITMAP(foe_ac_map, FE_PPE_AC_GROUPS);
+	struct dentry			*debugfs_dir;
 };
 
 extern const struct of_device_id of_fe_match[];
@@ -509,6 +548,7 @@ void fe_stats_update(struct fe_priv *priv);
 void fe_fwd_config(struct fe_priv *priv);
 void fe_reg_w32(u32 val, enum fe_reg reg);
 u32 fe_reg_r32(enum fe_reg reg);
+void fe_update_coalesce(struct fe_priv *priv);
 
 static inline void *priv_netdev(struct fe_priv *priv)
 {
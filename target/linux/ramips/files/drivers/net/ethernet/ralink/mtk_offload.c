@@ -0,0 +1,896 @@
+/*   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; version 2 of the License
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ */
+
+#include <linux/if_ether.h>
+#include <linux/if_vlan.h>
+#include <linux/ip.h>
+#include <linux/rhashtable.h>
+#include <linux/debugfs.h>
+#include <net/flow_offload.h>
+#include <net/pkt_cls.h>
+#include <asm/unaligned.h>
+
+#include "mtk_eth_soc.h"
+
+struct fe_flow_entry {
+	struct rhash_head node;
+	unsigned long cookie;
+	struct mtk_foe_entry data;
+	u16 hash;
+	u16 commit_ts;
+	u8 ac;
+};
+
+struct fe_flow_data {
+	struct ethhdr eth;
+
+	union {
+		struct {
+			__be32 src_addr;
+			__be32 dst_addr;
+		} v4;
+
+		struct {
+			struct in6_addr src_addr;
+			struct in6_addr dst_addr;
+		} v6;
+	};
+
+	__be16 src_port;
+	__be16 dst_port;
+
+	struct {
+		u16 id;
+		__be16 proto;
+		u8 num;
+	} vlan;
+	struct {
+		u16 sid;
+		u8 num;
+	} pppoe;
+};
+
+static const struct rhashtable_params fe_flow_ht_params = {
+	.head_offset = offsetof(struct fe_flow_entry, node),
+	.key_offset = offsetof(struct fe_flow_entry, cookie),
+	.key_len = sizeof(unsigned long),
+	.automatic_shrinking = true,
+};
+
+static DEFINE_MUTEX(fe_flow_offload_mutex);
+static LIST_HEAD(fe_block_cb_list);
+
+static u32 fe_ppe_timestamp(void)
+{
+	return fe_r32(FE_PPE_FOE_TS) & MTK_FOE_IB1_BIND_TIMESTAMP;
+}
+
+static void fe_ppe_cache_clear(void)
+{
+	fe_w32(fe_r32(FE_PPE_CACHE_CTL) | FE_PPE_CACHE_CTL_CLEAR,
+	       FE_PPE_CACHE_CTL);
+	fe_w32(fe_r32(FE_PPE_CACHE_CTL) & ~FE_PPE_CACHE_CTL_CLEAR,
+	       FE_PPE_CACHE_CTL);
+}
+
+/* the hardware hashes into buckets of two entries, either one may hold the
+ * flow
+ */
+static u32 fe_ppe_hash_entry(struct mtk_foe_entry *e)
+{
+	u32 hv1, hv2, hv3;
+	u32 hash;
+
+	switch (mtk_foe_entry_type(e)) {
+	case MTK_PPE_PKT_TYPE_IPV4_ROUTE:
+	case MTK_PPE_PKT_TYPE_IPV4_HNAPT:
+		hv1 = e->ipv4.orig.ports;
+		hv2 = e->ipv4.orig.dest_ip;
+		hv3 = e->ipv4.orig.src_ip;
+		break;
+	case MTK_PPE_PKT_TYPE_IPV6_ROUTE_3T:
+	case MTK_PPE_PKT_TYPE_IPV6_ROUTE_5T:
+		hv1 = e->ipv6.src_ip[3] ^ e->ipv6.dest_ip[3];
+		hv1 ^= e->ipv6.ports;
+
+		hv2 = e->ipv6.src_ip[2] ^ e->ipv6.dest_ip[2];
+		hv2 ^= e->ipv6.dest_ip[0];
+
+		hv3 = e->ipv6.src_ip[1] ^ e->ipv6.dest_ip[1];
+		hv3 ^= e->ipv6.src_ip[0];
+		break;
+	default:
+		WARN_ON_ONCE(1);
+		return 0;
+	}
+
+	hash = (hv1 & hv2) | ((~hv1) & hv3);
+	hash = (hash >> 24) | ((hash & 0xffffff) << 8);
+	hash ^= hv1 ^ hv2 ^ hv3;
+	hash ^= hash >> 16;
+	hash <<= 1;
+	hash &= FE_PPE_ENTRIES - 1;
+
+	return hash;
+}
+
+static bool fe_foe_entry_match(struct mtk_foe_entry *hwe,
+			       struct mtk_foe_entry *e)
+{
+	int len;
+
+	if (FIELD_GET(MTK_FOE_IB1_STATE, hwe->ib1) != MTK_FOE_STATE_BIND)
+		return false;
+
+	if ((hwe->ib1 ^ e->ib1) & (MTK_FOE_IB1_UDP | MTK_FOE_IB1_PACKET_TYPE))
+		return false;
+
+	if (mtk_foe_entry_type(e) > MTK_PPE_PKT_TYPE_IPV4_DSLITE)
+		len = offsetof(struct mtk_foe_entry, ipv6._rsv);
+	else
+		len = offsetof(struct mtk_foe_entry, ipv4.ib2);
+
+	return !memcmp(&hwe->data, &e->data, len - sizeof(hwe->ib1));
+}
+
+static int fe_foe_entry_idle_time(struct mtk_foe_entry *hwe)
+{
+	u32 ts_mask = MTK_FOE_IB1_BIND_TIMESTAMP;
+	u32 now = fe_ppe_timestamp();
+	u32 ts = FIELD_GET(MTK_FOE_IB1_BIND_TIMESTAMP, hwe->ib1);
+
+	if (ts > now)
+		return ts_mask + 1 - ts + now;
+
+	return now - ts;
+}
+
+static void fe_foe_entry_prepare(struct mtk_foe_entry *e, int type,
+				 int l4proto, const u8 *src_mac,
+				 const u8 *dest_mac)
+{
+	struct mtk_foe_mac_info *l2;
+
+	memset(e, 0, sizeof(*e));
+
+	e->ib1 = FIELD_PREP(MTK_FOE_IB1_STATE, MTK_FOE_STATE_BIND) |
+		 FIELD_PREP(MTK_FOE_IB1_PACKET_TYPE, type) |
+		 FIELD_PREP(MTK_FOE_IB1_UDP, l4proto == IPPROTO_UDP) |
+		 MTK_FOE_IB1_BIND_TTL | MTK_FOE_IB1_BIND_CACHE;
+
+	*mtk_foe_entry_ib2(e) = FIELD_PREP(MTK_FOE_IB2_DEST_PORT,
+					   FE_PSE_PORT_GDM1);
+
+	l2 = mtk_foe_entry_l2(e);
+	l2->dest_mac_hi = get_unaligned_be32(dest_mac);
+	l2->dest_mac_lo = get_unaligned_be16(dest_mac + 4);
+	l2->src_mac_hi = get_unaligned_be32(src_mac);
+	l2->src_mac_lo = get_unaligned_be16(src_mac + 4);
+
+	if (type >= MTK_PPE_PKT_TYPE_IPV4_DSLITE)
+		l2->etype = ETH_P_IPV6;
+	else
+		l2->etype = ETH_P_IP;
+}
+
+static int fe_foe_entry_set_ipv4_tuple(struct mtk_foe_entry *e, bool egress,
+				       __be32 src_addr, __be16 src_port,
+				       __be32 dest_addr, __be16 dest_port)
+{
+	struct mtk_foe_ipv4_tuple *t;
+
+	switch (mtk_foe_entry_type(e)) {
+	case MTK_PPE_PKT_TYPE_IPV4_HNAPT:
+		if (egress) {
+			t = &e->ipv4.new;
+			break;
+		}
+		fallthrough;
+	case MTK_PPE_PKT_TYPE_IPV4_ROUTE:
+		t = &e->ipv4.orig;
+		break;
+	default:
+		WARN_ON_ONCE(1);
+		return -EINVAL;
+	}
+
+	t->src_ip = be32_to_cpu(src_addr);
+	t->dest_ip = be32_to_cpu(dest_addr);
+	t->src_port = be16_to_cpu(src_port);
+	t->dest_port = be16_to_cpu(dest_port);
+
+	return 0;
+}
+
+static void fe_foe_entry_set_ipv6_tuple(struct mtk_foe_entry *e,
+					const struct in6_addr *src_addr,
+					__be16 src_port,
+					const struct in6_addr *dest_addr,
+					__be16 dest_port)
+{
+	int i;
+
+	for (i = 0; i < 4; i++) {
+		e->ipv6.src_ip[i] = be32_to_cpu(src_addr->s6_addr32[i]);
+		e->ipv6.dest_ip[i] = be32_to_cpu(dest_addr->s6_addr32[i]);
+	}
+	e->ipv6.src_port = be16_to_cpu(src_port);
+	e->ipv6.dest_port = be16_to_cpu(dest_port);
+}
+
+static int fe_foe_entry_set_vlan(struct mtk_foe_entry *e, u16 vid)
+{
+	struct mtk_foe_mac_info *l2 = mtk_foe_entry_l2(e);
+
+	switch (FIELD_GET(MTK_FOE_IB1_BIND_VLAN_LAYER, e->ib1)) {
+	case 0:
+		e->ib1 |= MTK_FOE_IB1_BIND_VLAN_TAG |
+			  FIELD_PREP(MTK_FOE_IB1_BIND_VLAN_LAYER, 1);
+		l2->vlan1 = vid;
+		return 0;
+	case 1:
+		if (!(e->ib1 & MTK_FOE_IB1_BIND_VLAN_TAG)) {
+			l2->vlan1 = vid;
+			e->ib1 |= MTK_FOE_IB1_BIND_VLAN_TAG;
+		} else {
+			l2->vlan2 = vid;
+			e->ib1 += FIELD_PREP(MTK_FOE_IB1_BIND_VLAN_LAYER, 1);
+		}
+		return 0;
+	default:
+		return -ENOSPC;
+	}
+}
+
+static void fe_foe_entry_set_pppoe(struct mtk_foe_entry *e, u16 sid)
+{
+	struct mtk_foe_mac_info *l2 = mtk_foe_entry_l2(e);
+
+	if (!(e->ib1 & MTK_FOE_IB1_BIND_VLAN_LAYER) ||
+	    (e->ib1 & MTK_FOE_IB1_BIND_VLAN_TAG))
+		l2->etype = ETH_P_PPP_SES;
+
+	e->ib1 |= MTK_FOE_IB1_BIND_PPPOE;
+	l2->pppoe_id = sid;
+}
+
+static int fe_ppe_commit(struct fe_priv *priv, struct fe_flow_entry *entry)
+{
+	struct mtk_foe_entry *hwe;
+	u32 hash;
+	int i;
+
+	/* a re-commit keeps the slot it already owns */
+	if (priv->foe_flow[entry->hash] == entry) {
+		hash = entry->hash;
+	} else {
+		hash = fe_ppe_hash_entry(&entry->data);
+		for (i = 0; i < 2; i++, hash++)
+			if (!priv->foe_flow[hash])
+				break;
+
+		if (i == 2)
+			return -ENOSPC;
+	}
+
+	entry->commit_ts = fe_ppe_timestamp();
+	entry->data.ib1 &= ~MTK_FOE_IB1_BIND_TIMESTAMP;
+	entry->data.ib1 |= entry->commit_ts;
+
+	hwe = &priv->foe_table[hash];
+	memcpy(&hwe->data, &entry->data.data, sizeof(hwe->data));
+	/* the entry becomes visible to the ppe once ib1 is written */
+	wmb();
+	hwe->ib1 = entry->data.ib1;
+	wmb();
+	fe_ppe_cache_clear();
+
+	priv->foe_flow[hash] = entry;
+	entry->hash = hash;
+
+	return 0;
+}
+
+static void fe_ppe_clear(struct fe_priv *priv, struct fe_flow_entry *entry)
+{
+	struct mtk_foe_entry *hwe = &priv->foe_table[entry->hash];
+
+	hwe->ib1 &= ~MTK_FOE_IB1_STATE;
+	hwe->ib1 |= FIELD_PREP(MTK_FOE_IB1_STATE, MTK_FOE_STATE_INVALID);
+	wmb();
+	fe_ppe_cache_clear();
+
+	priv->foe_flow[entry->hash] = NULL;
+}
+
+static void fe_ppe_ac_alloc(struct fe_priv *priv, struct fe_flow_entry *entry)
+{
+	int ac;
+
+	/* group 0 is shared by all flows without accounting */
+	ac = find_next_zero_bit(priv->foe_ac_map, FE_PPE_AC_GROUPS, 1);
+	if (ac >= FE_PPE_AC_GROUPS)
+		return;
+
+	set_bit(ac, priv->foe_ac_map);
+	entry->ac = ac;
+	*mtk_foe_entry_ib2(&entry->data) |= FIELD_PREP(MTK_FOE_IB2_PORT_AG, ac);
+
+	/* drop whatever the previous owner left behind */
+	fe_r32(FE_PPE_AC_BCNT(ac));
+	fe_r32(FE_PPE_AC_PCNT(ac));
+}
+
+static void fe_ppe_ac_free(struct fe_priv *priv, struct fe_flow_entry *entry)
+{
+	if (entry->ac)
+		clear_bit(entry->ac, priv->foe_ac_map);
+}
+
+static void fe_flow_offload_mangle_eth(const struct flow_action_entry *act,
+				       void *eth)
+{
+	void *dest = eth + act->mangle.offset;
+	const void *src = &act->mangle.val;
+
+	if (act->mangle.offset > 8)
+		return;
+
+	if (act->mangle.mask == 0xffff) {
+		src += 2;
+		dest += 2;
+	}
+
+	memcpy(dest, src, act->mangle.mask ? 2 : 4);
+}
+
+static int fe_flow_mangle_ports(const struct flow_action_entry *act,
+				struct fe_flow_data *data)
+{
+	u32 val = ntohl(act->mangle.val);
+
+	switch (act->mangle.offset) {
+	case 0:
+		if (act->mangle.mask == ~htonl(0xffff))
+			data->dst_port = cpu_to_be16(val);
+		else
+			data->src_port = cpu_to_be16(val >> 16);
+		break;
+	case 2:
+		data->dst_port = cpu_to_be16(val);
+		break;
+	default:
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+static int fe_flow_mangle_ipv4(const struct flow_action_entry *act,
+			       struct fe_flow_data *data)
+{
+	__be32 *dest;
+
+	switch (act->mangle.offset) {
+	case offsetof(struct iphdr, saddr):
+		dest = &data->v4.src_addr;
+		break;
+	case offsetof(struct iphdr, daddr):
+		dest = &data->v4.dst_addr;
+		break;
+	default:
+		return -EINVAL;
+	}
+
+	memcpy(dest, &act->mangle.val, sizeof(u32));
+
+	return 0;
+}
+
+static int fe_flow_offload_replace(struct fe_priv *priv,
+				   struct flow_cls_offload *f)
+{
+	struct flow_rule *rule = flow_cls_offload_flow_rule(f);
+	struct flow_action_entry *act;
+	struct fe_flow_data data = {};
+	struct mtk_foe_entry foe;
+	struct net_device *odev = NULL;
+	struct fe_flow_entry *entry;
+	int offload_type;
+	u16 addr_type;
+	u8 l4proto;
+	int err, i;
+
+	if (rhashtable_lookup_fast(&priv->foe_flows, &f->cookie,
+				   fe_flow_ht_params))
+		return -EEXIST;
+
+	if (flow_rule_match_key(rule, FLOW_DISSECTOR_KEY_META)) {
+		struct flow_match_meta match;
+		struct net_device *idev;
+
+		flow_rule_match_meta(rule, &match);
+		idev = __dev_get_by_index(&init_net,
+					  match.key->ingress_ifindex);
+		if (idev != priv->netdev)
+			return -EOPNOTSUPP;
+	}
+
+	if (flow_rule_match_key(rule, FLOW_DISSECTOR_KEY_CONTROL)) {
+		struct flow_match_control match;
+
+		flow_rule_match_control(rule, &match);
+		addr_type = match.key->addr_type;
+	} else {
+		return -EOPNOTSUPP;
+	}
+
+	if (flow_rule_match_key(rule, FLOW_DISSECTOR_KEY_BASIC)) {
+		struct flow_match_basic match;
+
+		flow_rule_match_basic(rule, &match);
+		l4proto = match.key->ip_proto;
+	} else {
+		return -EOPNOTSUPP;
+	}
+
+	if (l4proto != IPPROTO_TCP && l4proto != IPPROTO_UDP)
+		return -EOPNOTSUPP;
+
+	switch (addr_type) {
+	case FLOW_DISSECTOR_KEY_IPV4_ADDRS:
+		offload_type = MTK_PPE_PKT_TYPE_IPV4_HNAPT;
+		break;
+	case FLOW_DISSECTOR_KEY_IPV6_ADDRS:
+		offload_type = MTK_PPE_PKT_TYPE_IPV6_ROUTE_5T;
+		break;
+	default:
+		return -EOPNOTSUPP;
+	}
+
+	flow_action_for_each(i, act, &rule->action) {
+		switch (act->id) {
+		case FLOW_ACTION_MANGLE:
+			if (act->mangle.htype == FLOW_ACT_MANGLE_HDR_TYPE_ETH)
+				fe_flow_offload_mangle_eth(act, &data.eth);
+			break;
+		case FLOW_ACTION_REDIRECT:
+			odev = act->dev;
+			break;
+		case FLOW_ACTION_CSUM:
+			break;
+		case FLOW_ACTION_VLAN_PUSH:
+			if (data.vlan.num == 1 ||
+			    act->vlan.proto != htons(ETH_P_8021Q))
+				return -EOPNOTSUPP;
+
+			data.vlan.id = act->vlan.vid;
+			data.vlan.proto = act->vlan.proto;
+			data.vlan.num++;
+			break;
+		case FLOW_ACTION_VLAN_POP:
+			break;
+		case FLOW_ACTION_PPPOE_PUSH:
+			if (data.pppoe.num == 1)
+				return -EOPNOTSUPP;
+
+			data.pppoe.sid = act->pppoe.sid;
+			data.pppoe.num++;
+			break;
+		default:
+			return -EOPNOTSUPP;
+		}
+	}
+
+	/* bound flows can only leave through the gdma towards the switch */
+	if (odev != priv->netdev)
+		return -EOPNOTSUPP;
+
+	if (!is_valid_ether_addr(data.eth.h_source) ||
+	    !is_valid_ether_addr(data.eth.h_dest))
+		return -EINVAL;
+
+	fe_foe_entry_prepare(&foe, offload_type, l4proto, data.eth.h_source,
+			     data.eth.h_dest);
+
+	if (flow_rule_match_key(rule, FLOW_DISSECTOR_KEY_PORTS)) {
+		struct flow_match_ports ports;
+
+		flow_rule_match_ports(rule, &ports);
+		data.src_port = ports.key->src;
+		data.dst_port = ports.key->dst;
+	} else {
+		return -EOPNOTSUPP;
+	}
+
+	if (addr_type == FLOW_DISSECTOR_KEY_IPV4_ADDRS) {
+		struct flow_match_ipv4_addrs addrs;
+
+		flow_rule_match_ipv4_addrs(rule, &addrs);
+		data.v4.src_addr = addrs.key->src;
+		data.v4.dst_addr = addrs.key->dst;
+
+		fe_foe_entry_set_ipv4_tuple(&foe, false, data.v4.src_addr,
+					    data.src_port, data.v4.dst_addr,
+					    data.dst_port);
+	} else {
+		struct flow_match_ipv6_addrs addrs;
+
+		flow_rule_match_ipv6_addrs(rule, &addrs);
+		data.v6.src_addr = addrs.key->src;
+		data.v6.dst_addr = addrs.key->dst;
+
+		fe_foe_entry_set_ipv6_tuple(&foe, &data.v6.src_addr,
+					    data.src_port, &data.v6.dst_addr,
+					    data.dst_port);
+	}
+
+	flow_action_for_each(i, act, &rule->action) {
+		if (act->id != FLOW_ACTION_MANGLE)
+			continue;
+
+		switch (act->mangle.htype) {
+		case FLOW_ACT_MANGLE_HDR_TYPE_TCP:
+		case FLOW_ACT_MANGLE_HDR_TYPE_UDP:
+			err = fe_flow_mangle_ports(act, &data);
+			break;
+		case FLOW_ACT_MANGLE_HDR_TYPE_IP4:
+			err = fe_flow_mangle_ipv4(act, &data);
+			break;
+		case FLOW_ACT_MANGLE_HDR_TYPE_ETH:
+			/* handled earlier */
+			err = 0;
+			break;
+		default:
+			return -EOPNOTSUPP;
+		}
+
+		if (err)
+			return err;
+	}
+
+	if (addr_type == FLOW_DISSECTOR_KEY_IPV4_ADDRS) {
+		err = fe_foe_entry_set_ipv4_tuple(&foe, true, data.v4.src_addr,
+						  data.src_port,
+						  data.v4.dst_addr,
+						  data.dst_port);
+		if (err)
+			return err;
+	}
+
+	if (data.vlan.num == 1) {
+		err = fe_foe_entry_set_vlan(&foe, data.vlan.id);
+		if (err)
+			return err;
+	}
+
+	if (data.pppoe.num == 1)
+		fe_foe_entry_set_pppoe(&foe, data.pppoe.sid);
+
+	entry = kzalloc(sizeof(*entry), GFP_KERNEL);
+	if (!entry)
+		return -ENOMEM;
+
+	entry->cookie = f->cookie;
+	memcpy(&entry->data, &foe, sizeof(entry->data));
+	fe_ppe_ac_alloc(priv, entry);
+
+	err = fe_ppe_commit(priv, entry);
+	if (err)
+		goto free;
+
+	err = rhashtable_insert_fast(&priv->foe_flows, &entry->node,
+				     fe_flow_ht_params);
+	if (err)
+		goto clear;
+
+	return 0;
+
+clear:
+	fe_ppe_clear(priv, entry);
+free:
+	fe_ppe_ac_free(priv, entry);
+	kfree(entry);
+	return err;
+}
+
+static int fe_flow_offload_destroy(struct fe_priv *priv,
+				   struct flow_cls_offload *f)
+{
+	struct fe_flow_entry *entry;
+
+	entry = rhashtable_lookup_fast(&priv->foe_flows, &f->cookie,
+				  fe_flow_ht_params);
+	if (!entry)
+		return -ENOENT;
+
+	fe_ppe_clear(priv, entry);
+	fe_ppe_ac_free(priv, entry);
+	rhashtable_remove_fast(&priv->foe_flows, &entry->node,
+			       fe_flow_ht_params);
+	kfree(entry);
+
+	return 0;
+}
+
+static int fe_flow_offload_stats(struct fe_priv *priv,
+				 struct flow_cls_offload *f)
+{
+	struct fe_flow_entry *entry;
+	struct mtk_foe_entry *hwe;
+	u64 bytes = 0, packets = 0;
+	u64 lastused = 0;
+
+	entry = rhashtable_lookup_fast(&priv->foe_flows, &f->cookie,
+				  fe_flow_ht_params);
+	if (!entry)
+		return -ENOENT;
+
+	/* the hardware aged the entry out or the ppe was restarted, bind it
+	 * again and leave lastused alone. nf_flowtable tears the flow down
+	 * once it stays idle in software too.
+	 */
+	hwe = &priv->foe_table[entry->hash];
+	if (!fe_foe_entry_match(hwe, &entry->data))
+		return fe_ppe_commit(priv, entry);
+
+	/* the ppe refreshes the timestamp on every hit, until then the flow
+	 * has not been used since it was bound
+	 */
+	if (FIELD_GET(MTK_FOE_IB1_BIND_TIMESTAMP, hwe->ib1) != entry->commit_ts)
+		lastused = jiffies - fe_foe_entry_idle_time(hwe) * HZ;
+
+	if (entry->ac) {
+		bytes = fe_r32(FE_PPE_AC_BCNT(entry->ac));
+		packets = fe_r32(FE_PPE_AC_PCNT(entry->ac));
+	}
+
+	flow_stats_update(&f->stats, bytes, packets, 0, lastused,
+			  FLOW_ACTION_HW_STATS_DELAYED);
+
+	return 0;
+}
+
+static int fe_flow_offload_cmd(struct fe_priv *priv,
+			       struct flow_cls_offload *cls)
+{
+	int err;
+
+	mutex_lock(&fe_flow_offload_mutex);
+	switch (cls->command) {
+	case FLOW_CLS_REPLACE:
+		err = fe_flow_offload_replace(priv, cls);
+		break;
+	case FLOW_CLS_DESTROY:
+		err = fe_flow_offload_destroy(priv, cls);
+		break;
+	case FLOW_CLS_STATS:
+		err = fe_flow_offload_stats(priv, cls);
+		break;
+	default:
+		err = -EOPNOTSUPP;
+		break;
+	}
+	mutex_unlock(&fe_flow_offload_mutex);
+
+	return err;
+}
+
+static int fe_setup_tc_block_cb(enum tc_setup_type type, void *type_data,
+				void *cb_priv)
+{
+	struct net_device *dev = cb_priv;
+	struct fe_priv *priv = netdev_priv(dev);
+
+	if (!tc_can_offload(dev))
+		return -EOPNOTSUPP;
+
+	if (type != TC_SETUP_CLSFLOWER)
+		return -EOPNOTSUPP;
+
+	return fe_flow_offload_cmd(priv, type_data);
+}
+
+static int fe_setup_tc_block(struct net_device *dev,
+			     struct flow_block_offload *f)
+{
+	struct fe_priv *priv = netdev_priv(dev);
+	struct flow_block_cb *block_cb;
+	flow_setup_cb_t *cb;
+
+	if (!priv->foe_table)
+		return -EOPNOTSUPP;
+
+	if (f->binder_type != FLOW_BLOCK_BINDER_TYPE_CLSACT_INGRESS)
+		return -EOPNOTSUPP;
+
+	cb = fe_setup_tc_block_cb;
+	f->driver_block_list = &fe_block_cb_list;
+
+	switch (f->command) {
+	case FLOW_BLOCK_BIND:
+		block_cb = flow_block_cb_lookup(f->block, cb, dev);
+		if (block_cb) {
+			flow_block_cb_incref(block_cb);
+			return 0;
+		}
+		block_cb = flow_block_cb_alloc(cb, dev, dev, NULL);
+		if (IS_ERR(block_cb))
+			return PTR_ERR(block_cb);
+
+		flow_block_cb_incref(block_cb);
+		flow_block_cb_add(block_cb, f);
+		list_add_tail(&block_cb->driver_list, &fe_block_cb_list);
+		return 0;
+	case FLOW_BLOCK_UNBIND:
+		block_cb = flow_block_cb_lookup(f->block, cb, dev);
+		if (!block_cb)
+			return -ENOENT;
+
+		if (!flow_block_cb_decref(block_cb)) {
+			flow_block_cb_remove(block_cb, f);
+			list_del(&block_cb->driver_list);
+		}
+		return 0;
+	default:
+		return -EOPNOTSUPP;
+	}
+}
+
+int fe_setup_tc(struct net_device *dev, enum tc_setup_type type,
+		void *type_data)
+{
+	switch (type) {
+	case TC_SETUP_BLOCK:
+	case TC_SETUP_FT:
+		return fe_setup_tc_block(dev, type_data);
+	default:
+		return -EOPNOTSUPP;
+	}
+}
+
+void fe_ppe_start(struct fe_priv *priv)
+{
+	u32 val;
+
+	if (!priv->foe_table)
+		return;
+
+	fe_w32(priv->foe_table_phys, FE_PPE_TB_BASE);
+
+	val = FE_PPE_TB_CFG_ENTRY_80B |
+	      FE_PPE_TB_CFG_AGE_NON_L4 |
+	      FE_PPE_TB_CFG_AGE_UNBIND |
+	      FE_PPE_TB_CFG_AGE_TCP |
+	      FE_PPE_TB_CFG_AGE_UDP |
+	      FE_PPE_TB_CFG_AGE_TCP_FIN |
+	      FIELD_PREP(FE_PPE_TB_CFG_SEARCH_MISS,
+			 FE_PPE_SEARCH_MISS_FORWARD) |
+	      FIELD_PREP(FE_PPE_TB_CFG_HASH_MODE, 1) |
+	      FIELD_PREP(FE_PPE_TB_CFG_SCAN_MODE,
+			 FE_PPE_SCAN_MODE_CHECK_AGE) |
+	      FIELD_PREP(FE_PPE_TB_CFG_ENTRY_NUM, FE_PPE_ENTRIES_SHIFT);
+	fe_w32(val, FE_PPE_TB_CFG);
+
+	fe_w32(FE_PPE_IP_PROTO_CHK_IPV4 | FE_PPE_IP_PROTO_CHK_IPV6,
+	       FE_PPE_IP_PROTO_CHK);
+
+	fe_w32(fe_r32(FE_PPE_CACHE_CTL) | FE_PPE_CACHE_CTL_EN,
+	       FE_PPE_CACHE_CTL);
+	fe_ppe_cache_clear();
+
+	val = FE_PPE_FLOW_CFG_IP6_3T_ROUTE |
+	      FE_PPE_FLOW_CFG_IP6_5T_ROUTE |
+	      FE_PPE_FLOW_CFG_IP4_NAT |
+	      FE_PPE_FLOW_CFG_IP4_NAPT |
+	      FE_PPE_FLOW_CFG_IP4_NAT_FRAG;
+	fe_w32(val, FE_PPE_FLOW_CFG);
+
+	val = FIELD_PREP(FE_PPE_BIND_AGE0_DELTA_UDP, FE_PPE_AGE_UDP) |
+	      FIELD_PREP(FE_PPE_BIND_AGE0_DELTA_NON_L4, FE_PPE_AGE_NON_L4);
+	fe_w32(val, FE_PPE_BIND_AGE0);
+
+	val = FIELD_PREP(FE_PPE_BIND_AGE1_DELTA_TCP_FIN, FE_PPE_AGE_TCP_FIN) |
+	      FIELD_PREP(FE_PPE_BIND_AGE1_DELTA_TCP, FE_PPE_AGE_TCP);
+	fe_w32(val, FE_PPE_BIND_AGE1);
+
+	fe_w32(0, FE_PPE_DEFAULT_CPU_PORT);
+
+	val = FE_PPE_GLO_CFG_EN |
+	      FE_PPE_GLO_CFG_IP4_L4_CS_DROP |
+	      FE_PPE_GLO_CFG_IP4_CS_DROP |
+	      FE_PPE_GLO_CFG_FLOW_DROP_UPDATE;
+	fe_w32(val, FE_PPE_GLO_CFG);
+
+	/* everything received from the switch passes the ppe, misses are
+	 * forwarded to the cpu port
+	 */
+	fe_w32((fe_r32(MT7620A_GDMA1_FWD_CFG) & ~MT7620_GDMA_FWD_MASK) |
+	       MT7620_GDMA_FWD_PPE, MT7620A_GDMA1_FWD_CFG);
+}
+
+void fe_ppe_stop(struct fe_priv *priv)
+{
+	int i;
+
+	if (!priv->foe_table)
+		return;
+
+	fe_w32(fe_r32(MT7620A_GDMA1_FWD_CFG) & ~MT7620_GDMA_FWD_MASK,
+	       MT7620A_GDMA1_FWD_CFG);
+
+	/* flows stay in the software table and are bound again by the next
+	 * stats request
+	 */
+	for (i = 0; i < FE_PPE_ENTRIES; i++)
+		priv->foe_table[i].ib1 = FIELD_PREP(MTK_FOE_IB1_STATE,
+						    MTK_FOE_STATE_INVALID);
+	wmb();
+
+	fe_w32(fe_r32(FE_PPE_CACHE_CTL) & ~FE_PPE_CACHE_CTL_EN,
+	       FE_PPE_CACHE_CTL);
+	fe_w32(fe_r32(FE_PPE_GLO_CFG) & ~FE_PPE_GLO_CFG_EN, FE_PPE_GLO_CFG);
+	fe_w32(fe_r32(FE_PPE_TB_CFG) & ~(FE_PPE_TB_CFG_SCAN_MODE |
+					 FE_PPE_TB_CFG_KEEPALIVE),
+	       FE_PPE_TB_CFG);
+
+	for (i = 0; i < 10; i++) {
+		if (!(fe_r32(FE_PPE_GLO_CFG) & FE_PPE_GLO_CFG_BUSY))
+			break;
+		usleep_range(10, 20);
+	}
+	if (i == 10)
+		netdev_warn(priv->netdev, "ppe did not become idle\n");
+}
+
+int fe_ppe_init(struct fe_priv *priv)
+{
+	int err;
+
+	priv->foe_flow = devm_kcalloc(priv->dev, FE_PPE_ENTRIES,
+				      sizeof(*priv->foe_flow), GFP_KERNEL);
+	if (!priv->foe_flow)
+		return -ENOMEM;
+
+	priv->foe_table = dmam_alloc_coherent(priv->dev,
+					      FE_PPE_ENTRIES *
+					      sizeof(*priv->foe_table),
+					      &priv->foe_table_phys,
+					      GFP_KERNEL);
+	if (!priv->foe_table)
+		return -ENOMEM;
+
+	err = rhashtable_init(&priv->foe_flows, &fe_flow_ht_params);
+	if (err) {
+		priv->foe_table = NULL;
+		return err;
+	}
+
+	set_bit(0, priv->foe_ac_map);
+	fe_ppe_debugfs_init(priv);
+
+	return 0;
+}
+
+static void fe_flow_entry_free(void *ptr, void *arg)
+{
+	kfree(ptr);
+}
+
+void fe_ppe_deinit(struct fe_priv *priv)
+{
+	if (!priv->foe_table)
+		return;
+
+	debugfs_remove_recursive(priv->debugfs_dir);
+	rhashtable_free_and_destroy(&priv->foe_flows, fe_flow_entry_free,
+				    NULL);
+	priv->foe_table = NULL;
+}
@@ -0,0 +1,262 @@
+/*   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; version 2 of the License
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ */
+
+#ifndef FE_OFFLOAD_H
+#define FE_OFFLOAD_H
+
+#include <linux/bitfield.h>
+#include <linux/netdevice.h>
+
+/* packet processing engine, the FOE table lives in system memory */
+#define MT7620_PPE_OFFSET		0x0c00
+#define FE_PPE_FOE_TS			(FE_FE_OFFSET + 0x10)
+
+#define FE_PPE_GLO_CFG			(MT7620_PPE_OFFSET + 0x200)
+#define FE_PPE_GLO_CFG_EN		BIT(0)
+#define FE_PPE_GLO_CFG_IP4_L4_CS_DROP	BIT(2)
+#define FE_PPE_GLO_CFG_IP4_CS_DROP	BIT(3)
+#define FE_PPE_GLO_CFG_FLOW_DROP_UPDATE	BIT(9)
+#define FE_PPE_GLO_CFG_BUSY		BIT(31)
+
+#define FE_PPE_FLOW_CFG			(MT7620_PPE_OFFSET + 0x204)
+#define FE_PPE_FLOW_CFG_IP6_3T_ROUTE	BIT(8)
+#define FE_PPE_FLOW_CFG_IP6_5T_ROUTE	BIT(9)
+#define FE_PPE_FLOW_CFG_IP4_NAT		BIT(12)
+#define FE_PPE_FLOW_CFG_IP4_NAPT	BIT(13)
+#define FE_PPE_FLOW_CFG_IP4_NAT_FRAG	BIT(17)
+
+#define FE_PPE_IP_PROTO_CHK		(MT7620_PPE_OFFSET + 0x208)
+#define FE_PPE_IP_PROTO_CHK_IPV4	GENMASK(15, 0)
+#define FE_PPE_IP_PROTO_CHK_IPV6	GENMASK(31, 16)
+
+#define FE_PPE_TB_CFG			(MT7620_PPE_OFFSET + 0x21c)
+#define FE_PPE_TB_CFG_ENTRY_NUM		GENMASK(2, 0)
+#define FE_PPE_TB_CFG_ENTRY_80B		BIT(3)
+#define FE_PPE_TB_CFG_SEARCH_MISS	GENMASK(5, 4)
+#define FE_PPE_TB_CFG_AGE_NON_L4	BIT(7)
+#define FE_PPE_TB_CFG_AGE_UNBIND	BIT(8)
+#define FE_PPE_TB_CFG_AGE_TCP		BIT(9)
+#define FE_PPE_TB_CFG_AGE_UDP		BIT(10)
+#define FE_PPE_TB_CFG_AGE_TCP_FIN	BIT(11)
+#define FE_PPE_TB_CFG_KEEPALIVE		GENMASK(13, 12)
+#define FE_PPE_TB_CFG_HASH_MODE		GENMASK(15, 14)
+#define FE_PPE_TB_CFG_SCAN_MODE		GENMASK(17, 16)
+
+#define FE_PPE_SEARCH_MISS_FORWARD	2
+#define FE_PPE_SCAN_MODE_CHECK_AGE	1
+
+#define FE_PPE_TB_BASE			(MT7620_PPE_OFFSET + 0x220)
+#define FE_PPE_TB_USED			(MT7620_PPE_OFFSET + 0x224)
+#define FE_PPE_TB_USED_NUM		GENMASK(13, 0)
+
+#define FE_PPE_BIND_AGE0		(MT7620_PPE_OFFSET + 0x23c)
+#define FE_PPE_BIND_AGE0_DELTA_NON_L4	GENMASK(30, 16)
+#define FE_PPE_BIND_AGE0_DELTA_UDP	GENMASK(14, 0)
+
+#define FE_PPE_BIND_AGE1		(MT7620_PPE_OFFSET + 0x240)
+#define FE_PPE_BIND_AGE1_DELTA_TCP_FIN	GENMASK(30, 16)
+#define FE_PPE_BIND_AGE1_DELTA_TCP	GENMASK(14, 0)
+
+#define FE_PPE_DEFAULT_CPU_PORT		(MT7620_PPE_OFFSET + 0x248)
+
+#define FE_PPE_CACHE_CTL		(MT7620_PPE_OFFSET + 0x320)
+#define FE_PPE_CACHE_CTL_EN		BIT(0)
+#define FE_PPE_CACHE_CTL_CLEAR		BIT(9)
+
+/* per flow accounting groups, clear on read */
+#define FE_PPE_AC_BCNT(x)		(0x1000 + ((x) * 8))
+#define FE_PPE_AC_PCNT(x)		(0x1004 + ((x) * 8))
+
+/* mt7620 gdma forward port, the switch side of the frame engine */
+#define MT7620_GDMA_FWD_MASK		0x7
+#define MT7620_GDMA_FWD_PPE		0x4
+
+/* pse port used as the destination of bound flows */
+#define FE_PSE_PORT_GDM1		1
+
+#define FE_PPE_ENTRIES_SHIFT		1
+#define FE_PPE_ENTRIES			(1024 << FE_PPE_ENTRIES_SHIFT)
+
+/* aging deltas in seconds, matched to the nf_flowtable timeouts */
+#define FE_PPE_AGE_TCP			30
+#define FE_PPE_AGE_TCP_FIN		1
+#define FE_PPE_AGE_UDP			30
+#define FE_PPE_AGE_NON_L4		1
+
+#define MTK_FOE_IB1_BIND_TIMESTAMP	GENMASK(14, 0)
+#define MTK_FOE_IB1_BIND_KEEPALIVE	BIT(15)
+#define MTK_FOE_IB1_BIND_VLAN_LAYER	GENMASK(18, 16)
+#define MTK_FOE_IB1_BIND_PPPOE		BIT(19)
+#define MTK_FOE_IB1_BIND_VLAN_TAG	BIT(20)
+#define MTK_FOE_IB1_BIND_PKT_SAMPLE	BIT(21)
+#define MTK_FOE_IB1_BIND_CACHE		BIT(22)
+#define MTK_FOE_IB1_BIND_TUNNEL_DECAP	BIT(23)
+#define MTK_FOE_IB1_BIND_TTL		BIT(24)
+#define MTK_FOE_IB1_PACKET_TYPE		GENMASK(27, 25)
+#define MTK_FOE_IB1_STATE		GENMASK(29, 28)
+#define MTK_FOE_IB1_UDP			BIT(30)
+#define MTK_FOE_IB1_STATIC		BIT(31)
+
+enum {
+	MTK_PPE_PKT_TYPE_IPV4_HNAPT = 0,
+	MTK_PPE_PKT_TYPE_IPV4_ROUTE = 1,
+	MTK_PPE_PKT_TYPE_IPV4_DSLITE = 3,
+	MTK_PPE_PKT_TYPE_IPV6_ROUTE_3T = 4,
+	MTK_PPE_PKT_TYPE_IPV6_ROUTE_5T = 5,
+	MTK_PPE_PKT_TYPE_IPV6_6RD = 7,
+};
+
+#define MTK_FOE_IB2_QID			GENMASK(3, 0)
+#define MTK_FOE_IB2_PSE_QOS		BIT(4)
+#define MTK_FOE_IB2_DEST_PORT		GENMASK(7, 5)
+#define MTK_FOE_IB2_MULTICAST		BIT(8)
+#define MTK_FOE_IB2_PORT_MG		GENMASK(17, 12)
+#define MTK_FOE_IB2_PORT_AG		GENMASK(23, 18)
+#define MTK_FOE_IB2_DSCP		GENMASK(31, 24)
+
+#define FE_PPE_AC_GROUPS		64
+
+enum {
+	MTK_FOE_STATE_INVALID,
+	MTK_FOE_STATE_UNBIND,
+	MTK_FOE_STATE_BIND,
+	MTK_FOE_STATE_FIN
+};
+
+struct mtk_foe_mac_info {
+	u16 vlan1;
+	u16 etype;
+
+	u32 dest_mac_hi;
+
+	u16 vlan2;
+	u16 dest_mac_lo;
+
+	u32 src_mac_hi;
+
+	u16 pppoe_id;
+	u16 src_mac_lo;
+};
+
+struct mtk_foe_ipv4_tuple {
+	u32 src_ip;
+	u32 dest_ip;
+	union {
+		struct {
+			u16 dest_port;
+			u16 src_port;
+		};
+		u32 ports;
+	};
+};
+
+struct mtk_foe_ipv4 {
+	struct mtk_foe_ipv4_tuple orig;
+
+	u32 ib2;
+
+	struct mtk_foe_ipv4_tuple new;
+
+	u16 timestamp;
+	u16 _rsv0[3];
+
+	u32 udf_tsid;
+
+	struct mtk_foe_mac_info l2;
+};
+
+struct mtk_foe_ipv6 {
+	u32 src_ip[4];
+	u32 dest_ip[4];
+
+	union {
+		struct {
+			u16 dest_port;
+			u16 src_port;
+		};
+		u32 ports;
+	};
+
+	u32 _rsv[3];
+
+	u32 udf;
+
+	u32 ib2;
+	struct mtk_foe_mac_info l2;
+};
+
+struct mtk_foe_entry {
+	u32 ib1;
+
+	union {
+		struct mtk_foe_ipv4 ipv4;
+		struct mtk_foe_ipv6 ipv6;
+		u32 data[19];
+	};
+};
+
+static inline int mtk_foe_entry_type(const struct mtk_foe_entry *e)
+{
+	return FIELD_GET(MTK_FOE_IB1_PACKET_TYPE, e->ib1);
+}
+
+static inline struct mtk_foe_mac_info *
+mtk_foe_entry_l2(struct mtk_foe_entry *e)
+{
+	if (mtk_foe_entry_type(e) >= MTK_PPE_PKT_TYPE_IPV4_DSLITE)
+		return &e->ipv6.l2;
+
+	return &e->ipv4.l2;
+}
+
+static inline u32 *mtk_foe_entry_ib2(struct mtk_foe_entry *e)
+{
+	if (mtk_foe_entry_type(e) >= MTK_PPE_PKT_TYPE_IPV4_DSLITE)
+		return &e->ipv6.ib2;
+
+	return &e->ipv4.ib2;
+}
+
+struct fe_priv;
+
+#ifdef CONFIG_NET_RALINK_OFFLOAD
+int fe_ppe_init(struct fe_priv *priv);
+void fe_ppe_deinit(struct fe_priv *priv);
+void fe_ppe_start(struct fe_priv *priv);
+void fe_ppe_stop(struct fe_priv *priv);
+int fe_setup_tc(struct net_device *dev, enum tc_setup_type type,
+		void *type_data);
+void fe_ppe_debugfs_init(struct fe_priv *priv);
+#else
+static inline int fe_ppe_init(struct fe_priv *priv)
+{
+	return -EOPNOTSUPP;
+}
+
+static inline void fe_ppe_deinit(struct fe_priv *priv)
+{
+}
+
+static inline void fe_ppe_start(struct fe_priv *priv)
+{
+}
+
+static inline void fe_ppe_stop(struct fe_priv *priv)
+{
+}
+
+static inline int fe_setup_tc(struct net_device *dev,
+			      enum tc_setup_type type, void *type_data)
+{
+	return -EOPNOTSUPP;
+}
+#endif
+
+#endif /* FE_OFFLOAD_H */
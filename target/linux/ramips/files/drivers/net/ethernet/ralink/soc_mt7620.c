@@ -333,6 +333,8 @@ static void mt7620_init_data(struct fe_soc_data *data,
 
 	priv->flags = FE_FLAG_PADDING_64B | FE_FLAG_RX_2B_OFFSET |
 		FE_FLAG_RX_SG_DMA | FE_FLAG_HAS_SWITCH;
+	if (IS_ENABLED(CONFIG_NET_RALINK_OFFLOAD))
+		priv->flags |= FE_FLAG_HAS_PPE;
 
 	netdev->hw_features = NETIF_F_IP_CSUM | NETIF_F_RXCSUM |
 		NETIF_F_HW_VLAN_CTAG_TX;
@@ -353,6 +355,8 @@ static struct fe_soc_data mt7620_data = {
 	.pdma_glo_cfg = FE_PDMA_SIZE_16DWORDS,
 	.rx_int = RT5350_RX_DONE_INT,
 	.tx_int = RT5350_TX_DONE_INT,
+	.rx_dly_int = RT5350_RX_DLY_INT,
+	.tx_dly_int = RT5350_TX_DLY_INT,
 	.status_int = MT7620_FE_GDM1_AF,
 	.checksum_bit = MT7620_L4_VALID,
 	.has_carrier = mt7620_has_carrier,
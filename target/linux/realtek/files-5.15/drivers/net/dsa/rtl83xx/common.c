@@ -1491,6 +1491,7 @@ static int __init rtl83xx_sw_probe(struct platform_device *pdev)
 	priv->ds->ops = &rtl83xx_switch_ops;
 	priv->ds->needs_standalone_vlan_filtering = true;
 	priv->dev = dev;
+	platform_set_drvdata(pdev, priv);
 
 	mutex_init(&priv->reg_mutex);
 
@@ -1570,10 +1571,14 @@ static int __init rtl83xx_sw_probe(struct platform_device *pdev)
 		return err;
 	}
 
+	err = rtl83xx_l2_shadow_init(priv);
+	if (err)
+		return err;
+
 	err = dsa_register_switch(priv->ds);
 	if (err) {
 		dev_err(dev, "Error registering switch: %d\n", err);
-		return err;
+		goto err_l2_shadow;
 	}
 
 	/* dsa_to_port returns dsa_port from the port list in
@@ -1620,6 +1625,9 @@ static int __init rtl83xx_sw_probe(struct platform_device *pdev)
 
 	rtl83xx_get_l2aging(priv);
 
+	rtl83xx_l2_shadow_resync(priv);
+	schedule_delayed_work(&priv->l2_scan_work, L2_SCAN_INTERVAL);
+
 	rtl83xx_setup_qos(priv);
 
 	priv->r->l3_setup(priv);
@@ -1630,7 +1638,8 @@ static int __init rtl83xx_sw_probe(struct platform_device *pdev)
 
 	/* Register netdevice event callback to catch changes in link aggregation groups */
 	priv->nb.notifier_call = rtl83xx_netdevice_event;
-	if (register_netdevice_notifier(&priv->nb)) {
+	err = register_netdevice_notifier(&priv->nb);
+	if (err) {
 		priv->nb.notifier_call = NULL;
 		dev_err(dev, "Failed to register LAG netdev notifier\n");
 		goto err_register_nb;
@@ -1643,7 +1652,8 @@ static int __init rtl83xx_sw_probe(struct platform_device *pdev)
 	 * changes to update nexthop entries for L3 routing.
 	 */
 	priv->ne_nb.notifier_call = rtl83xx_netevent_event;
-	if (register_netevent_notifier(&priv->ne_nb)) {
+	err = register_netevent_notifier(&priv->ne_nb);
+	if (err) {
 		priv->ne_nb.notifier_call = NULL;
 		dev_err(dev, "Failed to register netevent notifier\n");
 		goto err_register_ne_nb;
@@ -1681,11 +1691,19 @@ err_register_fib_nb:
 err_register_ne_nb:
 	unregister_netdevice_notifier(&priv->nb);
 err_register_nb:
+	dsa_unregister_switch(priv->ds);
+err_l2_shadow:
+	rtl83xx_l2_shadow_release(priv);
 	return err;
 }
 
 static int rtl83xx_sw_remove(struct platform_device *pdev)
 {
+	struct rtl838x_switch_priv *priv = platform_get_drvdata(pdev);
+
+	if (priv)
+		rtl83xx_l2_shadow_release(priv);
+
 	/* TODO: */
 	pr_debug("Removing platform driver for rtl83xx-sw\n");
 
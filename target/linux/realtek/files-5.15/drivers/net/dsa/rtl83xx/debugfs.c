@@ -364,6 +364,22 @@ static const struct file_operations l2_table_fops = {
 	.release = single_release,
 };
 
+static ssize_t l2_resync_write(struct file *filp, const char __user *buffer,
+			       size_t count, loff_t *ppos)
+{
+	struct rtl838x_switch_priv *priv = filp->private_data;
+
+	rtl83xx_l2_shadow_resync(priv);
+
+	return count;
+}
+
+static const struct file_operations l2_resync_fops = {
+	.owner = THIS_MODULE,
+	.open = simple_open,
+	.write = l2_resync_write,
+};
+
 static ssize_t age_out_read(struct file *filp, char __user *buffer, size_t count,
 			     loff_t *ppos)
 {
@@ -697,6 +713,8 @@ void rtl838x_dbgfs_init(struct rtl838x_switch_priv *priv)
 
 	debugfs_create_file("l2_table", 0400, rtl838x_dir, priv, &l2_table_fops);
 
+	debugfs_create_file("l2_resync", 0200, rtl838x_dir, priv, &l2_resync_fops);
+
 	return;
 err:
 	rtl838x_dbgfs_cleanup(priv);
@@ -716,4 +734,6 @@ void rtl930x_dbgfs_init(struct rtl838x_switch_priv *priv)
 	debugfs_create_file("drop_counters", 0400, dbg_dir, priv, &drop_counter_fops);
 
 	debugfs_create_file("l2_table", 0400, dbg_dir, priv, &l2_table_fops);
+
+	debugfs_create_file("l2_resync", 0200, dbg_dir, priv, &l2_resync_fops);
 }
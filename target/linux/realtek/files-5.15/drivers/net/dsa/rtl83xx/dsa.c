@@ -3,6 +3,7 @@
 #include <net/dsa.h>
 #include <linux/etherdevice.h>
 #include <linux/if_bridge.h>
+#include <linux/vmalloc.h>
 #include <asm/mach-rtl838x/mach-rtl83xx.h>
 
 #include "rtl83xx.h"
@@ -1268,6 +1269,8 @@ void rtl83xx_port_stp_state_set(struct dsa_switch *ds, int port, u8 state)
 	mutex_unlock(&priv->reg_mutex);
 }
 
+static void rtl83xx_l2_shadow_resync_port(struct rtl838x_switch_priv *priv, int port);
+
 void rtl83xx_fast_age(struct dsa_switch *ds, int port)
 {
 	struct rtl838x_switch_priv *priv = ds->priv;
@@ -1290,6 +1293,8 @@ void rtl83xx_fast_age(struct dsa_switch *ds, int port)
 
 	do { } while (sw_r32(priv->r->l2_tbl_flush_ctrl) & BIT(26 + s));
 
+	rtl83xx_l2_shadow_resync_port(priv, port);
+
 	mutex_unlock(&priv->reg_mutex);
 }
 
@@ -1305,6 +1310,8 @@ void rtl931x_fast_age(struct dsa_switch *ds, int port)
 
 	do { } while (sw_r32(RTL931X_L2_TBL_FLUSH_CTRL) & BIT (28));
 
+	rtl83xx_l2_shadow_resync_port(priv, port);
+
 	mutex_unlock(&priv->reg_mutex);
 }
 
@@ -1323,6 +1330,8 @@ void rtl930x_fast_age(struct dsa_switch *ds, int port)
 
 	do { } while (sw_r32(priv->r->l2_tbl_flush_ctrl) & BIT(30));
 
+	rtl83xx_l2_shadow_resync_port(priv, port);
+
 	mutex_unlock(&priv->reg_mutex);
 }
 
@@ -1538,6 +1547,135 @@ static void rtl83xx_setup_l2_mc_entry(struct rtl838x_l2_entry *e, int vid, u64 m
 	u64_to_ether_addr(mac, e->mac);
 }
 
+/* Caller must hold priv->reg_mutex */
+static void rtl83xx_l2_shadow_update(struct rtl838x_switch_priv *priv, u32 slot,
+				     struct rtl838x_l2_entry *e)
+{
+	struct rtl83xx_l2_shadow *s = &priv->l2_shadow[slot];
+	struct list_head *head = NULL;
+
+	if (s->valid == e->valid &&
+	    (!e->valid || (s->port == e->port && s->vid == e->vid &&
+			   s->is_static == e->is_static &&
+			   ether_addr_equal(s->mac, e->mac))))
+		return;
+
+	if (e->valid) {
+		if (e->port < ARRAY_SIZE(priv->l2_port_list))
+			head = &priv->l2_port_list[e->port];
+		else if (e->port == RTL930X_PORT_IGNORE && slot < priv->fib_entries)
+			head = &priv->l2_ignore_list;
+	}
+
+	mutex_lock(&priv->l2_shadow_lock);
+
+	list_del_init(&s->list);
+	s->valid = e->valid;
+	if (e->valid) {
+		ether_addr_copy(s->mac, e->mac);
+		s->vid = e->vid;
+		s->port = e->port;
+		s->is_static = e->is_static;
+	}
+	if (head)
+		list_add_tail(&s->list, head);
+
+	mutex_unlock(&priv->l2_shadow_lock);
+}
+
+/* Re-read one slot of the L2 table into the shadow table,
+ * slots beyond fib_entries are CAM entries
+ * Caller must hold priv->reg_mutex
+ */
+static void rtl83xx_l2_shadow_sync(struct rtl838x_switch_priv *priv, u32 slot)
+{
+	struct rtl838x_l2_entry e;
+
+	if (slot < priv->fib_entries)
+		priv->r->read_l2_entry_using_hash(slot >> 2, slot & 0x3, &e);
+	else
+		priv->r->read_cam(slot - priv->fib_entries, &e);
+
+	rtl83xx_l2_shadow_update(priv, slot, &e);
+}
+
+/* Re-read the entire L2 table, e.g. after it has been changed behind our back */
+void rtl83xx_l2_shadow_resync(struct rtl838x_switch_priv *priv)
+{
+	mutex_lock(&priv->reg_mutex);
+
+	for (u32 i = 0; i < priv->fib_entries + L2_CAM_ENTRIES; i++) {
+		rtl83xx_l2_shadow_sync(priv, i);
+
+		if (!((i + 1) % 64))
+			cond_resched();
+	}
+
+	mutex_unlock(&priv->reg_mutex);
+}
+
+/* Learned entries appear and age out without the driver being told, so the
+ * table is re-read in small steps in the background to pick up the deltas
+ */
+static void rtl83xx_l2_scan_work(struct work_struct *work)
+{
+	struct rtl838x_switch_priv *priv = container_of(to_delayed_work(work),
+					   struct rtl838x_switch_priv, l2_scan_work);
+	u32 slots = priv->fib_entries + L2_CAM_ENTRIES;
+
+	mutex_lock(&priv->reg_mutex);
+
+	for (int i = 0; i < L2_SCAN_CHUNK; i++) {
+		rtl83xx_l2_shadow_sync(priv, priv->l2_scan_pos);
+		if (++priv->l2_scan_pos == slots)
+			priv->l2_scan_pos = 0;
+	}
+
+	mutex_unlock(&priv->reg_mutex);
+
+	schedule_delayed_work(&priv->l2_scan_work, L2_SCAN_INTERVAL);
+}
+
+/* Caller must hold priv->reg_mutex */
+static void rtl83xx_l2_shadow_resync_port(struct rtl838x_switch_priv *priv, int port)
+{
+	struct rtl83xx_l2_shadow *s, *tmp;
+
+	/* Only writers holding reg_mutex modify the lists, so it is safe to walk
+	 * the list without l2_shadow_lock while updating the current entry
+	 */
+	list_for_each_entry_safe(s, tmp, &priv->l2_port_list[port], list)
+		rtl83xx_l2_shadow_sync(priv, s - priv->l2_shadow);
+}
+
+int rtl83xx_l2_shadow_init(struct rtl838x_switch_priv *priv)
+{
+	u32 slots = priv->fib_entries + L2_CAM_ENTRIES;
+
+	priv->l2_shadow = vzalloc(array_size(slots, sizeof(*priv->l2_shadow)));
+	if (!priv->l2_shadow)
+		return -ENOMEM;
+
+	for (u32 i = 0; i < slots; i++)
+		INIT_LIST_HEAD(&priv->l2_shadow[i].list);
+
+	for (int i = 0; i < ARRAY_SIZE(priv->l2_port_list); i++)
+		INIT_LIST_HEAD(&priv->l2_port_list[i]);
+	INIT_LIST_HEAD(&priv->l2_ignore_list);
+
+	mutex_init(&priv->l2_shadow_lock);
+	INIT_DELAYED_WORK(&priv->l2_scan_work, rtl83xx_l2_scan_work);
+
+	return 0;
+}
+
+void rtl83xx_l2_shadow_release(struct rtl838x_switch_priv *priv)
+{
+	cancel_delayed_work_sync(&priv->l2_scan_work);
+	vfree(priv->l2_shadow);
+	priv->l2_shadow = NULL;
+}
+
 /* Uses the seed to identify a hash bucket in the L2 using the derived hash key and then loops
  * over the entries in the bucket until either a matching entry is found or an empty slot
  * Returns the filled in rtl838x_l2_entry and the index in the bucket when an entry was found
@@ -1616,6 +1754,7 @@ static int rtl83xx_port_fdb_add(struct dsa_switch *ds, int port,
 	if (idx >= 0) {
 		rtl83xx_setup_l2_uc_entry(&e, port, vid, mac);
 		priv->r->write_l2_entry_using_hash(idx >> 2, idx & 0x3, &e);
+		rtl83xx_l2_shadow_update(priv, idx, &e);
 		goto out;
 	}
 
@@ -1625,6 +1764,7 @@ static int rtl83xx_port_fdb_add(struct dsa_switch *ds, int port,
 	if (idx >= 0) {
 		rtl83xx_setup_l2_uc_entry(&e, port, vid, mac);
 		priv->r->write_cam(idx, &e);
+		rtl83xx_l2_shadow_update(priv, priv->fib_entries + idx, &e);
 		goto out;
 	}
 
@@ -1654,6 +1794,7 @@ static int rtl83xx_port_fdb_del(struct dsa_switch *ds, int port,
 		pr_debug("Found entry index %d, key %d and bucket %d\n", idx, idx >> 2, idx & 3);
 		e.valid = false;
 		priv->r->write_l2_entry_using_hash(idx >> 2, idx & 0x3, &e);
+		rtl83xx_l2_shadow_update(priv, idx, &e);
 		goto out;
 	}
 
@@ -1663,6 +1804,7 @@ static int rtl83xx_port_fdb_del(struct dsa_switch *ds, int port,
 	if (idx >= 0) {
 		e.valid = false;
 		priv->r->write_cam(idx, &e);
+		rtl83xx_l2_shadow_update(priv, priv->fib_entries + idx, &e);
 		goto out;
 	}
 	err = -ENOENT;
@@ -1676,35 +1818,21 @@ out:
 static int rtl83xx_port_fdb_dump(struct dsa_switch *ds, int port,
 				 dsa_fdb_dump_cb_t *cb, void *data)
 {
-	struct rtl838x_l2_entry e;
 	struct rtl838x_switch_priv *priv = ds->priv;
+	struct rtl83xx_l2_shadow *s;
 
-	mutex_lock(&priv->reg_mutex);
-
-	for (int i = 0; i < priv->fib_entries; i++) {
-		priv->r->read_l2_entry_using_hash(i >> 2, i & 0x3, &e);
-
-		if (!e.valid)
-			continue;
-
-		if (e.port == port || e.port == RTL930X_PORT_IGNORE)
-			cb(e.mac, e.vid, e.is_static, data);
-
-		if (!((i + 1) % 64))
-			cond_resched();
-	}
-
-	for (int i = 0; i < 64; i++) {
-		priv->r->read_cam(i, &e);
+	/* Served from the shadow table, see rtl83xx_l2_shadow_resync() to force
+	 * it to be re-read from the hardware
+	 */
+	mutex_lock(&priv->l2_shadow_lock);
 
-		if (!e.valid)
-			continue;
+	list_for_each_entry(s, &priv->l2_port_list[port], list)
+		cb(s->mac, s->vid, s->is_static, data);
 
-		if (e.port == port)
-			cb(e.mac, e.vid, e.is_static, data);
-	}
+	list_for_each_entry(s, &priv->l2_ignore_list, list)
+		cb(s->mac, s->vid, s->is_static, data);
 
-	mutex_unlock(&priv->reg_mutex);
+	mutex_unlock(&priv->l2_shadow_lock);
 
 	return 0;
 }
@@ -1749,6 +1877,7 @@ static int rtl83xx_port_mdb_add(struct dsa_switch *ds, int port,
 			}
 			rtl83xx_setup_l2_mc_entry(&e, vid, mac, mc_group);
 			priv->r->write_l2_entry_using_hash(idx >> 2, idx & 0x3, &e);
+			rtl83xx_l2_shadow_update(priv, idx, &e);
 		}
 		goto out;
 	}
@@ -1770,6 +1899,7 @@ static int rtl83xx_port_mdb_add(struct dsa_switch *ds, int port,
 			}
 			rtl83xx_setup_l2_mc_entry(&e, vid, mac, mc_group);
 			priv->r->write_cam(idx, &e);
+			rtl83xx_l2_shadow_update(priv, priv->fib_entries + idx, &e);
 		}
 		goto out;
 	}
@@ -1812,6 +1942,7 @@ int rtl83xx_port_mdb_del(struct dsa_switch *ds, int port,
 		if (!portmask) {
 			e.valid = false;
 			priv->r->write_l2_entry_using_hash(idx >> 2, idx & 0x3, &e);
+			rtl83xx_l2_shadow_update(priv, idx, &e);
 		}
 		goto out;
 	}
@@ -1824,6 +1955,7 @@ int rtl83xx_port_mdb_del(struct dsa_switch *ds, int port,
 		if (!portmask) {
 			e.valid = false;
 			priv->r->write_cam(idx, &e);
+			rtl83xx_l2_shadow_update(priv, priv->fib_entries + idx, &e);
 		}
 		goto out;
 	}
@@ -602,6 +602,10 @@ typedef enum {
 #define MAX_ROUTER_MACS 64
 #define L3_EGRESS_DMACS 2048
 #define MAX_SMACS 64
+#define L2_CAM_ENTRIES 64
+/* L2 shadow table slots re-read from the hardware per scan step */
+#define L2_SCAN_CHUNK 256
+#define L2_SCAN_INTERVAL (HZ / 10)
 
 enum phy_type {
 	PHY_NONE = 0,
@@ -661,6 +665,18 @@ enum l2_entry_type {
 	IP6_MULTICAST = 4,
 };
 
+/* Software copy of one L2 hash table or CAM slot, linked into the list of
+ * the port it was learned on, so that FDB dumps don't need to read the table
+ */
+struct rtl83xx_l2_shadow {
+	struct list_head list;
+	u8 mac[6];
+	u16 vid;
+	u8 port;
+	bool valid;
+	bool is_static;
+};
+
 struct rtl838x_l2_entry {
 	u8 mac[6];
 	u16 vid;
@@ -1071,6 +1087,12 @@ struct rtl838x_switch_priv {
 	u64 irq_mask;
 	u32 fib_entries;
 	int l2_bucket_size;
+	struct rtl83xx_l2_shadow *l2_shadow;	/* fib_entries hash slots, then the CAM */
+	struct list_head l2_port_list[RTL931X_CPU_PORT + 1];
+	struct list_head l2_ignore_list;	/* Entries with RTL930X_PORT_IGNORE */
+	struct mutex l2_shadow_lock;		/* Protects the lists, writers also hold reg_mutex */
+	struct delayed_work l2_scan_work;
+	u32 l2_scan_pos;
 	struct dentry *dbgfs_dir;
 	int n_lags;
 	u64 lags_port_members[MAX_LAGS];
@@ -75,6 +75,10 @@ inline void rtl_table_data_w(struct table_reg *r, u32 v, int i);
 
 void __init rtl83xx_setup_qos(struct rtl838x_switch_priv *priv);
 
+int rtl83xx_l2_shadow_init(struct rtl838x_switch_priv *priv);
+void rtl83xx_l2_shadow_release(struct rtl838x_switch_priv *priv);
+void rtl83xx_l2_shadow_resync(struct rtl838x_switch_priv *priv);
+
 int rtl83xx_packet_cntr_alloc(struct rtl838x_switch_priv *priv);
 
 int rtl83xx_port_is_under(const struct net_device * dev, struct rtl838x_switch_priv *priv);
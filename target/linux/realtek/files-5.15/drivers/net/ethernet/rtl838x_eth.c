@@ -16,6 +16,7 @@
 #include <linux/module.h>
 #include <linux/phylink.h>
 #include <linux/pkt_sched.h>
+#include <linux/u64_stats_sync.h>
 #include <net/dsa.h>
 #include <net/switchdev.h>
 #include <asm/cacheflush.h>
@@ -53,6 +54,18 @@ extern struct rtl83xx_soc_info soc_info;
 
 #define RING_BUFFER	1600
 
+/* In zero-copy mode the RX ring points directly into page fragments that
+ * become the skb head, TX descriptors point into the mapped skb data.
+ * Frames shorter than RX_COPYBREAK are still copied so that their
+ * (already mapped) buffer can be handed straight back to the ASIC.
+ */
+#define RX_HEADROOM	(NET_SKB_PAD + NET_IP_ALIGN)
+#define RX_BUF_SIZE	(SKB_DATA_ALIGN(RX_HEADROOM + RING_BUFFER) + \
+			 SKB_DATA_ALIGN(sizeof(struct skb_shared_info)))
+#define RX_COPYBREAK	256
+
+#define RTL838X_PFLAG_ZEROCOPY	BIT(0)
+
 struct p_hdr {
 	uint8_t		*buf;
 	uint16_t	reserved;
@@ -172,10 +185,32 @@ static void rtl931x_create_tx_header(struct p_hdr *h, unsigned int dest_port, in
 // 	h->cpu_tag[3] |= (vlan & 0xff) << 8;
 // }
 
+struct rtl838x_ring_stats {
+	u64 zc_bytes;
+	u64 copy_bytes;
+	u64 packets;
+	u64 bytes;
+	u64 dropped;
+	struct u64_stats_sync syncp;
+};
+
+struct rtl838x_rx_buf {
+	void *data;
+	dma_addr_t dma;
+};
+
+struct rtl838x_tx_buf {
+	struct sk_buff *skb;
+	dma_addr_t dma;
+	unsigned int len;
+};
+
 struct rtl838x_rx_q {
 	int id;
 	struct rtl838x_eth_priv *priv;
 	struct napi_struct napi;
+	struct rtl838x_rx_buf *bufs;
+	struct rtl838x_ring_stats stats;
 };
 
 struct rtl838x_eth_priv {
@@ -183,8 +218,14 @@ struct rtl838x_eth_priv {
 	struct platform_device *pdev;
 	void *membase;
 	spinlock_t lock;
+	spinlock_t rx_lock;	/* RX interrupt mask and ring counters */
 	struct mii_bus *mii_bus;
 	struct rtl838x_rx_q rx_qs[MAX_RXRINGS];
+	struct rtl838x_tx_buf tx_bufs[TXRINGS][TXRINGLEN];
+	struct rtl838x_ring_stats tx_stats[TXRINGS];
+	u16 tx_dirty[TXRINGS];
+	u16 tx_pending[TXRINGS];
+	bool zerocopy;
 	struct phylink *phylink;
 	struct phylink_config phylink_config;
 	u16 id;
@@ -330,36 +371,156 @@ bool rtl931x_decode_tag(struct p_hdr *h, struct dsa_tag *t)
 	return t->l2_offloaded;
 }
 
-/* Discard the RX ring-buffers, called as part of the net-ISR
- * when the buffer runs over
+/* Address of the packet buffer of RX ring r, entry idx as seen by the ASIC */
+static u8 *rtl838x_rx_buf_addr(struct rtl838x_eth_priv *priv, int r, int idx)
+{
+	struct ring_b *ring = priv->membase;
+
+	if (priv->zerocopy)
+		return (u8 *)KSEG1ADDR(priv->rx_qs[r].bufs[idx].dma);
+
+	return (u8 *)KSEG1ADDR(ring->rx_space +
+	                       r * priv->rxringlen * RING_BUFFER +
+	                       idx * RING_BUFFER);
+}
+
+/* Address of the KSEG1 bounce buffer of TX ring q, entry idx */
+static u8 *rtl838x_tx_buf_addr(struct rtl838x_eth_priv *priv, int q, int idx)
+{
+	struct ring_b *ring = priv->membase;
+
+	return (u8 *)KSEG1ADDR(ring->tx_space +
+	                       q * TXRINGLEN * RING_BUFFER +
+	                       idx * RING_BUFFER);
+}
+
+static void rtl838x_ring_stats_add(struct rtl838x_ring_stats *s, int zc, int copy)
+{
+	u64_stats_update_begin(&s->syncp);
+	s->zc_bytes += zc;
+	s->copy_bytes += copy;
+	u64_stats_update_end(&s->syncp);
+}
+
+/* Allocate and map a page fragment as RX buffer, the ASIC writes the
+ * frame behind RX_HEADROOM so that the fragment can become the skb head
  */
-static void rtl838x_rb_cleanup(struct rtl838x_eth_priv *priv, int status)
+static int rtl838x_rx_buf_alloc(struct rtl838x_eth_priv *priv, struct rtl838x_rx_buf *buf,
+				bool napi)
+{
+	struct device *dev = &priv->pdev->dev;
+	void *data;
+	dma_addr_t dma;
+
+	data = napi ? napi_alloc_frag(RX_BUF_SIZE) : netdev_alloc_frag(RX_BUF_SIZE);
+	if (!data)
+		return -ENOMEM;
+
+	dma = dma_map_single(dev, data + RX_HEADROOM, RING_BUFFER, DMA_FROM_DEVICE);
+	if (dma_mapping_error(dev, dma)) {
+		skb_free_frag(data);
+		return -ENOMEM;
+	}
+
+	buf->data = data;
+	buf->dma = dma;
+
+	return 0;
+}
+
+static void rtl838x_rx_bufs_free(struct rtl838x_eth_priv *priv)
 {
+	struct device *dev = &priv->pdev->dev;
+
 	for (int r = 0; r < priv->rxrings; r++) {
-		struct ring_b *ring = priv->membase;
-		struct p_hdr *h;
-		u32 *last;
+		struct rtl838x_rx_q *rx_q = &priv->rx_qs[r];
 
-		pr_debug("In %s working on r: %d\n", __func__, r);
-		last = (u32 *)KSEG1ADDR(sw_r32(priv->r->dma_if_rx_cur + r * 4));
-		do {
-			if ((ring->rx_r[r][ring->c_rx[r]] & 0x1))
-				break;
-			pr_debug("Got something: %d\n", ring->c_rx[r]);
-			h = &ring->rx_header[r][ring->c_rx[r]];
-			memset(h, 0, sizeof(struct p_hdr));
-			h->buf = (u8 *)KSEG1ADDR(ring->rx_space +
-			                         r * priv->rxringlen * RING_BUFFER +
-			                         ring->c_rx[r] * RING_BUFFER);
-			h->size = RING_BUFFER;
-			/* make sure the header is visible to the ASIC */
-			mb();
+		if (!rx_q->bufs)
+			continue;
+
+		for (int i = 0; i < priv->rxringlen; i++) {
+			struct rtl838x_rx_buf *buf = &rx_q->bufs[i];
 
-			ring->rx_r[r][ring->c_rx[r]] = KSEG1ADDR(h) | 0x1 | (ring->c_rx[r] == (priv->rxringlen - 1) ?
-			                               WRAP :
-			                               0x1);
-			ring->c_rx[r] = (ring->c_rx[r] + 1) % priv->rxringlen;
-		} while (&ring->rx_r[r][ring->c_rx[r]] != last);
+			if (!buf->data)
+				continue;
+			dma_unmap_single(dev, buf->dma, RING_BUFFER, DMA_FROM_DEVICE);
+			skb_free_frag(buf->data);
+		}
+		kfree(rx_q->bufs);
+		rx_q->bufs = NULL;
+	}
+}
+
+static int rtl838x_rx_bufs_alloc(struct rtl838x_eth_priv *priv)
+{
+	for (int r = 0; r < priv->rxrings; r++) {
+		struct rtl838x_rx_q *rx_q = &priv->rx_qs[r];
+
+		rx_q->bufs = kcalloc(priv->rxringlen, sizeof(*rx_q->bufs), GFP_KERNEL);
+		if (!rx_q->bufs)
+			goto err_free;
+
+		for (int i = 0; i < priv->rxringlen; i++) {
+			if (rtl838x_rx_buf_alloc(priv, &rx_q->bufs[i], false))
+				goto err_free;
+		}
+	}
+
+	return 0;
+
+err_free:
+	rtl838x_rx_bufs_free(priv);
+
+	return -ENOMEM;
+}
+
+/* Unmap and free the skbs of all descriptors of TX ring q the ASIC has
+ * handed back to the CPU. Called with priv->lock held.
+ */
+static void rtl838x_tx_reclaim(struct rtl838x_eth_priv *priv, int q)
+{
+	struct ring_b *ring = priv->membase;
+
+	while (priv->tx_pending[q]) {
+		int i = priv->tx_dirty[q];
+		struct rtl838x_tx_buf *buf = &priv->tx_bufs[q][i];
+
+		if (ring->tx_r[q][i] & 0x1)
+			break;
+
+		if (buf->skb) {
+			dma_unmap_single(&priv->pdev->dev, buf->dma, buf->len, DMA_TO_DEVICE);
+			dev_consume_skb_any(buf->skb);
+			buf->skb = NULL;
+		}
+		priv->tx_dirty[q] = (i + 1) % TXRINGLEN;
+		priv->tx_pending[q]--;
+	}
+}
+
+static void rtl838x_tx_reclaim_all(struct rtl838x_eth_priv *priv)
+{
+	spin_lock(&priv->lock);
+	for (int q = 0; q < TXRINGS; q++)
+		rtl838x_tx_reclaim(priv, q);
+	spin_unlock(&priv->lock);
+}
+
+/* Release all in-flight TX skbs, the DMA engine must be stopped */
+static void rtl838x_tx_free(struct rtl838x_eth_priv *priv)
+{
+	for (int q = 0; q < TXRINGS; q++) {
+		for (int i = 0; i < TXRINGLEN; i++) {
+			struct rtl838x_tx_buf *buf = &priv->tx_bufs[q][i];
+
+			if (!buf->skb)
+				continue;
+			dma_unmap_single(&priv->pdev->dev, buf->dma, buf->len, DMA_TO_DEVICE);
+			dev_kfree_skb_any(buf->skb);
+			buf->skb = NULL;
+		}
+		priv->tx_dirty[q] = 0;
+		priv->tx_pending[q] = 0;
 	}
 }
 
@@ -438,16 +599,20 @@ static irqreturn_t rtl83xx_net_irq(int irq, void *dev_id)
 
 	pr_debug("IRQ: %08x\n", status);
 
-	/*  Ignore TX interrupt */
+	/* TX interrupt, only of interest when skbs are still mapped */
 	if ((status & 0xf0000)) {
 		/* Clear ISR */
 		sw_w32(0x000f0000, priv->r->dma_if_intr_sts);
+		if (priv->zerocopy)
+			rtl838x_tx_reclaim_all(priv);
 	}
 
 	/* RX interrupt */
 	if (status & 0x0ff00) {
 		/* ACK and disable RX interrupt for this ring */
+		spin_lock(&priv->rx_lock);
 		sw_w32_mask(0xff00 & status, 0, priv->r->dma_if_intr_msk);
+		spin_unlock(&priv->rx_lock);
 		sw_w32(0x0000ff00 & status, priv->r->dma_if_intr_sts);
 		for (int i = 0; i < priv->rxrings; i++) {
 			if (status & BIT(i + 8)) {
@@ -457,12 +622,15 @@ static irqreturn_t rtl83xx_net_irq(int irq, void *dev_id)
 		}
 	}
 
-	/* RX buffer overrun */
+	/* RX buffer overrun, the ring is drained by its own NAPI instance */
 	if (status & 0x000ff) {
 		pr_debug("RX buffer overrun: status %x, mask: %x\n",
 			 status, sw_r32(priv->r->dma_if_intr_msk));
-		sw_w32(status, priv->r->dma_if_intr_sts);
-		rtl838x_rb_cleanup(priv, status & 0xff);
+		sw_w32(status & 0x000ff, priv->r->dma_if_intr_sts);
+		for (int i = 0; i < priv->rxrings; i++) {
+			if (status & BIT(i))
+				napi_schedule(&priv->rx_qs[i].napi);
+		}
 	}
 
 	if (priv->family_id == RTL8390_FAMILY_ID && status & 0x00100000) {
@@ -494,11 +662,13 @@ static irqreturn_t rtl93xx_net_irq(int irq, void *dev_id)
 	pr_debug("In %s, status_tx: %08x, status_rx: %08x, status_rx_r: %08x\n",
 		__func__, status_tx, status_rx, status_rx_r);
 
-	/*  Ignore TX interrupt */
+	/* TX interrupt, only of interest when skbs are still mapped */
 	if (status_tx) {
 		/* Clear ISR */
 		pr_debug("TX done\n");
 		sw_w32(status_tx, priv->r->dma_if_intr_tx_done_sts);
+		if (priv->zerocopy)
+			rtl838x_tx_reclaim_all(priv);
 	}
 
 	/* RX interrupt */
@@ -506,7 +676,9 @@ static irqreturn_t rtl93xx_net_irq(int irq, void *dev_id)
 		pr_debug("RX IRQ\n");
 		/* ACK and disable RX interrupt for given rings */
 		sw_w32(status_rx, priv->r->dma_if_intr_rx_done_sts);
+		spin_lock(&priv->rx_lock);
 		sw_w32_mask(status_rx, 0, priv->r->dma_if_intr_rx_done_msk);
+		spin_unlock(&priv->rx_lock);
 		for (int i = 0; i < priv->rxrings; i++) {
 			if (status_rx & BIT(i)) {
 				pr_debug("Scheduling queue: %d\n", i);
@@ -515,12 +687,15 @@ static irqreturn_t rtl93xx_net_irq(int irq, void *dev_id)
 		}
 	}
 
-	/* RX buffer overrun */
+	/* RX buffer overrun, the ring is drained by its own NAPI instance */
 	if (status_rx_r) {
 		pr_debug("RX buffer overrun: status %x, mask: %x\n",
 		         status_rx_r, sw_r32(priv->r->dma_if_intr_rx_runout_msk));
 		sw_w32(status_rx_r, priv->r->dma_if_intr_rx_runout_sts);
-		rtl838x_rb_cleanup(priv, status_rx_r);
+		for (int i = 0; i < priv->rxrings; i++) {
+			if (status_rx_r & BIT(i))
+				napi_schedule(&priv->rx_qs[i].napi);
+		}
 	}
 
 	return IRQ_HANDLED;
@@ -823,9 +998,7 @@ static void rtl838x_setup_ring_buffer(struct rtl838x_eth_priv *priv, struct ring
 		for (j = 0; j < priv->rxringlen; j++) {
 			h = &ring->rx_header[i][j];
 			memset(h, 0, sizeof(struct p_hdr));
-			h->buf = (u8 *)KSEG1ADDR(ring->rx_space +
-			                         i * priv->rxringlen * RING_BUFFER +
-			                         j * RING_BUFFER);
+			h->buf = rtl838x_rx_buf_addr(priv, i, j);
 			h->size = RING_BUFFER;
 			/* All rings owned by switch, last one wraps */
 			ring->rx_r[i][j] = KSEG1ADDR(h) | 1 | (j == (priv->rxringlen - 1) ?
@@ -842,15 +1015,15 @@ static void rtl838x_setup_ring_buffer(struct rtl838x_eth_priv *priv, struct ring
 		for (j = 0; j < TXRINGLEN; j++) {
 			h = &ring->tx_header[i][j];
 			memset(h, 0, sizeof(struct p_hdr));
-			h->buf = (u8 *)KSEG1ADDR(ring->tx_space +
-			                         i * TXRINGLEN * RING_BUFFER +
-			                         j * RING_BUFFER);
+			h->buf = rtl838x_tx_buf_addr(priv, i, j);
 			h->size = RING_BUFFER;
 			ring->tx_r[i][j] = KSEG1ADDR(&ring->tx_header[i][j]);
 		}
 		/* Last header is wrapping around */
 		ring->tx_r[i][j - 1] |= WRAP;
 		ring->c_tx[i] = 0;
+		priv->tx_dirty[i] = 0;
+		priv->tx_pending[i] = 0;
 	}
 }
 
@@ -882,6 +1055,11 @@ static int rtl838x_eth_open(struct net_device *ndev)
 	pr_debug("%s called: RX rings %d(length %d), TX rings %d(length %d)\n",
 		__func__, priv->rxrings, priv->rxringlen, TXRINGS, TXRINGLEN);
 
+	if (priv->zerocopy && rtl838x_rx_bufs_alloc(priv)) {
+		netdev_err(ndev, "cannot allocate zero-copy RX buffers\n");
+		return -ENOMEM;
+	}
+
 	spin_lock_irqsave(&priv->lock, flags);
 	rtl838x_hw_reset(priv);
 	rtl838x_setup_ring_buffer(priv, ring);
@@ -1021,6 +1199,9 @@ static int rtl838x_eth_stop(struct net_device *ndev)
 
 	netif_tx_stop_all_queues(ndev);
 
+	rtl838x_tx_free(priv);
+	rtl838x_rx_bufs_free(priv);
+
 	return 0;
 }
 
@@ -1154,8 +1335,13 @@ static int rtl838x_eth_tx(struct sk_buff *skb, struct net_device *dev)
 		goto txdone;
 	}
 
+	if (priv->zerocopy)
+		rtl838x_tx_reclaim(priv, q);
+
 	/* We can send this packet if CPU owns the descriptor */
-	if (!(ring->tx_r[q][ring->c_tx[q]] & 0x1)) {
+	if (!(ring->tx_r[q][ring->c_tx[q]] & 0x1) && priv->tx_pending[q] < TXRINGLEN) {
+		struct rtl838x_tx_buf *buf = &priv->tx_bufs[q][ring->c_tx[q]];
+		dma_addr_t dma = DMA_MAPPING_ERROR;
 
 		/* Set descriptor for tx */
 		h = &ring->tx_header[q][ring->c_tx[q]];
@@ -1170,8 +1356,27 @@ static int rtl838x_eth_tx(struct sk_buff *skb, struct net_device *dev)
 		if (dest_port >= 0)
 			priv->r->create_tx_header(h, dest_port, skb->priority >> 1);
 
-		/* Copy packet data to tx buffer */
-		memcpy((void *)KSEG1ADDR(h->buf), skb->data, len);
+		/* Let the ASIC fetch the frame straight from the skb, fall
+		 * back to the bounce buffer if it cannot be mapped
+		 */
+		if (priv->zerocopy) {
+			dma = dma_map_single(&priv->pdev->dev, skb->data, len, DMA_TO_DEVICE);
+			if (dma_mapping_error(&priv->pdev->dev, dma))
+				dma = DMA_MAPPING_ERROR;
+		}
+
+		if (dma != DMA_MAPPING_ERROR) {
+			h->buf = (u8 *)KSEG1ADDR(dma);
+			buf->skb = skb;
+			buf->dma = dma;
+			buf->len = len;
+			rtl838x_ring_stats_add(&priv->tx_stats[q], len, 0);
+		} else {
+			/* Copy packet data to tx buffer */
+			h->buf = rtl838x_tx_buf_addr(priv, q, ring->c_tx[q]);
+			memcpy((void *)KSEG1ADDR(h->buf), skb->data, len);
+			rtl838x_ring_stats_add(&priv->tx_stats[q], 0, len);
+		}
 		/* Make sure packet data is visible to ASIC */
 		wmb();
 
@@ -1200,7 +1405,10 @@ static int rtl838x_eth_tx(struct sk_buff *skb, struct net_device *dev)
 
 		dev->stats.tx_packets++;
 		dev->stats.tx_bytes += len;
-		dev_kfree_skb(skb);
+		if (priv->zerocopy)
+			priv->tx_pending[q]++;
+		if (!buf->skb)
+			dev_kfree_skb(skb);
 		ring->c_tx[q] = (ring->c_tx[q] + 1) % TXRINGLEN;
 		ret = NETDEV_TX_OK;
 	} else {
@@ -1214,6 +1422,30 @@ txdone:
 	return ret;
 }
 
+static void rtl838x_get_stats64(struct net_device *dev, struct rtnl_link_stats64 *stats)
+{
+	struct rtl838x_eth_priv *priv = netdev_priv(dev);
+
+	netdev_stats_to_stats64(stats, &dev->stats);
+
+	for (int r = 0; r < priv->rxrings; r++) {
+		struct rtl838x_ring_stats *s = &priv->rx_qs[r].stats;
+		u64 packets, bytes, dropped;
+		unsigned int start;
+
+		do {
+			start = u64_stats_fetch_begin_irq(&s->syncp);
+			packets = s->packets;
+			bytes = s->bytes;
+			dropped = s->dropped;
+		} while (u64_stats_fetch_retry_irq(&s->syncp, start));
+
+		stats->rx_packets += packets;
+		stats->rx_bytes += bytes;
+		stats->rx_dropped += dropped;
+	}
+}
+
 /* Return queue number for TX. On the RTL83XX, these queues have equal priority
  * so we do round-robin
  */
@@ -1237,25 +1469,106 @@ u16 rtl93xx_pick_tx_queue(struct net_device *dev, struct sk_buff *skb,
 	return 0;
 }
 
-static int rtl838x_hw_receive(struct net_device *dev, int r, int budget)
+static struct sk_buff *rtl838x_rx_copy(struct rtl838x_eth_priv *priv, int r, u8 *data, int len)
 {
-	struct rtl838x_eth_priv *priv = netdev_priv(dev);
+	struct sk_buff *skb;
+
+	skb = napi_alloc_skb(&priv->rx_qs[r].napi, len);
+	if (!skb)
+		return NULL;
+
+	skb_put_data(skb, data, len);
+	rtl838x_ring_stats_add(&priv->rx_qs[r].stats, 0, len);
+
+	return skb;
+}
+
+/* Build the skb around the RX buffer of entry idx and put a fresh buffer
+ * into the ring. Short frames, or frames for which no replacement buffer
+ * can be allocated, are copied and the buffer is recycled in place.
+ */
+static struct sk_buff *rtl838x_rx_zc(struct rtl838x_eth_priv *priv, int r, int idx, int len)
+{
+	struct rtl838x_rx_q *rx_q = &priv->rx_qs[r];
+	struct rtl838x_rx_buf *buf = &rx_q->bufs[idx];
+	struct device *dev = &priv->pdev->dev;
+	struct rtl838x_rx_buf new;
+	struct sk_buff *skb;
+
+	if (len <= RX_COPYBREAK || rtl838x_rx_buf_alloc(priv, &new, true)) {
+		dma_sync_single_for_cpu(dev, buf->dma, len, DMA_FROM_DEVICE);
+		skb = rtl838x_rx_copy(priv, r, buf->data + RX_HEADROOM, len);
+		dma_sync_single_for_device(dev, buf->dma, len, DMA_FROM_DEVICE);
+
+		return skb;
+	}
+
+	dma_unmap_single(dev, buf->dma, RING_BUFFER, DMA_FROM_DEVICE);
+	skb = napi_build_skb(buf->data, RX_BUF_SIZE);
+	if (unlikely(!skb)) {
+		skb_free_frag(buf->data);
+		*buf = new;
+		return NULL;
+	}
+	*buf = new;
+
+	skb_reserve(skb, RX_HEADROOM);
+	skb_put(skb, len);
+	rtl838x_ring_stats_add(&rx_q->stats, len, 0);
+
+	return skb;
+}
+
+/* Hand freed descriptors back to the ring counters. The counter registers
+ * are shared between rings, so this is the only part of the RX path that
+ * needs to be serialized between the NAPI instances.
+ */
+static void rtl838x_rx_cntr_update(struct rtl838x_eth_priv *priv, int r)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&priv->rx_lock, flags);
+
+	/* BUG: Prevent bug on RTL838x SoCs */
+	if (priv->family_id == RTL8380_FAMILY_ID) {
+		sw_w32(0xffffffff, priv->r->dma_if_rx_ring_size(0));
+		for (int i = 0; i < priv->rxrings; i++) {
+			unsigned int val;
+
+			/* Update each ring cnt */
+			val = sw_r32(priv->r->dma_if_rx_ring_cntr(i));
+			sw_w32(val, priv->r->dma_if_rx_ring_cntr(i));
+		}
+	}
+
+	priv->r->update_cntr(r, 0);
+
+	spin_unlock_irqrestore(&priv->rx_lock, flags);
+}
+
+/* Walk RX ring r. Each ring is only ever processed by its own NAPI
+ * instance, so neither the descriptors nor c_rx[r] need locking.
+ */
+static int rtl838x_hw_receive(struct rtl838x_rx_q *rx_q, int budget)
+{
+	struct rtl838x_eth_priv *priv = rx_q->priv;
+	struct net_device *dev = priv->netdev;
 	struct ring_b *ring = priv->membase;
+	bool gro = dev->features & NETIF_F_GRO;
+	u64 rx_packets = 0, rx_bytes = 0, rx_dropped = 0;
 	LIST_HEAD(rx_list);
-	unsigned long flags;
 	int work_done = 0;
+	int r = rx_q->id;
 	u32	*last;
 	bool dsa = netdev_uses_dsa(dev);
 
 	pr_debug("---------------------------------------------------------- RX - %d\n", r);
-	spin_lock_irqsave(&priv->lock, flags);
 	last = (u32 *)KSEG1ADDR(sw_r32(priv->r->dma_if_rx_cur + r * 4));
 
 	do {
 		struct sk_buff *skb;
 		struct dsa_tag tag;
 		struct p_hdr *h;
-		u8 *skb_data;
 		u8 *data;
 		int len;
 
@@ -1279,26 +1592,14 @@ static int rtl838x_hw_receive(struct net_device *dev, int r, int budget)
 		if (dsa)
 			len += 4;
 
-		skb = netdev_alloc_skb(dev, len + 4);
-		skb_reserve(skb, NET_IP_ALIGN);
+		/* Make sure data is visible */
+		mb();
+		if (priv->zerocopy)
+			skb = rtl838x_rx_zc(priv, r, ring->c_rx[r], len);
+		else
+			skb = rtl838x_rx_copy(priv, r, data, len);
 
 		if (likely(skb)) {
-			/* BUG: Prevent bug on RTL838x SoCs */
-			if (priv->family_id == RTL8380_FAMILY_ID) {
-				sw_w32(0xffffffff, priv->r->dma_if_rx_ring_size(0));
-				for (int i = 0; i < priv->rxrings; i++) {
-					unsigned int val;
-
-					/* Update each ring cnt */
-					val = sw_r32(priv->r->dma_if_rx_ring_cntr(i));
-					sw_w32(val, priv->r->dma_if_rx_ring_cntr(i));
-				}
-			}
-
-			skb_data = skb_put(skb, len);
-			/* Make sure data is visible */
-			mb();
-			memcpy(skb->data, (u8 *)KSEG1ADDR(data), len);
 			/* Overwrite CRC with cpu_tag */
 			if (dsa) {
 				priv->r->decode_tag(h, &tag);
@@ -1321,19 +1622,23 @@ static int rtl838x_hw_receive(struct net_device *dev, int r, int budget)
 				else
 					skb->ip_summed = CHECKSUM_UNNECESSARY;
 			}
-			dev->stats.rx_packets++;
-			dev->stats.rx_bytes += len;
+			skb_record_rx_queue(skb, r);
+			rx_packets++;
+			rx_bytes += len;
 
-			list_add_tail(&skb->list, &rx_list);
+			if (gro)
+				napi_gro_receive(&rx_q->napi, skb);
+			else
+				list_add_tail(&skb->list, &rx_list);
 		} else {
 			if (net_ratelimit())
 				dev_warn(&dev->dev, "low on memory - packet dropped\n");
-			dev->stats.rx_dropped++;
+			rx_dropped++;
 		}
 
-		/* Reset header structure */
+		/* Reset header structure, the zero-copy buffer may have been replaced */
 		memset(h, 0, sizeof(struct p_hdr));
-		h->buf = data;
+		h->buf = rtl838x_rx_buf_addr(priv, r, ring->c_rx[r]);
 		h->size = RING_BUFFER;
 
 		ring->rx_r[r][ring->c_rx[r]] = KSEG1ADDR(h) | 0x1 | (ring->c_rx[r] == (priv->rxringlen - 1) ?
@@ -1343,12 +1648,18 @@ static int rtl838x_hw_receive(struct net_device *dev, int r, int budget)
 		last = (u32 *)KSEG1ADDR(sw_r32(priv->r->dma_if_rx_cur + r * 4));
 	} while (&ring->rx_r[r][ring->c_rx[r]] != last && work_done < budget);
 
-	netif_receive_skb_list(&rx_list);
+	if (!gro)
+		netif_receive_skb_list(&rx_list);
 
-	/* Update counters */
-	priv->r->update_cntr(r, 0);
+	u64_stats_update_begin(&rx_q->stats.syncp);
+	rx_q->stats.packets += rx_packets;
+	rx_q->stats.bytes += rx_bytes;
+	rx_q->stats.dropped += rx_dropped;
+	u64_stats_update_end(&rx_q->stats.syncp);
 
-	spin_unlock_irqrestore(&priv->lock, flags);
+	/* Update counters */
+	if (work_done)
+		rtl838x_rx_cntr_update(priv, r);
 
 	return work_done;
 }
@@ -1357,25 +1668,26 @@ static int rtl838x_poll_rx(struct napi_struct *napi, int budget)
 {
 	struct rtl838x_rx_q *rx_q = container_of(napi, struct rtl838x_rx_q, napi);
 	struct rtl838x_eth_priv *priv = rx_q->priv;
+	unsigned long flags;
 	int work_done = 0;
 	int r = rx_q->id;
 	int work;
 
 	while (work_done < budget) {
-		work = rtl838x_hw_receive(priv->netdev, r, budget - work_done);
+		work = rtl838x_hw_receive(rx_q, budget - work_done);
 		if (!work)
 			break;
 		work_done += work;
 	}
 
-	if (work_done < budget) {
-		napi_complete_done(napi, work_done);
-
-		/* Enable RX interrupt */
+	if (work_done < budget && napi_complete_done(napi, work_done)) {
+		/* Enable RX interrupt for this ring only */
+		spin_lock_irqsave(&priv->rx_lock, flags);
 		if (priv->family_id == RTL9300_FAMILY_ID || priv->family_id == RTL9310_FAMILY_ID)
-			sw_w32(0xffffffff, priv->r->dma_if_intr_rx_done_msk);
+			sw_w32_mask(0, BIT(r), priv->r->dma_if_intr_rx_done_msk);
 		else
 			sw_w32_mask(0, 0xf00ff | BIT(r + 8), priv->r->dma_if_intr_msk);
+		spin_unlock_irqrestore(&priv->rx_lock, flags);
 	}
 
 	return work_done;
@@ -1621,6 +1933,96 @@ static int rtl838x_set_link_ksettings(struct net_device *ndev,
 	return phylink_ethtool_ksettings_set(priv->phylink, cmd);
 }
 
+static const char rtl838x_priv_flags[][ETH_GSTRING_LEN] = {
+	"zero-copy",
+};
+
+static const char rtl838x_ring_stats_str[][ETH_GSTRING_LEN] = {
+	"zc_bytes",
+	"copy_bytes",
+};
+
+static u32 rtl838x_get_priv_flags(struct net_device *ndev)
+{
+	struct rtl838x_eth_priv *priv = netdev_priv(ndev);
+
+	return priv->zerocopy ? RTL838X_PFLAG_ZEROCOPY : 0;
+}
+
+static int rtl838x_set_priv_flags(struct net_device *ndev, u32 flags)
+{
+	struct rtl838x_eth_priv *priv = netdev_priv(ndev);
+	bool zerocopy = !!(flags & RTL838X_PFLAG_ZEROCOPY);
+
+	if (zerocopy == priv->zerocopy)
+		return 0;
+
+	/* The ring buffers are only set up on open */
+	if (netif_running(ndev))
+		return -EBUSY;
+
+	priv->zerocopy = zerocopy;
+
+	return 0;
+}
+
+static int rtl838x_get_sset_count(struct net_device *ndev, int sset)
+{
+	struct rtl838x_eth_priv *priv = netdev_priv(ndev);
+
+	switch (sset) {
+	case ETH_SS_PRIV_FLAGS:
+		return ARRAY_SIZE(rtl838x_priv_flags);
+	case ETH_SS_STATS:
+		return (priv->rxrings + TXRINGS) * ARRAY_SIZE(rtl838x_ring_stats_str);
+	default:
+		return -EOPNOTSUPP;
+	}
+}
+
+static void rtl838x_get_strings(struct net_device *ndev, u32 sset, u8 *data)
+{
+	struct rtl838x_eth_priv *priv = netdev_priv(ndev);
+
+	switch (sset) {
+	case ETH_SS_PRIV_FLAGS:
+		memcpy(data, rtl838x_priv_flags, sizeof(rtl838x_priv_flags));
+		break;
+	case ETH_SS_STATS:
+		for (int r = 0; r < priv->rxrings; r++)
+			for (int i = 0; i < ARRAY_SIZE(rtl838x_ring_stats_str); i++)
+				ethtool_sprintf(&data, "rx%d_%s", r, rtl838x_ring_stats_str[i]);
+		for (int q = 0; q < TXRINGS; q++)
+			for (int i = 0; i < ARRAY_SIZE(rtl838x_ring_stats_str); i++)
+				ethtool_sprintf(&data, "tx%d_%s", q, rtl838x_ring_stats_str[i]);
+		break;
+	}
+}
+
+static void rtl838x_ring_stats_read(struct rtl838x_ring_stats *s, u64 **data)
+{
+	unsigned int start;
+
+	do {
+		start = u64_stats_fetch_begin_irq(&s->syncp);
+		(*data)[0] = s->zc_bytes;
+		(*data)[1] = s->copy_bytes;
+	} while (u64_stats_fetch_retry_irq(&s->syncp, start));
+
+	*data += ARRAY_SIZE(rtl838x_ring_stats_str);
+}
+
+static void rtl838x_get_ethtool_stats(struct net_device *ndev,
+				      struct ethtool_stats *stats, u64 *data)
+{
+	struct rtl838x_eth_priv *priv = netdev_priv(ndev);
+
+	for (int r = 0; r < priv->rxrings; r++)
+		rtl838x_ring_stats_read(&priv->rx_qs[r].stats, &data);
+	for (int q = 0; q < TXRINGS; q++)
+		rtl838x_ring_stats_read(&priv->tx_stats[q], &data);
+}
+
 static int rtl838x_mdio_read_paged(struct mii_bus *bus, int mii_id, u16 page, int regnum)
 {
 	u32 val;
@@ -2287,6 +2689,7 @@ static const struct net_device_ops rtl838x_eth_netdev_ops = {
 	.ndo_validate_addr = eth_validate_addr,
 	.ndo_set_rx_mode = rtl838x_eth_set_multicast_list,
 	.ndo_tx_timeout = rtl838x_eth_tx_timeout,
+	.ndo_get_stats64 = rtl838x_get_stats64,
 	.ndo_set_features = rtl83xx_set_features,
 	.ndo_fix_features = rtl838x_fix_features,
 	.ndo_setup_tc = rtl83xx_setup_tc,
@@ -2301,6 +2704,7 @@ static const struct net_device_ops rtl839x_eth_netdev_ops = {
 	.ndo_validate_addr = eth_validate_addr,
 	.ndo_set_rx_mode = rtl839x_eth_set_multicast_list,
 	.ndo_tx_timeout = rtl838x_eth_tx_timeout,
+	.ndo_get_stats64 = rtl838x_get_stats64,
 	.ndo_set_features = rtl83xx_set_features,
 	.ndo_fix_features = rtl838x_fix_features,
 	.ndo_setup_tc = rtl83xx_setup_tc,
@@ -2315,6 +2719,7 @@ static const struct net_device_ops rtl930x_eth_netdev_ops = {
 	.ndo_validate_addr = eth_validate_addr,
 	.ndo_set_rx_mode = rtl930x_eth_set_multicast_list,
 	.ndo_tx_timeout = rtl838x_eth_tx_timeout,
+	.ndo_get_stats64 = rtl838x_get_stats64,
 	.ndo_set_features = rtl93xx_set_features,
 	.ndo_fix_features = rtl838x_fix_features,
 	.ndo_setup_tc = rtl83xx_setup_tc,
@@ -2329,6 +2734,7 @@ static const struct net_device_ops rtl931x_eth_netdev_ops = {
 	.ndo_validate_addr = eth_validate_addr,
 	.ndo_set_rx_mode = rtl931x_eth_set_multicast_list,
 	.ndo_tx_timeout = rtl838x_eth_tx_timeout,
+	.ndo_get_stats64 = rtl838x_get_stats64,
 	.ndo_set_features = rtl93xx_set_features,
 	.ndo_fix_features = rtl838x_fix_features,
 };
@@ -2345,6 +2751,11 @@ static const struct phylink_mac_ops rtl838x_phylink_ops = {
 static const struct ethtool_ops rtl838x_ethtool_ops = {
 	.get_link_ksettings     = rtl838x_get_link_ksettings,
 	.set_link_ksettings     = rtl838x_set_link_ksettings,
+	.get_priv_flags		= rtl838x_get_priv_flags,
+	.set_priv_flags		= rtl838x_set_priv_flags,
+	.get_sset_count		= rtl838x_get_sset_count,
+	.get_strings		= rtl838x_get_strings,
+	.get_ethtool_stats	= rtl838x_get_ethtool_stats,
 };
 
 static int __init rtl838x_eth_probe(struct platform_device *pdev)
@@ -2415,6 +2826,7 @@ static int __init rtl838x_eth_probe(struct platform_device *pdev)
 	ring->rx_space = priv->membase + sizeof(struct ring_b) + sizeof(struct notify_b);
 
 	spin_lock_init(&priv->lock);
+	spin_lock_init(&priv->rx_lock);
 
 	dev->ethtool_ops = &rtl838x_ethtool_ops;
 	dev->min_mtu = ETH_ZLEN;
@@ -2518,9 +2930,13 @@ static int __init rtl838x_eth_probe(struct platform_device *pdev)
 	if (err)
 		goto err_free;
 
+	for (int i = 0; i < TXRINGS; i++)
+		u64_stats_init(&priv->tx_stats[i].syncp);
+
 	for (int i = 0; i < priv->rxrings; i++) {
 		priv->rx_qs[i].id = i;
 		priv->rx_qs[i].priv = priv;
+		u64_stats_init(&priv->rx_qs[i].stats.syncp);
 		netif_napi_add(dev, &priv->rx_qs[i].napi, rtl838x_poll_rx, 64);
 	}
 